@@ -1,4 +1,4 @@
-/*****************************************************   
+/*****************************************************
  * Author : Avia Avikasis                            *
  * Reviewer: Gal                                     *
  * 02/08/2022                                        *
@@ -8,12 +8,50 @@
 #include <assert.h> /* assert */
 #include <stdlib.h> /* malloc, free */
 #include <stdio.h>
+#include <string.h> /* memcpy */
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifdef AVL_LATENCY
+#include <limits.h> /* CHAR_BIT */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> /* __rdtsc */
+#else
+#include <time.h> /* clock */
+#endif
+#endif
 
 #include "avl.h"
 
 #define MAX_HEIGHT 10
+#define PREFIX_WORDS (16 / sizeof(unsigned long))
+#define COMPACT_BLOCK_DEPTH 3
+#define COMPACT_BLOCK_NODES ((1 << COMPACT_BLOCK_DEPTH) - 1)
+#define COMPACT_PENDING_INIT 64
+#define CURSOR_DEPTH 128
+#define DIFF_DEPTH (2 * CURSOR_DEPTH)
+#define AGGREGATE_WORDS ((AVL_AGGREGATE_MAX_SIZE + sizeof(void *) - 1) / \
+                         sizeof(void *))
+#define INDEX_INIT_SIZE 16
+#define CACHE_WAYS 4
+#define FILTER_COUNTER_MAX 255
+#define LATENCY_SUB_BITS 2
+#define LATENCY_SUBS (1 << LATENCY_SUB_BITS)
+#define LATENCY_SLOTS 8
+
+#ifdef AVL_LATENCY
+#define LATENCY_START() ReadTicks()
+#define LATENCY_END(avl, op, start) \
+		LatencyRecord((latency_ty **)&(avl)->latency, (op), \
+					  ReadTicks() - (start))
+#else
+#define LATENCY_START() 0
+#define LATENCY_END(avl, op, start) ((void)(start))
+#endif
 
-typedef enum 
+typedef enum
 {
 	LEFT,
 	RIGHT,
@@ -28,27 +66,154 @@ typedef enum
 	RL
 }balance_state_ty;
 
+/* one allocation holding nodes relocated by AvlCompact, freed with its
+   last node. live counts one more while a compaction still fills it.
+   clones may free its nodes from other threads, so live is atomic */
+typedef struct arena
+{
+	size_t live;
+	size_t used;
+	size_t capacity;
+} arena_ty;
+
+/* a cached node of a key, node is NULL for a free entry */
+typedef struct
+{
+	unsigned long hash;
+	node_ty *node;
+} cache_entry_ty;
+
+/* sets of CACHE_WAYS entries, the most recently used first.
+   an entry is cleared when a node of its key may be freed. finds of
+   many threads may reorder a set at once, so the entries and counters
+   are read and written with relaxed atomics. a torn entry may lose
+   the order or a count, but a hit is always checked by the compare */
+typedef struct
+{
+	hash_func hash;
+	cache_entry_ty *entries;
+	size_t sets_mask;
+	size_t hits;
+	size_t misses;
+} cache_ty;
+
+/* counting bloom filter of the elements. a counter that reached
+   FILTER_COUNTER_MAX is never decremented again */
+typedef struct
+{
+	hash_func hash;
+	unsigned char *counters;
+	size_t counters_num;
+	int hashes_num;
+} filter_ty;
+
+/* open addressing with linear probing of nodes by the hash of their
+   data, an entry with a NULL node is empty. at most half full, and
+   every node of the avl is in it */
+typedef struct
+{
+	hash_func hash;
+	cache_entry_ty *entries;
+	size_t mask;
+	size_t num;
+} index_ty;
+
+/* a copy of the histograms for each slot, a thread records in the
+   copy of its slot. the slots are given to threads in the order they
+   first record to any tree, so threads beyond LATENCY_SLOTS share
+   copies, and the counts are added atomically. a tree allocates its
+   histograms on its first record */
+typedef struct
+{
+	size_t counts[LATENCY_SLOTS][LATENCY_OPS_NUM][AVL_LATENCY_BUCKETS];
+} latency_ty;
+
+/* when the tree is augmented, aug_size bytes of aggregate
+   follow the node in the same allocation. string keyed trees keep
+   the key prefix there instead. refs counts the parents and roots
+   pointing to the node, a node with more than one is shared by
+   clones and never changed */
 struct node
 {
 	void *data;
 	long hight;
+	size_t count;
+	size_t refs;
 	struct node *childrens[CHILDREN_NUM];
+	arena_ty *arena;
 };
 
 struct avl
 {
 	node_ty *root;
     cmp_func cmp;
+    cmp_batch_func cmp_batch;
     void *params;
+    aug_func aug;
+    void *aug_params;
+    size_t aug_size;
+    interval_func interval;
+    size_t size;
+    size_t nodes_num;
+    bool_ty is_multiset;
+    str_key_func str_key;
+    arena_ty *arena;
+    node_ty ***pending;
+    size_t pending_num;
+    size_t pending_capacity;
+    cache_ty *cache;
+    filter_ty *filter;
+    index_ty *index;
+    size_t version;
+    node_ty *spares;
+    size_t spares_num;
+    size_t *clones;
+    balance_ty balance;
+    size_t rotations;
+    size_t dead_num;
+    size_t max_dead_percent;
+#ifdef AVL_LATENCY
+    latency_ty *latency;
+#endif
+};
+
+/* path holds the nodes still to visit whose left sub tree was
+   already passed, the top is the current node. the path is valid
+   while version is the version of avl, else the cursor seeks
+   past last, the element it returned last */
+struct avl_cursor
+{
+	const avl_ty *avl;
+	node_ty *path[CURSOR_DEPTH];
+	size_t depth;
+	size_t version;
+	void *last;
+	bool_ty is_positioned;
 };
 
+/* the rest of one tree in a diff. the top is either a whole sub tree
+   or a single node whose right sub tree is below it */
+typedef struct
+{
+	node_ty *nodes[DIFF_DEPTH];
+	bool_ty is_whole[DIFF_DEPTH];
+	size_t depth;
+} diff_side_ty;
+
+/* a searched element, with its key prefix in string keyed trees */
+typedef struct
+{
+	void *data;
+	unsigned long prefix[PREFIX_WORDS];
+} key_ty;
+
 typedef status_ty (*trav_func)(node_ty *, action_func, void *);
-typedef node_ty* (*balance_func)(node_ty *);
+typedef node_ty* (*balance_func)(avl_ty *, node_ty *);
 
-static node_ty * BalanceLL(node_ty *node);
-static node_ty * BalanceRR(node_ty *node);
-static node_ty * BalanceLR(node_ty *node);
-static node_ty * BalanceRL(node_ty *node);
+static node_ty * BalanceLL(avl_ty *avl, node_ty *node);
+static node_ty * BalanceRR(avl_ty *avl, node_ty *node);
+static node_ty * BalanceLR(avl_ty *avl, node_ty *node);
+static node_ty * BalanceRL(avl_ty *avl, node_ty *node);
 
 balance_func balance_funcs_lut[4] = {&BalanceLL, &BalanceRR, &BalanceLR, &BalanceRL};
 
@@ -57,15 +222,59 @@ static status_ty InOrder(node_ty *root, action_func action, void *params);
 static status_ty PreOrder(node_ty *root, action_func action, void *params);
 static status_ty PostOrder(node_ty *root, action_func action, void *params);
 
-static long UpdateAllHights(node_ty *root);
+static void UpdateNode(const avl_ty *avl, node_ty *node);
+
+static cache_entry_ty *GetCacheSet(const cache_ty *cache, unsigned long hash);
+static node_ty *CacheLookup(const avl_ty *avl, cache_entry_ty *set,
+							unsigned long hash, void *data);
+static void CacheStore(cache_entry_ty *set, unsigned long hash,
+											node_ty *node);
+static void CacheMove(cache_entry_ty *dest, const cache_entry_ty *src);
+static void CacheCount(size_t *counter);
+static void CacheInvalidate(cache_ty *cache, unsigned long hash);
+static void ClearCache(cache_ty *cache);
+
+static void FilterUpdate(filter_ty *filter, unsigned long hash, int diff);
+static bool_ty FilterMayHave(const filter_ty *filter, unsigned long hash);
+
+static status_ty IndexAdd(const avl_ty *avl, node_ty *node);
+static void IndexRemove(const avl_ty *avl, node_ty *node);
+static void IndexMove(const avl_ty *avl, node_ty *node, node_ty *moved);
+static node_ty *IndexLookup(const avl_ty *avl, void *data);
+static void ClearIndex(index_ty *index);
+
+static void RetainNode(node_ty *node);
+static bool_ty IsShared(node_ty *node);
+static bool_ty IsTreeShared(avl_ty *avl);
+static void CopyNode(const avl_ty *avl, node_ty *dest, node_ty *src);
+static node_ty *OwnNode(avl_ty *avl, node_ty *node);
+static status_ty ReserveSpares(avl_ty *avl);
+static status_ty AddSpares(avl_ty *avl, size_t needed);
+static node_ty *TakeSpare(avl_ty *avl);
+static void EndCompaction(avl_ty *avl);
+
+static status_ty RebuildLive(avl_ty *avl);
+
+static node_ty *WeakBalance(avl_ty *avl, node_ty *node);
+static node_ty *WeakInsertFix(avl_ty *avl, node_ty *node,
+							  avl_children_ty side);
+static node_ty *WeakRemoveFix(avl_ty *avl, node_ty *node,
+							  avl_children_ty side);
+static long RankDiff(node_ty *node, avl_children_ty side);
+static void AddRank(node_ty *node, long diff);
+static long MeasureHight(node_ty *node);
+
+#ifdef AVL_LATENCY
+static unsigned long ReadTicks(void);
+static size_t LatencyBucket(unsigned long ticks);
+static void LatencyRecord(latency_ty **latency, latency_op_ty op,
+										 unsigned long ticks);
+#endif
+static unsigned long LatencyBucketStart(size_t bucket);
 
-static int HaveLeftChild(node_ty *node);
-static int HaveRightChild(node_ty *node);
 static int HeightsDiff(node_ty *node);
-static int IsBalance(node_ty *node);
 static int LeftHigherOrEqualFromRight(node_ty *node);
 static int RightHigherOrEqualFromLeft(node_ty *node);
-static void SwapAndRemove(node_ty *rm_node, node_ty *swap_node_father, avl_children_ty side);
 
 trav_func travers_functions_lut[3] = {&InOrder, &PreOrder, &PostOrder};
 
@@ -75,27 +284,27 @@ trav_func travers_functions_lut[3] = {&InOrder, &PreOrder, &PostOrder};
 static void *GetData(node_ty *node)
 {
 	assert(NULL != node);
-	
+
 	return node->data;
 }
 
 static node_ty *GetRoot(const avl_ty *avl)
 {
 	assert(NULL != avl);
-	
+
 	return avl->root;
 }
 
 static node_ty **GetChildren(node_ty *node)
 {
 	assert(NULL != node);
-	
+
 	return node->childrens;
 }
 
 static long GetHight(node_ty *node)
 {
-	
+
 	if(NULL == node)
 	{
 		return -1;
@@ -103,697 +312,3105 @@ static long GetHight(node_ty *node)
 	return node->hight;
 }
 
+static void *GetAggregate(node_ty *node)
+{
+	if(NULL == node)
+	{
+		return NULL;
+	}
+	return (char *)node + sizeof(node_ty);
+}
+
+static unsigned long *GetPrefix(node_ty *node)
+{
+	assert(NULL != node);
+
+	return (unsigned long *)((char *)node + sizeof(node_ty));
+}
+
 static cmp_func GetCmp(const avl_ty *avl)
 {
 	assert(NULL != avl);
-	
+
 	return avl->cmp;
 }
 
 static void *GetParams(const avl_ty *avl)
 {
 	assert(NULL != avl);
-	
+
 	return avl->params;
 }
 
-static void SetData(node_ty *node, void *data)
+static void SetHight(node_ty *node, long hight)
 {
 	assert(NULL != node);
-	
-	node->data = data;
+
+	node->hight = hight;
 }
 
-static void SetHight(node_ty *node, long hight)
+
+/* pack the first bytes of the string big endian, so comparing the
+   words as integers orders them like strcmp */
+static void InitPrefix(unsigned long *prefix, const char *str)
 {
-	assert(NULL != node);
-	
-	node->hight = hight;
-} 
+	const unsigned char *byte = (const unsigned char *)str;
+	size_t i = 0;
+	size_t j = 0;
+
+	for(i = 0; i < PREFIX_WORDS; ++i)
+	{
+		prefix[i] = 0;
+		for(j = 0; j < sizeof(unsigned long); ++j)
+		{
+			prefix[i] <<= 8;
+			if('\0' != *byte)
+			{
+				prefix[i] |= *byte;
+				++byte;
+			}
+		}
+	}
+}
+
+static void InitKey(const avl_ty *avl, key_ty *key, void *data)
+{
+	key->data = data;
+	if(NULL != avl->str_key)
+	{
+		InitPrefix(key->prefix, avl->str_key(data, GetParams(avl)));
+	}
+}
+
+/* compare node with key, settled by the prefixes when they differ */
+static int CompareKey(const avl_ty *avl, node_ty *node, const key_ty *key)
+{
+	unsigned long *prefix = NULL;
+	size_t i = 0;
 
+	if(NULL != avl->str_key)
+	{
+		prefix = GetPrefix(node);
+		for(i = 0; i < PREFIX_WORDS; ++i)
+		{
+			if(prefix[i] != key->prefix[i])
+			{
+				return (prefix[i] < key->prefix[i]) ? -1 : 1;
+			}
+		}
+	}
 
-static node_ty *CreateNode(void *data , long hight)
+	return GetCmp(avl)(GetData(node), key->data, GetParams(avl));
+}
+
+
+static node_ty *CreateNode(const avl_ty *avl, void *data)
 {
-	node_ty *new_node = (node_ty*)malloc(sizeof(node_ty));
+	node_ty *new_node = (node_ty*)malloc(sizeof(node_ty) + avl->aug_size);
 	if(NULL == new_node)
 	{
 		return NULL;
 	}
 
 	new_node->data = data;
-	new_node->hight = hight;
+	new_node->hight = 0;
+	new_node->count = 1;
+	new_node->refs = 1;
 	new_node->childrens[LEFT] = NULL;
 	new_node->childrens[RIGHT] = NULL;
+	new_node->arena = NULL;
+	if(NULL != avl->str_key)
+	{
+		InitPrefix(GetPrefix(new_node), avl->str_key(data, GetParams(avl)));
+	}
+	UpdateNode(avl, new_node);
+	if(NULL != avl->index && SUCCESS != IndexAdd(avl, new_node))
+	{
+		free(new_node);
+		return NULL;
+	}
 
 	return new_node;
 }
 
+static void ReleaseArena(arena_ty *arena)
+{
+	if(0 == __sync_sub_and_fetch(&arena->live, 1))
+	{
+		free(arena);
+	}
+}
+
+static void FreeNode(node_ty *node)
+{
+	if(NULL == node->arena)
+	{
+		free(node);
+		return;
+	}
+	/* a running compaction may still look at the slot */
+	node->childrens[LEFT] = NULL;
+	node->childrens[RIGHT] = NULL;
+	ReleaseArena(node->arena);
+}
+
 
 avl_ty *AvlCreate(cmp_func cmp, void *params)
 {
 	avl_ty *new_avl = NULL;
-	node_ty *root = NULL;
-	
+
 	assert(NULL != cmp);
-	 
+
 	new_avl = (avl_ty*)malloc(sizeof(avl_ty));
 	if(NULL == new_avl)
 	{
 		return NULL;
 	}
-	
-	root = CreateNode(NULL, 0);
-	if(NULL == root)
-	{
-		free(new_avl);
-		return NULL;
-	}
-	new_avl->root = root;
+
+	new_avl->root = NULL;
 	new_avl->cmp = cmp;
+	new_avl->cmp_batch = NULL;
 	new_avl->params = params;
-	
+	new_avl->aug = NULL;
+	new_avl->aug_params = NULL;
+	new_avl->aug_size = 0;
+	new_avl->interval = NULL;
+	new_avl->size = 0;
+	new_avl->nodes_num = 0;
+	new_avl->is_multiset = FALSE;
+	new_avl->str_key = NULL;
+	new_avl->arena = NULL;
+	new_avl->pending = NULL;
+	new_avl->pending_num = 0;
+	new_avl->pending_capacity = 0;
+	new_avl->cache = NULL;
+	new_avl->filter = NULL;
+	new_avl->index = NULL;
+	new_avl->version = 0;
+	new_avl->spares = NULL;
+	new_avl->spares_num = 0;
+	new_avl->clones = NULL;
+	new_avl->balance = STRICT_AVL;
+	new_avl->rotations = 0;
+	new_avl->dead_num = 0;
+	new_avl->max_dead_percent = 0;
+#ifdef AVL_LATENCY
+	new_avl->latency = NULL;
+#endif
+
 	return new_avl;
 }
 
 
-static void RecursionDestroy(node_ty *root)
+avl_ty *AvlCreateWithPolicy(cmp_func cmp, void *params, balance_ty balance)
 {
-	if(NULL != GetChildren(root)[LEFT])
-	{
-		RecursionDestroy(GetChildren(root)[LEFT]);
-	}	
-	if(NULL != GetChildren(root)[RIGHT])
+	avl_ty *new_avl = AvlCreate(cmp, params);
+	if(NULL == new_avl)
 	{
-		RecursionDestroy(GetChildren(root)[RIGHT]);
+		return NULL;
 	}
-	free(root);
-	root = NULL;
-}
-
 
-void AvlDestroy(avl_ty *avl)
-{
-	assert(NULL != avl);
+	new_avl->balance = balance;
 
-	RecursionDestroy(avl->root);
-	free(avl);
-	avl = NULL;
+	return new_avl;
 }
 
-static avl_children_ty FindInsertSide(node_ty *node,
-									  void *data,
-									  cmp_func cmp,
-									   void *params)
-{
-	assert(NULL != node);
-	assert(NULL != cmp);
-	
-	return (0 > cmp(node->data, data, params)) ? RIGHT : LEFT;
-}
 
-static node_ty *SubTreeBalance(node_ty *sub_tree)
+avl_ty *AvlCreateAugmented(cmp_func cmp, void *params,
+                           aug_func aug, size_t aug_size)
 {
-	
-	UpdateAllHights(sub_tree);
-	
-	if(IsBalance(sub_tree))
-	{
-		return sub_tree;
-	}
+	avl_ty *new_avl = NULL;
 
-	
-	if(HeightsDiff(sub_tree) > 1 && 
-					LeftHigherOrEqualFromRight(GetChildren(sub_tree)[LEFT]))
-	{
-		return balance_funcs_lut[LL](sub_tree);
-	}
-	else if(HeightsDiff(sub_tree) > 1)
-	{
-		return balance_funcs_lut[LR](sub_tree);
-	}
-	
-	else if(HeightsDiff(sub_tree) < -1 &&
-				    RightHigherOrEqualFromLeft(GetChildren(sub_tree)[RIGHT]))
-	{
-		return balance_funcs_lut[RR](sub_tree);
-	}
-	else if(HeightsDiff(sub_tree) < -1)
+	assert(NULL != aug);
+	assert(0 < aug_size);
+	assert(AVL_AGGREGATE_MAX_SIZE >= aug_size);
+
+	new_avl = AvlCreate(cmp, params);
+	if(NULL == new_avl)
 	{
-		return balance_funcs_lut[RL](sub_tree);
+		return NULL;
 	}
-	
-	UpdateAllHights(sub_tree);
-	
-	return NULL;
+
+	/* keep the aggregate aligned like the node itself */
+	new_avl->aug = aug;
+	new_avl->aug_params = params;
+	new_avl->aug_size = (aug_size + sizeof(void *) - 1) &
+	                    ~(sizeof(void *) - 1);
+
+	return new_avl;
 }
 
 
-static node_ty *RecursiveInsert(node_ty *root,
-								 void *data,
-								 cmp_func cmp,
-								 void *params)
+avl_ty *AvlCreateMultiset(cmp_func cmp, void *params)
 {
-	node_ty *new_node = NULL;
-	node_ty *sub_tree = NULL;
-	
-	avl_children_ty which_side = FindInsertSide(root, data, cmp, params);
-	sub_tree = GetChildren(root)[which_side];
-	
-	if(NULL != sub_tree)
+	avl_ty *new_avl = AvlCreate(cmp, params);
+	if(NULL == new_avl)
 	{
-		RecursiveInsert(sub_tree, data, cmp, params);
-		root->childrens[which_side] = SubTreeBalance(sub_tree);
-		UpdateAllHights(root);
-		return root;
+		return NULL;
 	}
-	
-	else
-	{
-		new_node = CreateNode(data, 0);
-		if(NULL == new_node)
-		{
-			return NULL;
-		}
-		
-		GetChildren(root)[which_side] = new_node;
-		UpdateAllHights(root);
-		return root;
-	}	
+
+	new_avl->is_multiset = TRUE;
+
+	return new_avl;
 }
 
 
-status_ty AvlInsert(avl_ty *avl, void *data)
+avl_ty *AvlCreateString(cmp_func cmp, void *params, str_key_func str_key)
 {
-	node_ty *new_node = NULL;
-	assert(NULL != avl);
-	
-	if(NULL == GetData(GetRoot(avl)))
-	{
-		SetData(GetRoot(avl), data);
-		return SUCCESS;
-	}
-	new_node = RecursiveInsert(avl->root, data, avl->cmp, avl->params);
-	if(NULL == new_node)
+	avl_ty *new_avl = NULL;
+
+	assert(NULL != str_key);
+
+	new_avl = AvlCreate(cmp, params);
+	if(NULL == new_avl)
 	{
-		return FAIL;
+		return NULL;
 	}
-	avl->root = SubTreeBalance(GetRoot(avl));
-	UpdateAllHights(GetRoot(avl));
 
-	return SUCCESS;
+	new_avl->str_key = str_key;
+	new_avl->aug_size = PREFIX_WORDS * sizeof(unsigned long);
+
+	return new_avl;
 }
 
 
-static int HaveTwoChildrens(node_ty *node)
+avl_ty *AvlCreateBatch(cmp_func cmp, cmp_batch_func cmp_batch, void *params)
 {
-	return (NULL != GetChildren(node)[LEFT] &&
-			NULL != GetChildren(node)[RIGHT]);
-}
+	avl_ty *new_avl = NULL;
 
-static int HaveOneChildren(node_ty *node)
-{
-	return ((NULL != GetChildren(node)[LEFT] &&
-			NULL == GetChildren(node)[RIGHT])
-			||
-			(NULL == GetChildren(node)[LEFT] &&
-			NULL != GetChildren(node)[RIGHT]));
-}
+	assert(NULL != cmp_batch);
 
-static int IsLeaf(node_ty *node)
-{
-	assert(NULL != node);
-	
-	return (NULL == GetChildren(node)[LEFT] &&
-			NULL == GetChildren(node)[RIGHT]);
+	new_avl = AvlCreate(cmp, params);
+	if(NULL == new_avl)
+	{
+		return NULL;
+	}
+
+	new_avl->cmp_batch = cmp_batch;
+
+	return new_avl;
 }
 
 
-static size_t RecursionSize(node_ty *root)
+/* the aggregate of an interval tree is the max end in the sub tree */
+static void MaxEndAug(void *aggregate, const void *data,
+					  const void *left_aggregate,
+					  const void *right_aggregate,
+					  void *params)
 {
-	if(IsLeaf(root))
-	{
-		return 1;
-	}
-	if(HaveTwoChildrens(root))
+	const avl_ty *avl = (const avl_ty *)params;
+	long start = 0;
+	long max_end = 0;
+
+	avl->interval(data, &start, &max_end, GetParams(avl));
+
+	if(NULL != left_aggregate && *(const long *)left_aggregate > max_end)
 	{
-		return 1 + RecursionSize(GetChildren(root)[LEFT])
-							 + RecursionSize(GetChildren(root)[RIGHT]);
+		max_end = *(const long *)left_aggregate;
 	}
-	if(HaveOneChildren(root))
+	if(NULL != right_aggregate && *(const long *)right_aggregate > max_end)
 	{
-		return  (NULL == GetChildren(root)[LEFT]) ? 
-		1 + RecursionSize(GetChildren(root)[RIGHT]) : 
-		1 + RecursionSize(GetChildren(root)[LEFT]);
+		max_end = *(const long *)right_aggregate;
 	}
-	return 0;
-} 
+	*(long *)aggregate = max_end;
+}
 
 
-size_t AvlSize(const avl_ty *avl)
+avl_ty *AvlCreateInterval(cmp_func cmp, void *params, interval_func interval)
 {
-	assert(NULL != avl);
-	if(NULL == GetData(GetRoot(avl)))
+	avl_ty *new_avl = NULL;
+
+	assert(NULL != interval);
+
+	new_avl = AvlCreateAugmented(cmp, params, &MaxEndAug, sizeof(long));
+	if(NULL == new_avl)
 	{
-		return 0;
+		return NULL;
 	}
-	return RecursionSize(GetRoot(avl));
-}
 
-bool_ty AvlIsEmpty(const avl_ty *avl)
-{
-	assert(NULL != avl);
-	return (NULL == GetData(GetRoot(avl)));
+	new_avl->interval = interval;
+	new_avl->aug_params = new_avl;
+
+	return new_avl;
 }
 
 
-static avl_children_ty FindSearchSide(node_ty *root,
-										 void *data,
-										  cmp_func cmp,
-										   void *params)
+/* drop one reference to root, the last one frees the sub tree */
+static void RecursionDestroy(node_ty *root)
 {
-	assert(NULL != root);
-	assert(NULL != cmp);
-	
-	if(0 > cmp(GetData(root), data, params))
+	if(NULL == root || 0 != __sync_sub_and_fetch(&root->refs, 1))
 	{
-		return RIGHT;
+		return;
 	}
-	return LEFT;
+	RecursionDestroy(GetChildren(root)[LEFT]);
+	RecursionDestroy(GetChildren(root)[RIGHT]);
+	FreeNode(root);
 }
 
 
-static node_ty *RecursiveFind(node_ty *root, void *data, cmp_func cmp,
-																 void *params)
+void AvlDestroy(avl_ty *avl)
 {
-	avl_children_ty search_side = 0;
-	
-	assert(NULL != root);
-	assert(NULL != cmp);
-	
-	if(0 == cmp(GetData(root), data, params))
+	node_ty *next = NULL;
+
+	assert(NULL != avl);
+
+	RecursionDestroy(avl->root);
+	if(NULL != avl->clones && 0 == __sync_sub_and_fetch(avl->clones, 1))
 	{
-		return root;
+		free(avl->clones);
 	}
-	
-	search_side = FindSearchSide(root, data, cmp, params);
-	
-	if(NULL != GetChildren(root)[search_side])
+	if(NULL != avl->arena)
 	{
-		return RecursiveFind(GetChildren(root)[search_side], data, cmp, params);
+		ReleaseArena(avl->arena);
 	}
-	
-	return NULL;
+#ifdef AVL_LATENCY
+	free(avl->latency);
+#endif
+	free(avl->pending);
+	if(NULL != avl->cache)
+	{
+		free(avl->cache->entries);
+		free(avl->cache);
+	}
+	if(NULL != avl->filter)
+	{
+		free(avl->filter->counters);
+		free(avl->filter);
+	}
+	if(NULL != avl->index)
+	{
+		free(avl->index->entries);
+		free(avl->index);
+	}
+	while(NULL != avl->spares)
+	{
+		next = GetChildren(avl->spares)[LEFT];
+		free(avl->spares);
+		avl->spares = next;
+	}
+	free(avl);
+	avl = NULL;
 }
 
-
-status_ty AvlFind(const avl_ty *avl, void *data)
+static node_ty *SubTreeBalance(avl_ty *avl, node_ty *sub_tree)
 {
-	assert(NULL != avl);
-	
-	if(NULL == RecursiveFind(GetRoot(avl), data, GetCmp(avl), GetParams(avl)))
+	if(WEAK_AVL == avl->balance)
 	{
-		return FAIL;
+		return WeakBalance(avl, sub_tree);
 	}
-	return SUCCESS;
-}
 
+	UpdateNode(avl, sub_tree);
 
-static status_ty InOrder(node_ty *root, action_func action, void *params)
-{
-	status_ty status = SUCCESS;
-	assert(NULL != root);
-	assert(NULL != action);
-	
-	if(NULL != GetChildren(root)[LEFT])
+	if(HeightsDiff(sub_tree) > 1 &&
+					LeftHigherOrEqualFromRight(GetChildren(sub_tree)[LEFT]))
 	{
-		status |= InOrder(GetChildren(root)[LEFT], action, params);
+		return balance_funcs_lut[LL](avl, sub_tree);
 	}
-	
-	status = action(GetData(root), params);
-	
-	if(NULL != GetChildren(root)[RIGHT])
+	else if(HeightsDiff(sub_tree) > 1)
 	{
-		status |= InOrder(GetChildren(root)[RIGHT], action, params);
+		return balance_funcs_lut[LR](avl, sub_tree);
 	}
-	
-	return status;
-}
 
-
-static status_ty PreOrder(node_ty *root, action_func action, void *params)
-{
-	status_ty status = SUCCESS;
-	assert(NULL != root);
-	assert(NULL != action);
-	
-	status = action(GetData(root), params);
-	
-	if(NULL != GetChildren(root)[LEFT])
+	else if(HeightsDiff(sub_tree) < -1 &&
+				    RightHigherOrEqualFromLeft(GetChildren(sub_tree)[RIGHT]))
 	{
-		status |= PreOrder(GetChildren(root)[LEFT], action, params);
+		return balance_funcs_lut[RR](avl, sub_tree);
 	}
-	
-	if(NULL != GetChildren(root)[RIGHT])
+	else if(HeightsDiff(sub_tree) < -1)
 	{
-		status |= PreOrder(GetChildren(root)[RIGHT], action, params);
+		return balance_funcs_lut[RL](avl, sub_tree);
 	}
-	
-	return status;
 
+	return sub_tree;
 }
 
-static status_ty PostOrder(node_ty *root, action_func action, void *params)
+
+/* returns the new root of the sub tree, on allocation failure the sub tree
+   is returned unchanged and status is set to FAIL */
+static node_ty *RecursiveInsert(avl_ty *avl,
+								 node_ty *root,
+								 const key_ty *key,
+								 status_ty *status)
 {
-	status_ty status = SUCCESS;
-	assert(NULL != root);
-	assert(NULL != action);
-	
-	if(NULL != GetChildren(root)[LEFT])
+	int cmp_res = 0;
+	avl_children_ty which_side = LEFT;
+
+	if(NULL == root)
 	{
-		status |= PostOrder(GetChildren(root)[LEFT], action, params);
+		root = CreateNode(avl, key->data);
+		if(NULL == root)
+		{
+			*status = FAIL;
+			return NULL;
+		}
+		++avl->nodes_num;
+		return root;
 	}
-	
-	if(NULL != GetChildren(root)[RIGHT])
+
+	root = OwnNode(avl, root);
+	cmp_res = CompareKey(avl, root, key);
+	/* a lazy removed node takes the element back */
+	if(0 == cmp_res && 0 == root->count)
 	{
-		status |= PostOrder(GetChildren(root)[RIGHT], action, params);
+		root->data = key->data;
+		root->count = 1;
+		--avl->dead_num;
+		return root;
 	}
-	
-	status |= action(GetData(root), params);
-	
-	return status;
-
-}
+	if(avl->is_multiset && 0 == cmp_res)
+	{
+		++root->count;
+		return root;
+	}
+
+	which_side = (0 > cmp_res) ? RIGHT : LEFT;
+	GetChildren(root)[which_side] =
+	RecursiveInsert(avl, GetChildren(root)[which_side], key, status);
+
+	return SubTreeBalance(avl, root);
+}
+
+
+status_ty AvlInsert(avl_ty *avl, void *data)
+{
+	unsigned long start = LATENCY_START();
+	status_ty status = SUCCESS;
+	key_ty key;
+	assert(NULL != avl);
+
+	if(SUCCESS != ReserveSpares(avl))
+	{
+		LATENCY_END(avl, LATENCY_INSERT, start);
+		return FAIL;
+	}
+	InitKey(avl, &key, data);
+	avl->root = RecursiveInsert(avl, GetRoot(avl), &key, &status);
+	++avl->version;
+	if(SUCCESS == status)
+	{
+		++avl->size;
+		if(NULL != avl->filter)
+		{
+			FilterUpdate(avl->filter,
+						 avl->filter->hash(data, GetParams(avl)), 1);
+		}
+	}
+	LATENCY_END(avl, LATENCY_INSERT, start);
+
+	return status;
+}
+
+
+/* build a balanced sub tree of sorted[lo, hi), NULL with status FAIL
+   on allocation failure */
+static node_ty *BuildSorted(const avl_ty *avl, void **sorted,
+							size_t lo, size_t hi, status_ty *status)
+{
+	node_ty *root = NULL;
+	size_t mid = lo + (hi - lo) / 2;
+
+	if(lo == hi)
+	{
+		return NULL;
+	}
+
+	root = CreateNode(avl, sorted[mid]);
+	if(NULL == root)
+	{
+		*status = FAIL;
+		return NULL;
+	}
+	GetChildren(root)[LEFT] = BuildSorted(avl, sorted, lo, mid, status);
+	GetChildren(root)[RIGHT] = BuildSorted(avl, sorted, mid + 1, hi, status);
+	/* the left half is never smaller, and with the hights as ranks
+	   the tree is also a weak avl */
+	SetHight(root, 1 + GetHight(GetChildren(root)[LEFT]));
+	UpdateNode(avl, root);
+
+	return root;
+}
+
+
+status_ty AvlBulkLoad(avl_ty *avl, void **sorted, size_t n)
+{
+	status_ty status = SUCCESS;
+	size_t i = 0;
+
+	assert(NULL != avl);
+	assert(NULL == GetRoot(avl));
+	assert(0 == n || NULL != sorted);
+
+	/* equal elements of a multiset share one node */
+	if(avl->is_multiset)
+	{
+		for(i = 0; i < n && SUCCESS == status; ++i)
+		{
+			status = AvlInsert(avl, sorted[i]);
+		}
+		return status;
+	}
+
+	avl->root = BuildSorted(avl, sorted, 0, n, &status);
+	++avl->version;
+	if(SUCCESS != status)
+	{
+		RecursionDestroy(avl->root);
+		avl->root = NULL;
+		ClearIndex(avl->index);
+		return FAIL;
+	}
+	avl->size = n;
+	avl->nodes_num = n;
+	for(i = 0; i < n && NULL != avl->filter; ++i)
+	{
+		FilterUpdate(avl->filter,
+					 avl->filter->hash(sorted[i], GetParams(avl)), 1);
+	}
+
+	return SUCCESS;
+}
+
+
+static int HaveTwoChildrens(node_ty *node)
+{
+	return (NULL != GetChildren(node)[LEFT] &&
+			NULL != GetChildren(node)[RIGHT]);
+}
+
+
+size_t AvlSize(const avl_ty *avl)
+{
+	assert(NULL != avl);
+
+	return avl->size;
+}
+
+bool_ty AvlIsEmpty(const avl_ty *avl)
+{
+	assert(NULL != avl);
+	/* lazy removed nodes may still be in the tree */
+	return (0 == avl->size);
+}
+
+
+static node_ty *RecursiveFind(const avl_ty *avl, node_ty *root,
+											 const key_ty *key)
+{
+	int cmp_res = 0;
+
+	if(NULL == root)
+	{
+		return NULL;
+	}
+
+	cmp_res = CompareKey(avl, root, key);
+	if(0 == cmp_res)
+	{
+		return root;
+	}
+
+	return RecursiveFind(avl, GetChildren(root)[(0 > cmp_res) ? RIGHT : LEFT],
+																	 key);
+}
+
+
+/* find through the index or the cache when there is one */
+static node_ty *FindNode(const avl_ty *avl, void *data)
+{
+	cache_ty *cache = avl->cache;
+	cache_entry_ty *set = NULL;
+	unsigned long hash = 0;
+	node_ty *node = NULL;
+	key_ty key;
+
+	/* most misses end here without touching a node */
+	if(NULL != avl->filter &&
+	   !FilterMayHave(avl->filter, avl->filter->hash(data, GetParams(avl))))
+	{
+		return NULL;
+	}
+
+	if(NULL != avl->index)
+	{
+		node = IndexLookup(avl, data);
+		return (NULL == node || 0 == node->count) ? NULL : node;
+	}
+
+	if(NULL != cache)
+	{
+		hash = cache->hash(data, GetParams(avl));
+		set = GetCacheSet(cache, hash);
+		node = CacheLookup(avl, set, hash, data);
+		if(NULL != node)
+		{
+			CacheCount(&cache->hits);
+			return node;
+		}
+		CacheCount(&cache->misses);
+	}
+
+	InitKey(avl, &key, data);
+	node = RecursiveFind(avl, GetRoot(avl), &key);
+	if(NULL != node && 0 == node->count)
+	{
+		return NULL;
+	}
+	if(NULL != node && NULL != set)
+	{
+		CacheStore(set, hash, node);
+	}
+
+	return node;
+}
+
+
+status_ty AvlFind(const avl_ty *avl, void *data)
+{
+	unsigned long start = LATENCY_START();
+	node_ty *node = NULL;
+	assert(NULL != avl);
+
+	node = FindNode(avl, data);
+	LATENCY_END(avl, LATENCY_FIND, start);
+	if(NULL == node)
+	{
+		return FAIL;
+	}
+	return SUCCESS;
+}
+
+
+size_t AvlCount(const avl_ty *avl, void *data)
+{
+	node_ty *node = NULL;
+	assert(NULL != avl);
+
+	node = FindNode(avl, data);
+
+	return (NULL == node) ? 0 : node->count;
+}
+
+
+/* the elements of a batch find, permuted together */
+typedef struct
+{
+	void **datas;
+	size_t *indexes;
+	int *out;
+} batch_ty;
+
+static void CompareBatch(const avl_ty *avl, node_ty *node,
+						 const batch_ty *batch, size_t n)
+{
+	size_t i = 0;
+
+	if(NULL != avl->cmp_batch)
+	{
+		avl->cmp_batch(GetData(node), (const void **)batch->datas, n,
+										batch->out, GetParams(avl));
+		return;
+	}
+	for(i = 0; i < n; ++i)
+	{
+		batch->out[i] = GetCmp(avl)(GetData(node), batch->datas[i],
+													GetParams(avl));
+	}
+}
+
+static void SwapBatch(const batch_ty *batch, size_t i, size_t j)
+{
+	void *data = batch->datas[i];
+	size_t index = batch->indexes[i];
+	int out = batch->out[i];
+
+	batch->datas[i] = batch->datas[j];
+	batch->indexes[i] = batch->indexes[j];
+	batch->out[i] = batch->out[j];
+	batch->datas[j] = data;
+	batch->indexes[j] = index;
+	batch->out[j] = out;
+}
+
+/* split the batch in three: going left, found, going right */
+static void RecursiveFindBatch(const avl_ty *avl, node_ty *root,
+							   const batch_ty *batch, size_t n,
+							   bool_ty *found)
+{
+	batch_ty right;
+	size_t lo = 0;
+	size_t mid = 0;
+	size_t hi = n;
+
+	if(NULL == root || 0 == n)
+	{
+		return;
+	}
+
+	CompareBatch(avl, root, batch, n);
+	while(mid < hi)
+	{
+		if(0 < batch->out[mid])
+		{
+			SwapBatch(batch, lo, mid);
+			++lo;
+			++mid;
+		}
+		else if(0 == batch->out[mid])
+		{
+			found[batch->indexes[mid]] = (0 != root->count);
+			++mid;
+		}
+		else
+		{
+			--hi;
+			SwapBatch(batch, mid, hi);
+		}
+	}
+
+	right.datas = batch->datas + hi;
+	right.indexes = batch->indexes + hi;
+	right.out = batch->out + hi;
+	RecursiveFindBatch(avl, GetChildren(root)[LEFT], batch, lo, found);
+	RecursiveFindBatch(avl, GetChildren(root)[RIGHT], &right, n - hi, found);
+}
+
+
+status_ty AvlFindBatch(const avl_ty *avl, void **datas, size_t n,
+													 bool_ty *found)
+{
+	batch_ty batch;
+	size_t batch_size = 0;
+	size_t i = 0;
+
+	assert(NULL != avl);
+	assert(0 == n || (NULL != datas && NULL != found));
+
+	for(i = 0; i < n; ++i)
+	{
+		found[i] = FALSE;
+	}
+
+	/* prefixes decide most compares of string keys, and the index
+	   needs no walk */
+	if(NULL != avl->str_key || NULL != avl->index)
+	{
+		for(i = 0; i < n; ++i)
+		{
+			found[i] = (NULL != FindNode(avl, datas[i]));
+		}
+		return SUCCESS;
+	}
+
+	batch.datas = (void **)malloc(n * (sizeof(void *) + sizeof(size_t) +
+										sizeof(int)) + 1);
+	if(NULL == batch.datas)
+	{
+		return FAIL;
+	}
+	batch.indexes = (size_t *)(batch.datas + n);
+	batch.out = (int *)(batch.indexes + n);
+
+	for(i = 0; i < n; ++i)
+	{
+		if(NULL == avl->filter ||
+		   FilterMayHave(avl->filter, avl->filter->hash(datas[i],
+														GetParams(avl))))
+		{
+			batch.datas[batch_size] = datas[i];
+			batch.indexes[batch_size] = i;
+			++batch_size;
+		}
+	}
+	RecursiveFindBatch(avl, GetRoot(avl), &batch, batch_size, found);
+	free(batch.datas);
+
+	return SUCCESS;
+}
+
+
+/* the traversals stop at the first action that returns non zero */
+static status_ty InOrder(node_ty *root, action_func action, void *params)
+{
+	assert(NULL != root);
+	assert(NULL != action);
+
+	if(NULL != GetChildren(root)[LEFT] &&
+	   SUCCESS != InOrder(GetChildren(root)[LEFT], action, params))
+	{
+		return FAIL;
+	}
+
+	if(0 != root->count && 0 != action(GetData(root), params))
+	{
+		return FAIL;
+	}
+
+	if(NULL != GetChildren(root)[RIGHT])
+	{
+		return InOrder(GetChildren(root)[RIGHT], action, params);
+	}
+
+	return SUCCESS;
+}
+
+
+static status_ty PreOrder(node_ty *root, action_func action, void *params)
+{
+	assert(NULL != root);
+	assert(NULL != action);
+
+	if(0 != root->count && 0 != action(GetData(root), params))
+	{
+		return FAIL;
+	}
+
+	if(NULL != GetChildren(root)[LEFT] &&
+	   SUCCESS != PreOrder(GetChildren(root)[LEFT], action, params))
+	{
+		return FAIL;
+	}
+
+	if(NULL != GetChildren(root)[RIGHT])
+	{
+		return PreOrder(GetChildren(root)[RIGHT], action, params);
+	}
+
+	return SUCCESS;
+}
+
+static status_ty PostOrder(node_ty *root, action_func action, void *params)
+{
+	assert(NULL != root);
+	assert(NULL != action);
+
+	if(NULL != GetChildren(root)[LEFT] &&
+	   SUCCESS != PostOrder(GetChildren(root)[LEFT], action, params))
+	{
+		return FAIL;
+	}
+
+	if(NULL != GetChildren(root)[RIGHT] &&
+	   SUCCESS != PostOrder(GetChildren(root)[RIGHT], action, params))
+	{
+		return FAIL;
+	}
+
+	if(0 != root->count && 0 != action(GetData(root), params))
+	{
+		return FAIL;
+	}
+
+	return SUCCESS;
+}
+
+status_ty AvlForEach(avl_ty *avl, action_func action, void *params,trav_ty trav)
+{
+	unsigned long start = LATENCY_START();
+	status_ty status = SUCCESS;
+	assert(NULL != avl);
+	assert(NULL != action);
+
+	if(!AvlIsEmpty(avl))
+	{
+		status = travers_functions_lut[trav](GetRoot(avl), action, params);
+	}
+	LATENCY_END(avl, LATENCY_FOREACH, start);
+
+	return status;
+}
+
+
+/*--------------- cursors ------------*/
+
+avl_cursor_ty *AvlCursorCreate(const avl_ty *avl)
+{
+	avl_cursor_ty *cursor = NULL;
+
+	assert(NULL != avl);
+
+	cursor = (avl_cursor_ty *)malloc(sizeof(avl_cursor_ty));
+	if(NULL == cursor)
+	{
+		return NULL;
+	}
+
+	cursor->avl = avl;
+	cursor->depth = 0;
+	cursor->version = avl->version;
+	cursor->last = NULL;
+	cursor->is_positioned = FALSE;
+
+	return cursor;
+}
+
+
+void AvlCursorDestroy(avl_cursor_ty *cursor)
+{
+	free(cursor);
+}
+
+
+static void PushMostLeft(avl_cursor_ty *cursor, node_ty *node)
+{
+	while(NULL != node)
+	{
+		assert(CURSOR_DEPTH > cursor->depth);
+		cursor->path[cursor->depth] = node;
+		++cursor->depth;
+		node = GetChildren(node)[LEFT];
+	}
+}
+
+
+/* remember the current element, for a seek after avl changes.
+   lazy removed nodes are passed over first */
+static void *SetPosition(avl_cursor_ty *cursor)
+{
+	node_ty *node = NULL;
+
+	while(0 != cursor->depth && 0 == cursor->path[cursor->depth - 1]->count)
+	{
+		--cursor->depth;
+		node = cursor->path[cursor->depth];
+		PushMostLeft(cursor, GetChildren(node)[RIGHT]);
+	}
+
+	cursor->version = cursor->avl->version;
+	cursor->is_positioned = TRUE;
+	cursor->last = (0 == cursor->depth) ? NULL :
+				   GetData(cursor->path[cursor->depth - 1]);
+
+	return cursor->last;
+}
+
+
+void *AvlCursorGet(const avl_cursor_ty *cursor)
+{
+	assert(NULL != cursor);
+
+	return cursor->last;
+}
+
+
+void *AvlCursorFirst(avl_cursor_ty *cursor)
+{
+	assert(NULL != cursor);
+
+	cursor->depth = 0;
+	PushMostLeft(cursor, GetRoot(cursor->avl));
+
+	return SetPosition(cursor);
+}
+
+
+void *AvlCursorSeek(avl_cursor_ty *cursor, void *data)
+{
+	const avl_ty *avl = NULL;
+	node_ty *node = NULL;
+	key_ty key;
+
+	assert(NULL != cursor);
+
+	avl = cursor->avl;
+	InitKey(avl, &key, data);
+	cursor->depth = 0;
+
+	node = GetRoot(avl);
+	while(NULL != node)
+	{
+		if(0 <= CompareKey(avl, node, &key))
+		{
+			assert(CURSOR_DEPTH > cursor->depth);
+			cursor->path[cursor->depth] = node;
+			++cursor->depth;
+			node = GetChildren(node)[LEFT];
+		}
+		else
+		{
+			node = GetChildren(node)[RIGHT];
+		}
+	}
+
+	return SetPosition(cursor);
+}
+
+
+void *AvlCursorNext(avl_cursor_ty *cursor)
+{
+	node_ty *node = NULL;
+	void *last = NULL;
+	key_ty key;
+
+	assert(NULL != cursor);
+
+	if(0 == cursor->depth)
+	{
+		return NULL;
+	}
+
+	/* the path may hold moved or freed nodes, find the way again */
+	if(cursor->version != cursor->avl->version)
+	{
+		last = cursor->last;
+		InitKey(cursor->avl, &key, last);
+		AvlCursorSeek(cursor, last);
+		while(0 != cursor->depth &&
+			  0 == CompareKey(cursor->avl, cursor->path[cursor->depth - 1],
+																	&key))
+		{
+			AvlCursorNext(cursor);
+		}
+		return SetPosition(cursor);
+	}
+
+	--cursor->depth;
+	node = cursor->path[cursor->depth];
+	PushMostLeft(cursor, GetChildren(node)[RIGHT]);
+
+	return SetPosition(cursor);
+}
+
+
+status_ty AvlForEachBudget(avl_ty *avl, avl_cursor_ty *state,
+						   action_func action, void *params,
+						   size_t max_nodes, bool_ty *is_done)
+{
+	void *data = NULL;
+	size_t visited = 0;
+
+	assert(NULL != avl);
+	assert(NULL != state);
+	assert(avl == state->avl);
+	assert(NULL != action);
+	assert(0 < max_nodes);
+	assert(NULL != is_done);
+
+	*is_done = FALSE;
+	data = state->is_positioned ? AvlCursorNext(state) :
+								  AvlCursorFirst(state);
+	while(NULL != data)
+	{
+		++visited;
+		if(0 != action(data, params))
+		{
+			*is_done = TRUE;
+			return FAIL;
+		}
+		if(visited == max_nodes)
+		{
+			return SUCCESS;
+		}
+		data = AvlCursorNext(state);
+	}
+	*is_done = TRUE;
+
+	return SUCCESS;
+}
+
+
+/* detach the most left node of the sub tree, returns the new sub tree root */
+static node_ty *RemoveMostLeft(avl_ty *avl, node_ty *root,
+										   node_ty **most_left)
+{
+	root = OwnNode(avl, root);
+	if(NULL == GetChildren(root)[LEFT])
+	{
+		*most_left = root;
+		return GetChildren(root)[RIGHT];
+	}
+
+	GetChildren(root)[LEFT] =
+	RemoveMostLeft(avl, GetChildren(root)[LEFT], most_left);
+
+	return SubTreeBalance(avl, root);
+}
+
+
+static node_ty *RemoveNode(avl_ty *avl, node_ty *rm_node)
+{
+	node_ty *next = NULL;
+	node_ty *right_sub_tree = NULL;
+
+	if(NULL != avl->index)
+	{
+		IndexRemove(avl, rm_node);
+	}
+	--avl->nodes_num;
+
+	if(!HaveTwoChildrens(rm_node))
+	{
+		next = (NULL == GetChildren(rm_node)[LEFT]) ?
+		GetChildren(rm_node)[RIGHT] :
+		GetChildren(rm_node)[LEFT];
+
+		FreeNode(rm_node);
+		return next;
+	}
+
+	/* rm_node have two childrens - the next node takes its place */
+	right_sub_tree = RemoveMostLeft(avl, GetChildren(rm_node)[RIGHT], &next);
+	GetChildren(next)[LEFT] = GetChildren(rm_node)[LEFT];
+	GetChildren(next)[RIGHT] = right_sub_tree;
+	SetHight(next, GetHight(rm_node));
+	FreeNode(rm_node);
+
+	return SubTreeBalance(avl, next);
+}
+
+
+/* mark the node of key dead, the tree keeps its shape */
+static node_ty *RecursiveMarkDead(avl_ty *avl, node_ty *root,
+								  const key_ty *key, bool_ty *found)
+{
+	int cmp_res = 0;
+	avl_children_ty search_side = LEFT;
+
+	if(NULL == root)
+	{
+		return NULL;
+	}
+
+	root = OwnNode(avl, root);
+	cmp_res = CompareKey(avl, root, key);
+	if(0 == cmp_res)
+	{
+		if(0 < root->count)
+		{
+			*found = TRUE;
+			--root->count;
+			avl->dead_num += (0 == root->count);
+		}
+		return root;
+	}
+
+	search_side = (0 > cmp_res) ? RIGHT : LEFT;
+	GetChildren(root)[search_side] =
+	RecursiveMarkDead(avl, GetChildren(root)[search_side], key, found);
+
+	return root;
+}
+
+
+static node_ty *RecursiveRemove(avl_ty *avl, node_ty *root,
+								const key_ty *key, bool_ty *found)
+{
+	int cmp_res = 0;
+	avl_children_ty search_side = LEFT;
+
+	if(NULL == root)
+	{
+		return NULL;
+	}
+
+	root = OwnNode(avl, root);
+	cmp_res = CompareKey(avl, root, key);
+	if(0 == cmp_res)
+	{
+		*found = TRUE;
+		if(1 < root->count)
+		{
+			--root->count;
+			return root;
+		}
+		return RemoveNode(avl, root);
+	}
+
+	search_side = (0 > cmp_res) ? RIGHT : LEFT;
+	GetChildren(root)[search_side] =
+	RecursiveRemove(avl, GetChildren(root)[search_side], key, found);
+
+	return SubTreeBalance(avl, root);
+}
+
+
+status_ty AvlRemove(avl_ty *avl, void *data)
+{
+	unsigned long start = LATENCY_START();
+	bool_ty found = FALSE;
+	key_ty key;
+	assert(NULL != avl);
+
+	/* a missing element would still copy the shared nodes on its path */
+	if(IsTreeShared(avl) && NULL == FindNode(avl, data))
+	{
+		LATENCY_END(avl, LATENCY_REMOVE, start);
+		return SUCCESS;
+	}
+	if(SUCCESS != ReserveSpares(avl))
+	{
+		LATENCY_END(avl, LATENCY_REMOVE, start);
+		return FAIL;
+	}
+	if(NULL != avl->cache)
+	{
+		CacheInvalidate(avl->cache, avl->cache->hash(data, GetParams(avl)));
+	}
+	InitKey(avl, &key, data);
+	if(0 != avl->max_dead_percent)
+	{
+		avl->root = RecursiveMarkDead(avl, GetRoot(avl), &key, &found);
+	}
+	else
+	{
+		avl->root = RecursiveRemove(avl, GetRoot(avl), &key, &found);
+	}
+	++avl->version;
+	if(found)
+	{
+		--avl->size;
+		if(NULL != avl->filter)
+		{
+			FilterUpdate(avl->filter,
+						 avl->filter->hash(data, GetParams(avl)), -1);
+		}
+	}
+	/* a failed rebuild is tried again by the next remove */
+	if(found && 0 != avl->max_dead_percent &&
+	   (0 == avl->size || avl->dead_num * 100 >
+						  avl->max_dead_percent * (avl->size + avl->dead_num)))
+	{
+		RebuildLive(avl);
+	}
+	LATENCY_END(avl, LATENCY_REMOVE, start);
+
+	return SUCCESS;
+}
+
+
+/* recompute the hight and the aggregate of node from its childrens.
+   the ranks of a WEAK_AVL tree are kept by WeakBalance */
+static void UpdateNode(const avl_ty *avl, node_ty *node)
+{
+	long left_subtree_hight = 0;
+	long right_subtree_hight = 0;
+	assert(NULL != node);
+
+	if(WEAK_AVL != avl->balance)
+	{
+		left_subtree_hight = GetHight(GetChildren(node)[LEFT]);
+		right_subtree_hight = GetHight(GetChildren(node)[RIGHT]);
+
+		SetHight(node, 1 + ((left_subtree_hight >= right_subtree_hight) ?
+								 left_subtree_hight : right_subtree_hight));
+	}
+
+	if(NULL != avl->aug)
+	{
+		avl->aug(GetAggregate(node), GetData(node),
+				 GetAggregate(GetChildren(node)[LEFT]),
+				 GetAggregate(GetChildren(node)[RIGHT]),
+				 avl->aug_params);
+	}
+}
+
+
+long AvlHeight(const avl_ty *avl)
+{
+	assert(NULL != avl);
+
+	if(AvlIsEmpty(avl))
+	{
+		return 0;
+	}
+	if(WEAK_AVL == avl->balance)
+	{
+		return MeasureHight(GetRoot(avl));
+	}
+	return GetHight(GetRoot(avl));
+}
+
+
+static long MeasureHight(node_ty *node)
+{
+	long left_hight = 0;
+	long right_hight = 0;
+
+	if(NULL == node)
+	{
+		return -1;
+	}
+	left_hight = MeasureHight(GetChildren(node)[LEFT]);
+	right_hight = MeasureHight(GetChildren(node)[RIGHT]);
+
+	return 1 + ((left_hight >= right_hight) ? left_hight : right_hight);
+}
+
+
+size_t AvlGetRotations(const avl_ty *avl)
+{
+	assert(NULL != avl);
+
+	return avl->rotations;
+}
+
+
+/*--------------- latency ------------*/
+
+#ifdef AVL_LATENCY
+static unsigned long ReadTicks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return (unsigned long)__rdtsc();
+#else
+	return (unsigned long)clock();
+#endif
+}
+
+/* small times have a bucket each, then each power of 2 gets
+   LATENCY_SUBS buckets by the bits below its highest bit */
+static size_t LatencyBucket(unsigned long ticks)
+{
+	int top_bit = 0;
+
+	if(LATENCY_SUBS > ticks)
+	{
+		return (size_t)ticks;
+	}
+	top_bit = (int)(sizeof(unsigned long) * CHAR_BIT) - 1 - __builtin_clzl(ticks);
+
+	return (size_t)(top_bit - LATENCY_SUB_BITS + 1) * LATENCY_SUBS +
+		   ((ticks >> (top_bit - LATENCY_SUB_BITS)) & (LATENCY_SUBS - 1));
+}
+
+/* latency points to the histograms of the tree. finds of other
+   threads may record at the same time, so the first one to allocate
+   them publishes them and the others free their copy */
+static void LatencyRecord(latency_ty **latency, latency_op_ty op,
+										 unsigned long ticks)
+{
+	static __thread size_t thread_slot = 0;
+	static size_t threads_num = 0;
+	latency_ty *histograms = __atomic_load_n(latency, __ATOMIC_ACQUIRE);
+
+	if(NULL == histograms)
+	{
+		histograms = (latency_ty *)calloc(1, sizeof(latency_ty));
+		if(NULL == histograms)
+		{
+			return;
+		}
+		if(!__sync_bool_compare_and_swap(latency, NULL, histograms))
+		{
+			free(histograms);
+			histograms = __atomic_load_n(latency, __ATOMIC_ACQUIRE);
+		}
+	}
+	if(0 == thread_slot)
+	{
+		thread_slot = __sync_add_and_fetch(&threads_num, 1);
+	}
+	__atomic_fetch_add(&histograms->counts[(thread_slot - 1) % LATENCY_SLOTS]
+					   [op][LatencyBucket(ticks)], 1, __ATOMIC_RELAXED);
+}
+#endif
+
+static unsigned long LatencyBucketStart(size_t bucket)
+{
+	int top_bit = 0;
+
+	if(LATENCY_SUBS > bucket)
+	{
+		return (unsigned long)bucket;
+	}
+	top_bit = (int)(bucket / LATENCY_SUBS) + LATENCY_SUB_BITS - 1;
+
+	return (unsigned long)(LATENCY_SUBS + bucket % LATENCY_SUBS) <<
+										(top_bit - LATENCY_SUB_BITS);
+}
+
+
+status_ty AvlGetLatencyHistogram(const avl_ty *avl, latency_op_ty op,
+								 avl_histogram_ty *hist)
+{
+#ifdef AVL_LATENCY
+	latency_ty *latency = NULL;
+	size_t slot = 0;
+	size_t i = 0;
+#endif
+
+	assert(NULL != avl);
+	assert(LATENCY_OPS_NUM > op);
+	assert(NULL != hist);
+
+	memset(hist, 0, sizeof(avl_histogram_ty));
+#ifdef AVL_LATENCY
+	latency = __atomic_load_n(&avl->latency, __ATOMIC_ACQUIRE);
+	for(slot = 0; slot < LATENCY_SLOTS && NULL != latency; ++slot)
+	{
+		for(i = 0; i < AVL_LATENCY_BUCKETS; ++i)
+		{
+			hist->counts[i] += __atomic_load_n(
+						&latency->counts[slot][op][i], __ATOMIC_RELAXED);
+		}
+	}
+	for(i = 0; i < AVL_LATENCY_BUCKETS; ++i)
+	{
+		hist->total += hist->counts[i];
+	}
+
+	return SUCCESS;
+#else
+	(void)op;
+
+	return FAIL;
+#endif
+}
+
+
+void AvlResetLatency(avl_ty *avl)
+{
+	assert(NULL != avl);
+
+#ifdef AVL_LATENCY
+	if(NULL != avl->latency)
+	{
+		memset(avl->latency, 0, sizeof(latency_ty));
+	}
+#endif
+}
+
+
+unsigned long AvlLatencyPercentile(const avl_histogram_ty *hist,
+								   double percentile)
+{
+	double needed = 0;
+	size_t seen = 0;
+	size_t i = 0;
+
+	assert(NULL != hist);
+	assert(0 <= percentile && 100 >= percentile);
+
+	if(0 == hist->total)
+	{
+		return 0;
+	}
+
+	needed = hist->total * percentile / 100;
+	for(i = 0; i < AVL_LATENCY_BUCKETS - 1; ++i)
+	{
+		seen += hist->counts[i];
+		if(0 < seen && seen >= needed)
+		{
+			break;
+		}
+	}
+
+	return LatencyBucketStart(i + 1) - 1;
+}
+
+
+/*--------------- augmentation ------------*/
+
+/* aggregate of the elements >= lo in the sub tree, returns 0 if none */
+static int SuffixAggregate(const avl_ty *avl, node_ty *root, const void *lo,
+											void *out, char *scratch)
+{
+	int have_left = 0;
+
+	while(NULL != root &&
+		  0 > GetCmp(avl)(GetData(root), lo, GetParams(avl)))
+	{
+		root = GetChildren(root)[RIGHT];
+	}
+	if(NULL == root)
+	{
+		return 0;
+	}
+
+	have_left = SuffixAggregate(avl, GetChildren(root)[LEFT], lo,
+									scratch, scratch + avl->aug_size);
+	avl->aug(out, GetData(root), have_left ? scratch : NULL,
+			 GetAggregate(GetChildren(root)[RIGHT]), avl->aug_params);
+
+	return 1;
+}
+
+/* aggregate of the elements <= hi in the sub tree, returns 0 if none */
+static int PrefixAggregate(const avl_ty *avl, node_ty *root, const void *hi,
+											void *out, char *scratch)
+{
+	int have_right = 0;
+
+	while(NULL != root &&
+		  0 < GetCmp(avl)(GetData(root), hi, GetParams(avl)))
+	{
+		root = GetChildren(root)[LEFT];
+	}
+	if(NULL == root)
+	{
+		return 0;
+	}
+
+	have_right = PrefixAggregate(avl, GetChildren(root)[RIGHT], hi,
+									scratch, scratch + avl->aug_size);
+	avl->aug(out, GetData(root), GetAggregate(GetChildren(root)[LEFT]),
+			 have_right ? scratch : NULL, avl->aug_params);
+
+	return 1;
+}
+
+
+status_ty AvlAggregateRange(const avl_ty *avl, const void *lo,
+                            const void *hi, void *out)
+{
+	/* left result, right result, and one buffer per level below split */
+	void *buffers[(2 + CURSOR_DEPTH) * AGGREGATE_WORDS];
+	char *scratch = (char *)buffers;
+	node_ty *split = NULL;
+	int have_left = 0;
+	int have_right = 0;
+	size_t size = 0;
+
+	assert(NULL != avl);
+	assert(NULL != avl->aug);
+	assert(NULL != out);
+
+	/* find the highest node inside [lo, hi] */
+	split = GetRoot(avl);
+	while(NULL != split)
+	{
+		if(0 > GetCmp(avl)(GetData(split), lo, GetParams(avl)))
+		{
+			split = GetChildren(split)[RIGHT];
+		}
+		else if(0 < GetCmp(avl)(GetData(split), hi, GetParams(avl)))
+		{
+			split = GetChildren(split)[LEFT];
+		}
+		else
+		{
+			break;
+		}
+	}
+	if(NULL == split)
+	{
+		return FAIL;
+	}
+
+	size = avl->aug_size;
+	assert(CURSOR_DEPTH >= GetHight(split));
+
+	have_left = SuffixAggregate(avl, GetChildren(split)[LEFT], lo,
+								scratch, scratch + 2 * size);
+	have_right = PrefixAggregate(avl, GetChildren(split)[RIGHT], hi,
+								 scratch + size, scratch + 2 * size);
+	avl->aug(out, GetData(split), have_left ? scratch : NULL,
+			 have_right ? scratch + size : NULL, avl->aug_params);
+
+	return SUCCESS;
+}
+
+
+/*--------------- interval tree ------------*/
+
+/* report the intervals [start, end) with start <= last and end > lo */
+static status_ty RecursiveOverlap(const avl_ty *avl, node_ty *root,
+								  long lo, long last,
+								  action_func action, void *params)
+{
+	long start = 0;
+	long end = 0;
+
+	if(NULL == root || *(long *)GetAggregate(root) <= lo)
+	{
+		return SUCCESS;
+	}
+
+	if(SUCCESS != RecursiveOverlap(avl, GetChildren(root)[LEFT],
+									   lo, last, action, params))
+	{
+		return FAIL;
+	}
+
+	avl->interval(GetData(root), &start, &end, GetParams(avl));
+	if(start > last)
+	{
+		/* the right sub tree starts even later */
+		return SUCCESS;
+	}
+	if(end > lo && 0 != action(GetData(root), params))
+	{
+		return FAIL;
+	}
+
+	return RecursiveOverlap(avl, GetChildren(root)[RIGHT],
+							lo, last, action, params);
+}
+
+
+status_ty AvlIntervalStab(const avl_ty *avl, long point,
+                          action_func action, void *params)
+{
+	assert(NULL != avl);
+	assert(NULL != avl->interval);
+	assert(NULL != action);
+
+	return RecursiveOverlap(avl, GetRoot(avl), point, point, action, params);
+}
+
+
+status_ty AvlIntervalOverlap(const avl_ty *avl, long lo, long hi,
+                             action_func action, void *params)
+{
+	assert(NULL != avl);
+	assert(NULL != avl->interval);
+	assert(NULL != action);
+
+	if(hi <= lo)
+	{
+		return SUCCESS;
+	}
+
+	return RecursiveOverlap(avl, GetRoot(avl), lo, hi - 1, action, params);
+}
+
+
+/*--------------- compaction ------------*/
+
+static size_t GetNodeSize(const avl_ty *avl)
+{
+	return sizeof(node_ty) + avl->aug_size;
+}
+
+static status_ty PushPending(avl_ty *avl, node_ty **link)
+{
+	node_ty ***pending = NULL;
+	size_t capacity = 0;
+
+	if(avl->pending_num == avl->pending_capacity)
+	{
+		capacity = (0 == avl->pending_capacity) ? COMPACT_PENDING_INIT :
+												  2 * avl->pending_capacity;
+		pending = (node_ty ***)realloc(avl->pending,
+									   capacity * sizeof(node_ty **));
+		if(NULL == pending)
+		{
+			return FAIL;
+		}
+		avl->pending = pending;
+		avl->pending_capacity = capacity;
+	}
+
+	avl->pending[avl->pending_num] = link;
+	++avl->pending_num;
+
+	return SUCCESS;
+}
+
+/* move the node at link to the next free slot of the arena */
+static void MoveNode(avl_ty *avl, node_ty **link)
+{
+	arena_ty *arena = avl->arena;
+	node_ty *node = *link;
+	node_ty *slot = NULL;
+
+	if(node->arena == arena)
+	{
+		return;
+	}
+
+	slot = (node_ty *)((char *)arena + sizeof(arena_ty) +
+					   arena->used * GetNodeSize(avl));
+	CopyNode(avl, slot, node);
+	slot->arena = arena;
+	++arena->used;
+	__sync_fetch_and_add(&arena->live, 1);
+	if(NULL != avl->index)
+	{
+		IndexMove(avl, node, slot);
+	}
+
+	*link = slot;
+	if(!IsShared(node))
+	{
+		FreeNode(node);
+		return;
+	}
+	/* a clone keeps the node, and both point to the childrens */
+	RetainNode(GetChildren(slot)[LEFT]);
+	RetainNode(GetChildren(slot)[RIGHT]);
+	RecursionDestroy(node);
+}
+
+/* lay out the top levels of the sub tree at link breadth first,
+   and leave the sub trees under them pending. pending links are
+   always inside the arena, which is not freed while it is filled */
+static status_ty CompactBlock(avl_ty *avl, node_ty **link)
+{
+	node_ty **block[COMPACT_BLOCK_NODES];
+	int depths[COMPACT_BLOCK_NODES];
+	node_ty **cut[COMPACT_BLOCK_NODES + 1];
+	node_ty **child = NULL;
+	int block_num = 1;
+	int cut_num = 0;
+	int i = 0;
+	int side = 0;
+
+	block[0] = link;
+	depths[0] = 1;
+
+	for(i = 0; i < block_num; ++i)
+	{
+		/* the nodes inserted since the start have no slot left */
+		if(NULL == *block[i] || avl->arena->used == avl->arena->capacity)
+		{
+			continue;
+		}
+		MoveNode(avl, block[i]);
+		for(side = LEFT; side < CHILDREN_NUM; ++side)
+		{
+			child = &GetChildren(*block[i])[side];
+			if(NULL == *child)
+			{
+				continue;
+			}
+			if(COMPACT_BLOCK_DEPTH > depths[i])
+			{
+				block[block_num] = child;
+				depths[block_num] = depths[i] + 1;
+				++block_num;
+			}
+			else
+			{
+				cut[cut_num] = child;
+				++cut_num;
+			}
+		}
+	}
+
+	/* the most left sub tree is popped first */
+	while(0 < cut_num)
+	{
+		--cut_num;
+		if(SUCCESS != PushPending(avl, cut[cut_num]))
+		{
+			return FAIL;
+		}
+	}
+
+	return SUCCESS;
+}
+
+/* the arena has a slot for each node, lazy removed nodes and the
+   nodes of multiset elements included */
+static status_ty StartCompaction(avl_ty *avl)
+{
+	arena_ty *arena = (arena_ty *)malloc(sizeof(arena_ty) +
+										 avl->nodes_num * GetNodeSize(avl));
+	if(NULL == arena)
+	{
+		return FAIL;
+	}
+
+	arena->live = 1;
+	arena->used = 0;
+	arena->capacity = avl->nodes_num;
+	avl->arena = arena;
+	avl->pending_num = 0;
+
+	return SUCCESS;
+}
+
+static void EndCompaction(avl_ty *avl)
+{
+	ReleaseArena(avl->arena);
+	avl->arena = NULL;
+	free(avl->pending);
+	avl->pending = NULL;
+	avl->pending_num = 0;
+	avl->pending_capacity = 0;
+}
+
+
+status_ty AvlCompactStep(avl_ty *avl, size_t max_nodes, bool_ty *is_done)
+{
+	size_t visited = 0;
+
+	assert(NULL != avl);
+	assert(NULL != is_done);
+
+	*is_done = FALSE;
+
+	if(NULL == avl->arena)
+	{
+		if(NULL == GetRoot(avl))
+		{
+			*is_done = TRUE;
+			return SUCCESS;
+		}
+		if(SUCCESS != StartCompaction(avl))
+		{
+			return FAIL;
+		}
+		if(SUCCESS != PushPending(avl, &avl->root))
+		{
+			EndCompaction(avl);
+			return FAIL;
+		}
+	}
+
+	while(visited < max_nodes && 0 < avl->pending_num)
+	{
+		--avl->pending_num;
+		if(SUCCESS != CompactBlock(avl, avl->pending[avl->pending_num]))
+		{
+			ClearCache(avl->cache);
+			++avl->version;
+			return FAIL;
+		}
+		visited += COMPACT_BLOCK_NODES;
+	}
+	/* the cached nodes and the paths of cursors may have moved */
+	ClearCache(avl->cache);
+	++avl->version;
+
+	if(0 == avl->pending_num)
+	{
+		EndCompaction(avl);
+		*is_done = TRUE;
+	}
+
+	return SUCCESS;
+}
+
+
+status_ty AvlCompact(avl_ty *avl)
+{
+	bool_ty is_done = FALSE;
+
+	assert(NULL != avl);
+
+	return AvlCompactStep(avl, (size_t)-1, &is_done);
+}
+
+
+static size_t CountCompacted(node_ty *root)
+{
+	if(NULL == root)
+	{
+		return 0;
+	}
+
+	return (NULL != root->arena) + CountCompacted(GetChildren(root)[LEFT]) +
+									CountCompacted(GetChildren(root)[RIGHT]);
+}
+
+size_t AvlCountCompacted(const avl_ty *avl)
+{
+	assert(NULL != avl);
+
+	return CountCompacted(GetRoot(avl));
+}
+
+
+/*--------------- clones ------------*/
+
+static void RetainNode(node_ty *node)
+{
+	if(NULL != node)
+	{
+		__sync_fetch_and_add(&node->refs, 1);
+	}
+}
+
+/* a clone on another thread may drop its reference meanwhile */
+static bool_ty IsShared(node_ty *node)
+{
+	return (1 < __atomic_load_n(&node->refs, __ATOMIC_ACQUIRE));
+}
+
+/* an unshared copy of src, whose refs must not be read plainly */
+static void CopyNode(const avl_ty *avl, node_ty *dest, node_ty *src)
+{
+	dest->data = src->data;
+	dest->hight = src->hight;
+	dest->count = src->count;
+	dest->refs = 1;
+	dest->childrens[LEFT] = src->childrens[LEFT];
+	dest->childrens[RIGHT] = src->childrens[RIGHT];
+	dest->arena = NULL;
+	memcpy(GetAggregate(dest), GetAggregate(src), avl->aug_size);
+}
+
+/* a node that avl may change. nodes are owned from the root down, so
+   a node with one reference under an owned parent is only in avl */
+static node_ty *OwnNode(avl_ty *avl, node_ty *node)
+{
+	node_ty *copy = NULL;
+
+	if(!IsShared(node))
+	{
+		return node;
+	}
+
+	copy = TakeSpare(avl);
+	CopyNode(avl, copy, node);
+	RetainNode(GetChildren(copy)[LEFT]);
+	RetainNode(GetChildren(copy)[RIGHT]);
+	if(NULL != avl->index)
+	{
+		IndexMove(avl, node, copy);
+	}
+	if(NULL != avl->cache)
+	{
+		CacheInvalidate(avl->cache,
+						avl->cache->hash(GetData(node), GetParams(avl)));
+	}
+	/* the parent of node in avl now points to the copy */
+	RecursionDestroy(node);
+
+	return copy;
+}
+
+/* the trees cloned from each other count themselves in clones. when
+   the others are destroyed, they released all the shared nodes */
+static bool_ty IsTreeShared(avl_ty *avl)
+{
+	if(NULL == avl->clones)
+	{
+		return FALSE;
+	}
+	if(1 < __atomic_load_n(avl->clones, __ATOMIC_ACQUIRE))
+	{
+		return TRUE;
+	}
+	free(avl->clones);
+	avl->clones = NULL;
+
+	return FALSE;
+}
+
+/* enough free nodes for the copies of one insert or remove: the path
+   and two rotated nodes on each level */
+static status_ty ReserveSpares(avl_ty *avl)
+{
+	if(!IsTreeShared(avl))
+	{
+		return SUCCESS;
+	}
+
+	return AddSpares(avl, 3 * (size_t)(GetHight(GetRoot(avl)) + 3));
+}
+
+static status_ty AddSpares(avl_ty *avl, size_t needed)
+{
+	node_ty *spare = NULL;
+
+	while(avl->spares_num < needed)
+	{
+		spare = (node_ty *)malloc(GetNodeSize(avl));
+		if(NULL == spare)
+		{
+			return FAIL;
+		}
+		GetChildren(spare)[LEFT] = avl->spares;
+		avl->spares = spare;
+		++avl->spares_num;
+	}
+
+	return SUCCESS;
+}
+
+static node_ty *TakeSpare(avl_ty *avl)
+{
+	node_ty *spare = avl->spares;
+
+	assert(0 < avl->spares_num);
+	avl->spares = GetChildren(spare)[LEFT];
+	--avl->spares_num;
+
+	return spare;
+}
+
+
+avl_ty *AvlClone(avl_ty *avl)
+{
+	avl_ty *clone = NULL;
+
+	assert(NULL != avl);
+
+	clone = (avl_ty *)malloc(sizeof(avl_ty));
+	if(NULL == clone)
+	{
+		return NULL;
+	}
+	if(NULL == avl->clones)
+	{
+		avl->clones = (size_t *)malloc(sizeof(size_t));
+		if(NULL == avl->clones)
+		{
+			free(clone);
+			return NULL;
+		}
+		*avl->clones = 1;
+	}
+
+	/* the pending links of a compaction may be in shared nodes now */
+	if(NULL != avl->arena)
+	{
+		EndCompaction(avl);
+	}
+
+	*clone = *avl;
+#ifdef AVL_LATENCY
+	clone->latency = NULL;
+#endif
+	clone->arena = NULL;
+	clone->pending = NULL;
+	clone->pending_num = 0;
+	clone->pending_capacity = 0;
+	clone->cache = NULL;
+	clone->filter = NULL;
+	clone->index = NULL;
+	clone->version = 0;
+	clone->spares = NULL;
+	clone->spares_num = 0;
+	if(NULL != avl->interval)
+	{
+		clone->aug_params = clone;
+	}
+
+	RetainNode(GetRoot(avl));
+	__sync_fetch_and_add(avl->clones, 1);
+
+	return clone;
+}
+
+
+/*--------------- lazy remove ------------*/
+
+void AvlEnableLazyRemove(avl_ty *avl, size_t max_dead_percent)
+{
+	assert(NULL != avl);
+	assert(NULL == avl->aug);
+	assert(0 < max_dead_percent && 100 >= max_dead_percent);
+
+	avl->max_dead_percent = max_dead_percent;
+}
+
+
+/* the live nodes a rebuild copies, those under a shared node */
+static size_t CountSharedLive(node_ty *node, bool_ty in_shared)
+{
+	if(NULL == node)
+	{
+		return 0;
+	}
+	in_shared = (in_shared || IsShared(node));
+
+	return (in_shared && 0 != node->count) +
+		   CountSharedLive(GetChildren(node)[LEFT], in_shared) +
+		   CountSharedLive(GetChildren(node)[RIGHT], in_shared);
+}
+
+/* put the live nodes of the sub tree in live by order. owned nodes are
+   taken as they are and the dead ones freed, the live nodes under a
+   shared node are copied and the shared node released */
+static void CollectLive(avl_ty *avl, node_ty *node, bool_ty in_shared,
+						node_ty **live, size_t *live_num)
+{
+	node_ty *right = NULL;
+	bool_ty is_shared_top = FALSE;
+	bool_ty is_copied = FALSE;
+
+	if(NULL == node)
+	{
+		return;
+	}
+
+	is_shared_top = (!in_shared && IsShared(node));
+	is_copied = (in_shared || is_shared_top);
+	right = GetChildren(node)[RIGHT];
+
+	CollectLive(avl, GetChildren(node)[LEFT], is_copied, live, live_num);
+	if(0 != node->count && is_copied)
+	{
+		live[*live_num] = TakeSpare(avl);
+		CopyNode(avl, live[*live_num], node);
+		if(NULL != avl->index)
+		{
+			IndexMove(avl, node, live[*live_num]);
+		}
+		++*live_num;
+	}
+	else if(0 != node->count)
+	{
+		live[*live_num] = node;
+		++*live_num;
+	}
+	else if(NULL != avl->index)
+	{
+		IndexRemove(avl, node);
+	}
+	CollectLive(avl, right, is_copied, live, live_num);
+
+	if(is_shared_top)
+	{
+		RecursionDestroy(node);
+	}
+	else if(!is_copied && 0 == node->count)
+	{
+		FreeNode(node);
+	}
+}
+
+/* link live[lo, hi) to a balanced sub tree, like BuildSorted */
+static node_ty *LinkSorted(const avl_ty *avl, node_ty **live,
+						   size_t lo, size_t hi)
+{
+	node_ty *root = NULL;
+	size_t mid = lo + (hi - lo) / 2;
+
+	if(lo == hi)
+	{
+		return NULL;
+	}
+
+	root = live[mid];
+	GetChildren(root)[LEFT] = LinkSorted(avl, live, lo, mid);
+	GetChildren(root)[RIGHT] = LinkSorted(avl, live, mid + 1, hi);
+	SetHight(root, 1 + GetHight(GetChildren(root)[LEFT]));
+	UpdateNode(avl, root);
+
+	return root;
+}
+
+/* drop the dead nodes and balance the live ones, FAIL leaves the
+   tree as it was */
+static status_ty RebuildLive(avl_ty *avl)
+{
+	node_ty **live = NULL;
+	size_t live_num = 0;
+
+	/* the pending links of a compaction are in the relinked nodes */
+	if(NULL != avl->arena)
+	{
+		EndCompaction(avl);
+	}
+	if(SUCCESS != AddSpares(avl, CountSharedLive(GetRoot(avl), FALSE)))
+	{
+		return FAIL;
+	}
+	live = (node_ty **)malloc((avl->nodes_num - avl->dead_num + 1) *
+															sizeof(node_ty *));
+	if(NULL == live)
+	{
+		return FAIL;
+	}
+
+	CollectLive(avl, GetRoot(avl), FALSE, live, &live_num);
+	assert(live_num == avl->nodes_num - avl->dead_num);
+	assert(avl->is_multiset || live_num == avl->size);
+	avl->root = LinkSorted(avl, live, 0, live_num);
+	avl->nodes_num = live_num;
+	avl->dead_num = 0;
+	++avl->version;
+	if(NULL != avl->cache)
+	{
+		ClearCache(avl->cache);
+	}
+	free(live);
+
+	return SUCCESS;
+}
+
+
+/*--------------- diff ------------*/
+
+static void DiffPush(diff_side_ty *side, node_ty *node, bool_ty is_whole)
+{
+	if(NULL == node)
+	{
+		return;
+	}
+	assert(DIFF_DEPTH > side->depth);
+	side->nodes[side->depth] = node;
+	side->is_whole[side->depth] = is_whole;
+	++side->depth;
+}
+
+static node_ty *DiffTop(const diff_side_ty *side)
+{
+	return side->nodes[side->depth - 1];
+}
+
+static bool_ty DiffIsWhole(const diff_side_ty *side)
+{
+	return (0 < side->depth && side->is_whole[side->depth - 1]);
+}
+
+/* split the whole sub tree on top to its left, its root, its right */
+static void DiffExpand(diff_side_ty *side)
+{
+	node_ty *node = DiffTop(side);
+
+	--side->depth;
+	DiffPush(side, GetChildren(node)[RIGHT], TRUE);
+	DiffPush(side, node, FALSE);
+	DiffPush(side, GetChildren(node)[LEFT], TRUE);
+}
+
+/* compare the single nodes on top, a missing side is after the other */
+static int DiffCompare(const avl_ty *avl, const diff_side_ty *old_side,
+										  const diff_side_ty *new_side)
+{
+	if(0 == old_side->depth)
+	{
+		return 1;
+	}
+	if(0 == new_side->depth)
+	{
+		return -1;
+	}
+
+	return GetCmp(avl)(GetData(DiffTop(old_side)),
+					   GetData(DiffTop(new_side)), GetParams(avl));
+}
+
+/* report the smaller single node on top, or both when equal */
+static int DiffReport(const avl_ty *avl, diff_side_ty *old_side,
+					  diff_side_ty *new_side, action_func on_added,
+					  action_func on_removed, change_func on_changed,
+					  void *params)
+{
+	int cmp_res = DiffCompare(avl, old_side, new_side);
+	node_ty *old_node = (0 < old_side->depth) ? DiffTop(old_side) : NULL;
+	node_ty *new_node = (0 < new_side->depth) ? DiffTop(new_side) : NULL;
+
+	/* a lazy removed node is not in its tree, a live equal node is
+	   reported with the next one of the other side */
+	if(0 == cmp_res && (0 == old_node->count || 0 == new_node->count))
+	{
+		old_side->depth -= (0 == old_node->count);
+		new_side->depth -= (0 == new_node->count);
+		return 0;
+	}
+
+	if(0 > cmp_res)
+	{
+		--old_side->depth;
+		return (NULL == on_removed || 0 == old_node->count) ? 0 :
+							on_removed(GetData(old_node), params);
+	}
+	if(0 < cmp_res)
+	{
+		--new_side->depth;
+		return (NULL == on_added || 0 == new_node->count) ? 0 :
+							on_added(GetData(new_node), params);
+	}
+
+	--old_side->depth;
+	--new_side->depth;
+	if(NULL == on_changed || (GetData(old_node) == GetData(new_node) &&
+							  old_node->count == new_node->count))
+	{
+		return 0;
+	}
+
+	return on_changed(GetData(old_node), GetData(new_node), params);
+}
+
+
+status_ty AvlDiff(const avl_ty *old_avl, const avl_ty *new_avl,
+                  action_func on_added, action_func on_removed,
+                  change_func on_changed, void *params)
+{
+	diff_side_ty *sides = NULL;
+	diff_side_ty *old_side = NULL;
+	diff_side_ty *new_side = NULL;
+	status_ty status = SUCCESS;
+
+	assert(NULL != old_avl);
+	assert(NULL != new_avl);
+	assert(GetCmp(old_avl) == GetCmp(new_avl));
+
+	sides = (diff_side_ty *)malloc(2 * sizeof(diff_side_ty));
+	if(NULL == sides)
+	{
+		return FAIL;
+	}
+	old_side = sides;
+	new_side = sides + 1;
+	old_side->depth = 0;
+	new_side->depth = 0;
+	DiffPush(old_side, GetRoot(old_avl), TRUE);
+	DiffPush(new_side, GetRoot(new_avl), TRUE);
+
+	while(SUCCESS == status && (0 < old_side->depth || 0 < new_side->depth))
+	{
+		/* the same nodes hold the same elements */
+		if(DiffIsWhole(old_side) && DiffIsWhole(new_side) &&
+		   DiffTop(old_side) == DiffTop(new_side))
+		{
+			--old_side->depth;
+			--new_side->depth;
+		}
+		/* split the higher sub tree first, the lower may be shared
+		   with one inside it */
+		else if(DiffIsWhole(old_side) &&
+				(!DiffIsWhole(new_side) ||
+				 GetHight(DiffTop(old_side)) >= GetHight(DiffTop(new_side))))
+		{
+			DiffExpand(old_side);
+		}
+		else if(DiffIsWhole(new_side))
+		{
+			DiffExpand(new_side);
+		}
+		else if(0 != DiffReport(old_avl, old_side, new_side, on_added,
+								on_removed, on_changed, params))
+		{
+			status = FAIL;
+		}
+	}
+	free(sides);
+
+	return status;
+}
+
+
+/*--------------- cache ------------*/
+
+static cache_entry_ty *GetCacheSet(const cache_ty *cache, unsigned long hash)
+{
+	return cache->entries + (hash & cache->sets_mask) * CACHE_WAYS;
+}
+
+static void CacheMove(cache_entry_ty *dest, const cache_entry_ty *src)
+{
+	__atomic_store_n(&dest->hash, __atomic_load_n(&src->hash,
+							__ATOMIC_RELAXED), __ATOMIC_RELAXED);
+	__atomic_store_n(&dest->node, __atomic_load_n(&src->node,
+							__ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+/* the cached node equal to data, moved to the front of its set */
+static node_ty *CacheLookup(const avl_ty *avl, cache_entry_ty *set,
+							unsigned long hash, void *data)
+{
+	node_ty *node = NULL;
+	int way = 0;
+
+	for(way = 0; way < CACHE_WAYS; ++way)
+	{
+		node = __atomic_load_n(&set[way].node, __ATOMIC_RELAXED);
+		if(NULL != node &&
+		   hash == __atomic_load_n(&set[way].hash, __ATOMIC_RELAXED) &&
+		   0 == GetCmp(avl)(GetData(node), data, GetParams(avl)))
+		{
+			for(; 0 < way; --way)
+			{
+				CacheMove(set + way, set + way - 1);
+			}
+			__atomic_store_n(&set[0].hash, hash, __ATOMIC_RELAXED);
+			__atomic_store_n(&set[0].node, node, __ATOMIC_RELAXED);
+			return node;
+		}
+	}
+
+	return NULL;
+}
+
+/* put node first in its set, dropping the least recently used */
+static void CacheStore(cache_entry_ty *set, unsigned long hash,
+											node_ty *node)
+{
+	int way = 0;
+
+	for(way = CACHE_WAYS - 1; 0 < way; --way)
+	{
+		CacheMove(set + way, set + way - 1);
+	}
+	__atomic_store_n(&set[0].hash, hash, __ATOMIC_RELAXED);
+	__atomic_store_n(&set[0].node, node, __ATOMIC_RELAXED);
+}
+
+/* not an atomic add, a count of a concurrent find may be lost */
+static void CacheCount(size_t *counter)
+{
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1,
+														__ATOMIC_RELAXED);
+}
+
+static void CacheInvalidate(cache_ty *cache, unsigned long hash)
+{
+	cache_entry_ty *set = GetCacheSet(cache, hash);
+	int way = 0;
+
+	for(way = 0; way < CACHE_WAYS; ++way)
+	{
+		if(hash == set[way].hash)
+		{
+			set[way].node = NULL;
+		}
+	}
+}
+
+static void ClearCache(cache_ty *cache)
+{
+	size_t i = 0;
+
+	if(NULL == cache)
+	{
+		return;
+	}
+	for(i = 0; i < (cache->sets_mask + 1) * CACHE_WAYS; ++i)
+	{
+		cache->entries[i].node = NULL;
+	}
+}
+
+
+status_ty AvlEnableCache(avl_ty *avl, hash_func hash, size_t entries)
+{
+	cache_ty *cache = NULL;
+	size_t sets_num = 1;
 
-status_ty AvlForEach(avl_ty *avl, action_func action, void *params,trav_ty trav)
+	assert(NULL != avl);
+	assert(NULL != hash);
+	assert(NULL == avl->cache);
+
+	while(sets_num * CACHE_WAYS < entries)
+	{
+		sets_num *= 2;
+	}
+
+	cache = (cache_ty *)malloc(sizeof(cache_ty));
+	if(NULL == cache)
+	{
+		return FAIL;
+	}
+	cache->entries = (cache_entry_ty *)calloc(sets_num * CACHE_WAYS,
+											  sizeof(cache_entry_ty));
+	if(NULL == cache->entries)
+	{
+		free(cache);
+		return FAIL;
+	}
+	cache->hash = hash;
+	cache->sets_mask = sets_num - 1;
+	cache->hits = 0;
+	cache->misses = 0;
+	avl->cache = cache;
+
+	return SUCCESS;
+}
+
+
+void AvlGetCacheStats(const avl_ty *avl, size_t *hits, size_t *misses)
 {
 	assert(NULL != avl);
-	assert(NULL != action);
-	
-	return travers_functions_lut[trav](GetRoot(avl), action, params);	
+	assert(NULL != hits);
+	assert(NULL != misses);
+
+	*hits = (NULL == avl->cache) ? 0 :
+			__atomic_load_n(&avl->cache->hits, __ATOMIC_RELAXED);
+	*misses = (NULL == avl->cache) ? 0 :
+			  __atomic_load_n(&avl->cache->misses, __ATOMIC_RELAXED);
 }
 
 
-static node_ty *GetMostLeft(node_ty *node)
+/*--------------- filter ------------*/
+
+/* the i-th counter of a hash, by double hashing */
+static size_t FilterIndex(const filter_ty *filter, unsigned long hash, int i)
+{
+	unsigned long step = (((hash >> 16) ^ hash) * 0x9E3779B1UL) | 1;
+
+	return (size_t)((hash + i * step) % filter->counters_num);
+}
+
+static void FilterUpdate(filter_ty *filter, unsigned long hash, int diff)
 {
-	if(!IsLeaf(node) && NULL != GetChildren(node)[LEFT])
+	unsigned char *counter = NULL;
+	int i = 0;
+
+	for(i = 0; i < filter->hashes_num; ++i)
 	{
-		return GetMostLeft(GetChildren(node)[LEFT]);
+		counter = filter->counters + FilterIndex(filter, hash, i);
+		if(FILTER_COUNTER_MAX != *counter)
+		{
+			*counter += diff;
+		}
 	}
-	return node;
 }
 
+static bool_ty FilterMayHave(const filter_ty *filter, unsigned long hash)
+{
+	int i = 0;
+
+	for(i = 0; i < filter->hashes_num; ++i)
+	{
+		if(0 == filter->counters[FilterIndex(filter, hash, i)])
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
 
-static void SwapAndRemove(node_ty *rm_node, node_ty *swap_node_father, avl_children_ty side)
+static void FilterAddTree(const avl_ty *avl, node_ty *root)
 {
-	node_ty *swap_node = GetChildren(swap_node_father)[side];
-		
-	SetData(rm_node, GetData(swap_node));
-	
-	if(IsLeaf(swap_node))
+	size_t count = 0;
+
+	if(NULL == root)
 	{
-		GetChildren(swap_node_father)[side] = NULL;
-		free(swap_node);
+		return;
 	}
-	else
-	{		
-		GetChildren(swap_node_father)[side] = GetChildren(swap_node)[RIGHT];
-		free(swap_node);
-	}	
+	for(count = root->count; 0 < count; --count)
+	{
+		FilterUpdate(avl->filter, avl->filter->hash(GetData(root),
+												GetParams(avl)), 1);
+	}
+	FilterAddTree(avl, GetChildren(root)[LEFT]);
+	FilterAddTree(avl, GetChildren(root)[RIGHT]);
 }
 
 
-static int HaveLeftChildren(node_ty *node)
+status_ty AvlEnableFilter(avl_ty *avl, hash_func hash, size_t capacity,
+												  double false_positive)
 {
-	assert(NULL != node);
-	return (NULL != GetChildren(node)[LEFT]);
+	filter_ty *filter = NULL;
+	int hashes_num = 0;
+
+	assert(NULL != avl);
+	assert(NULL != hash);
+	assert(0 < false_positive && 1 > false_positive);
+	assert(NULL == avl->filter);
+
+	/* k = log2(1 / p) hashes over m = k * n / ln2 counters */
+	for(hashes_num = 0; 1 > false_positive; ++hashes_num)
+	{
+		false_positive *= 2;
+	}
+
+	filter = (filter_ty *)malloc(sizeof(filter_ty));
+	if(NULL == filter)
+	{
+		return FAIL;
+	}
+	filter->hash = hash;
+	filter->hashes_num = hashes_num;
+	filter->counters_num = (size_t)((capacity + 1) * hashes_num * 1.4427) + 1;
+	filter->counters = (unsigned char *)calloc(filter->counters_num, 1);
+	if(NULL == filter->counters)
+	{
+		free(filter);
+		return FAIL;
+	}
+
+	avl->filter = filter;
+	FilterAddTree(avl, GetRoot(avl));
+
+	return SUCCESS;
 }
 
-static node_ty *RecursiveRemove(node_ty *root, cmp_func cmp, void *params, void *data)
+
+/*--------------- index ------------*/
+
+static size_t IndexHome(const index_ty *index, unsigned long hash)
 {
-	avl_children_ty search_side = 0;
-	node_ty *rm_position = NULL;
-	node_ty *father_of_next = NULL;
-	node_ty *next = NULL;
-	
-	assert(NULL != root);
-	assert(NULL != cmp);
-	
-	search_side = FindSearchSide(root, data, cmp, params);
-	
-	rm_position = GetChildren(root)[search_side];
-	
-	if(0 == cmp(GetData(rm_position), data, params))
+	return (size_t)((hash ^ (hash >> 16)) * 0x9E3779B1UL) & index->mask;
+}
+
+/* the slot can not be full, the index is kept at most half full */
+static void IndexPut(index_ty *index, unsigned long hash, node_ty *node)
+{
+	size_t slot = IndexHome(index, hash);
+
+	while(NULL != index->entries[slot].node)
+	{
+		slot = (slot + 1) & index->mask;
+	}
+	index->entries[slot].hash = hash;
+	index->entries[slot].node = node;
+	++index->num;
+}
+
+static status_ty IndexGrow(index_ty *index)
+{
+	cache_entry_ty *old = index->entries;
+	size_t old_size = index->mask + 1;
+	size_t i = 0;
+
+	index->entries = (cache_entry_ty *)calloc(old_size * 2,
+											  sizeof(cache_entry_ty));
+	if(NULL == index->entries)
 	{
-		if(IsLeaf(rm_position))
+		index->entries = old;
+		return FAIL;
+	}
+	index->mask = old_size * 2 - 1;
+	index->num = 0;
+	for(i = 0; i < old_size; ++i)
+	{
+		if(NULL != old[i].node)
 		{
-			free(rm_position);
-			GetChildren(root)[search_side] = NULL;
+			IndexPut(index, old[i].hash, old[i].node);
 		}
-		else if(HaveOneChildren(rm_position))
+	}
+	free(old);
+
+	return SUCCESS;
+}
+
+static status_ty IndexAdd(const avl_ty *avl, node_ty *node)
+{
+	index_ty *index = avl->index;
+
+	if(2 * (index->num + 1) > index->mask + 1 && SUCCESS != IndexGrow(index))
+	{
+		return FAIL;
+	}
+	IndexPut(index, index->hash(GetData(node), GetParams(avl)), node);
+
+	return SUCCESS;
+}
+
+static size_t IndexSlotOf(const avl_ty *avl, node_ty *node)
+{
+	index_ty *index = avl->index;
+	size_t slot = IndexHome(index, index->hash(GetData(node),
+												GetParams(avl)));
+
+	while(node != index->entries[slot].node)
+	{
+		assert(NULL != index->entries[slot].node);
+		slot = (slot + 1) & index->mask;
+	}
+
+	return slot;
+}
+
+/* entries after the freed slot move back to it, unless their home
+   slot is between them, so no probe passes an empty slot */
+static void IndexRemove(const avl_ty *avl, node_ty *node)
+{
+	index_ty *index = avl->index;
+	size_t slot = IndexSlotOf(avl, node);
+	size_t next = slot;
+	size_t home = 0;
+
+	for(;;)
+	{
+		index->entries[slot].node = NULL;
+		do
 		{
-			GetChildren(root)[search_side] = 
-			(NULL == GetChildren(rm_position)[LEFT]) ?
-			GetChildren(rm_position)[RIGHT] :
-			GetChildren(rm_position)[LEFT];
-			
-			free(rm_position);
+			next = (next + 1) & index->mask;
+			if(NULL == index->entries[next].node)
+			{
+				--index->num;
+				return;
+			}
+			home = IndexHome(index, index->entries[next].hash);
 		}
-		
-		/* rm_position have two childrens */
-		else if(HaveLeftChildren(GetChildren(rm_position)[RIGHT]))
-		{
+		while(((next - home) & index->mask) < ((next - slot) & index->mask));
 
-			next = GetMostLeft(GetChildren(rm_position)[RIGHT]);
-			SetData(rm_position, GetData(next));
-			rm_position->childrens[RIGHT] = 
-			RecursiveRemove(GetChildren(rm_position)[RIGHT], cmp, params, GetData(next));
-			
-			root->childrens[search_side] = rm_position;
-		}
-		else
+		index->entries[slot] = index->entries[next];
+		slot = next;
+	}
+}
+
+static void IndexMove(const avl_ty *avl, node_ty *node, node_ty *moved)
+{
+	avl->index->entries[IndexSlotOf(avl, node)].node = moved;
+}
+
+static node_ty *IndexLookup(const avl_ty *avl, void *data)
+{
+	index_ty *index = avl->index;
+	unsigned long hash = index->hash(data, GetParams(avl));
+	size_t slot = IndexHome(index, hash);
+	node_ty *node = NULL;
+
+	for(node = index->entries[slot].node; NULL != node;
+		node = index->entries[slot].node)
+	{
+		if(hash == index->entries[slot].hash &&
+		   0 == GetCmp(avl)(GetData(node), data, GetParams(avl)))
 		{
-			father_of_next = rm_position;
-			SwapAndRemove(rm_position, father_of_next, RIGHT);
+			return node;
 		}
-			
-		UpdateAllHights(root);
-		return root;
+		slot = (slot + 1) & index->mask;
 	}
-	
-	else
+
+	return NULL;
+}
+
+static status_ty IndexAddTree(const avl_ty *avl, node_ty *root)
+{
+	if(NULL == root)
 	{
-		RecursiveRemove(rm_position, cmp, params, data);
-		root->childrens[search_side] = SubTreeBalance(rm_position);
-		UpdateAllHights(root);
-		return root;
+		return SUCCESS;
+	}
+	if(SUCCESS != IndexAdd(avl, root) ||
+	   SUCCESS != IndexAddTree(avl, GetChildren(root)[LEFT]))
+	{
+		return FAIL;
 	}
-}
 
+	return IndexAddTree(avl, GetChildren(root)[RIGHT]);
+}
 
-static void RemoveRoot(avl_ty *avl)
+static void ClearIndex(index_ty *index)
 {
-	node_ty *father_of_next = NULL;
-	node_ty *root = GetRoot(avl);
-	node_ty *next = NULL;
-	
-	if(IsLeaf(root))
+	if(NULL == index)
 	{
-		free(root);
-		avl->root = NULL;
+		return;
 	}
-	else if(HaveOneChildren(root))
+	memset(index->entries, 0, (index->mask + 1) * sizeof(cache_entry_ty));
+	index->num = 0;
+}
+
+
+status_ty AvlEnableIndex(avl_ty *avl, hash_func hash)
+{
+	index_ty *index = NULL;
+
+	assert(NULL != avl);
+	assert(NULL != hash);
+	assert(NULL == avl->index);
+
+	index = (index_ty *)malloc(sizeof(index_ty));
+	if(NULL == index)
 	{
-		avl->root = 
-		(NULL == GetChildren(root)[LEFT]) ?
-		GetChildren(root)[RIGHT] :
-		GetChildren(root)[LEFT];
-		
-		free(root);
+		return FAIL;
 	}
-	/* root have two childrens */
-	else if(HaveLeftChildren(GetChildren(root)[RIGHT]))
+	index->entries = (cache_entry_ty *)calloc(INDEX_INIT_SIZE,
+											  sizeof(cache_entry_ty));
+	if(NULL == index->entries)
 	{
-		next = GetMostLeft(GetChildren(root)[RIGHT]);
-		SetData(root, GetData(next));
-		avl->root->childrens[RIGHT] =
-		RecursiveRemove(GetChildren(root)[RIGHT],
-									 GetCmp(avl),
-									 GetParams(avl),
-									 GetData(next));
+		free(index);
+		return FAIL;
 	}
-	else
+	index->hash = hash;
+	index->mask = INDEX_INIT_SIZE - 1;
+	index->num = 0;
+
+	avl->index = index;
+	if(SUCCESS != IndexAddTree(avl, GetRoot(avl)))
 	{
-		father_of_next = root;
-		SwapAndRemove(root, father_of_next, RIGHT);
+		avl->index = NULL;
+		free(index->entries);
+		free(index);
+		return FAIL;
 	}
-	
-	UpdateAllHights(root);
+
+	return SUCCESS;
 }
 
 
-void AvlRemove(avl_ty *avl, void *data)
+/*--------------- batch compare ------------*/
+
+int AvlCmpInts(const void *avl_data, const void *user_data, void *params)
+{
+	int avl_value = *(const int *)avl_data;
+	int user_value = *(const int *)user_data;
+
+	(void)params;
+
+	return (avl_value > user_value) - (avl_value < user_value);
+}
+
+/* the elements are gathered to an array, then compared a vector
+   at a time */
+void AvlCmpBatchInts(const void *avl_data, const void **user_datas, size_t n,
+												int *out, void *params)
 {
-	if(0 == GetCmp(avl)(GetData(GetRoot(avl)), data, GetParams(avl)))
+	size_t i = 0;
+#if defined(__AVX2__)
+	__m256i node = _mm256_set1_epi32(*(const int *)avl_data);
+	__m256i users;
+	int values[8];
+	size_t j = 0;
+
+	for(; i + 8 <= n; i += 8)
 	{
-		RemoveRoot(avl);
-		avl->root = SubTreeBalance(GetRoot(avl));	
+		for(j = 0; j < 8; ++j)
+		{
+			values[j] = *(const int *)user_datas[i + j];
+		}
+		users = _mm256_loadu_si256((const __m256i *)values);
+		_mm256_storeu_si256((__m256i *)(out + i),
+							_mm256_sub_epi32(_mm256_cmpgt_epi32(users, node),
+											 _mm256_cmpgt_epi32(node, users)));
 	}
-	else
+#elif defined(__SSE2__)
+	__m128i node = _mm_set1_epi32(*(const int *)avl_data);
+	__m128i users;
+	int values[4];
+	size_t j = 0;
+
+	for(; i + 4 <= n; i += 4)
 	{
-		RecursiveRemove(GetRoot(avl), GetCmp(avl), GetParams(avl), data);
-		avl->root = SubTreeBalance(GetRoot(avl));	
+		for(j = 0; j < 4; ++j)
+		{
+			values[j] = *(const int *)user_datas[i + j];
+		}
+		users = _mm_loadu_si128((const __m128i *)values);
+		_mm_storeu_si128((__m128i *)(out + i),
+						 _mm_sub_epi32(_mm_cmpgt_epi32(users, node),
+									   _mm_cmpgt_epi32(node, users)));
+	}
+#endif
+
+	for(; i < n; ++i)
+	{
+		out[i] = AvlCmpInts(avl_data, user_datas[i], params);
 	}
 }
 
+int AvlCmpDoubles(const void *avl_data, const void *user_data, void *params)
+{
+	double avl_value = *(const double *)avl_data;
+	double user_value = *(const double *)user_data;
+
+	(void)params;
+
+	return (avl_value > user_value) - (avl_value < user_value);
+}
 
-static long UpdateAllHights(node_ty *root)
+/* NaN is neither greater nor less, like in AvlCmpDoubles */
+void AvlCmpBatchDoubles(const void *avl_data, const void **user_datas, size_t n,
+												   int *out, void *params)
 {
-	long left_subtree_hight = 0;
-	long right_subtree_hight = 0;
-	assert(NULL != root);
-	
-	left_subtree_hight = (NULL == GetChildren(root)[LEFT]) ? 0 :
-								 1 + UpdateAllHights(GetChildren(root)[LEFT]);
-	
-	right_subtree_hight = (NULL == GetChildren(root)[RIGHT]) ? 0 :
-								 1 + UpdateAllHights(GetChildren(root)[RIGHT]);
-	 
-	if(left_subtree_hight >= right_subtree_hight)
+	size_t i = 0;
+#if defined(__AVX__)
+	__m256d node = _mm256_set1_pd(*(const double *)avl_data);
+	__m256d users;
+	double values[4];
+	int greater = 0;
+	int less = 0;
+	size_t j = 0;
+
+	for(; i + 4 <= n; i += 4)
 	{
-		SetHight(root, left_subtree_hight);
-		return left_subtree_hight;
+		for(j = 0; j < 4; ++j)
+		{
+			values[j] = *(const double *)user_datas[i + j];
+		}
+		users = _mm256_loadu_pd(values);
+		greater = _mm256_movemask_pd(_mm256_cmp_pd(node, users, _CMP_GT_OQ));
+		less = _mm256_movemask_pd(_mm256_cmp_pd(node, users, _CMP_LT_OQ));
+		for(j = 0; j < 4; ++j)
+		{
+			out[i + j] = ((greater >> j) & 1) - ((less >> j) & 1);
+		}
 	}
-	
-	SetHight(root, right_subtree_hight);
-	return right_subtree_hight;
-}
+#elif defined(__SSE2__)
+	__m128d node = _mm_set1_pd(*(const double *)avl_data);
+	__m128d users;
+	int greater = 0;
+	int less = 0;
 
+	for(; i + 2 <= n; i += 2)
+	{
+		users = _mm_set_pd(*(const double *)user_datas[i + 1],
+						  *(const double *)user_datas[i]);
+		greater = _mm_movemask_pd(_mm_cmpgt_pd(node, users));
+		less = _mm_movemask_pd(_mm_cmplt_pd(node, users));
+		out[i] = (greater & 1) - (less & 1);
+		out[i + 1] = ((greater >> 1) & 1) - ((less >> 1) & 1);
+	}
+#endif
 
-long AvlHeight(const avl_ty *avl)
-{
-	assert(NULL != avl);
-	return GetHight(GetRoot(avl)); 
+	for(; i < n; ++i)
+	{
+		out[i] = AvlCmpDoubles(avl_data, user_datas[i], params);
+	}
 }
 
 
-static node_ty *BalanceLL(node_ty *root)
+/*--------------- rotations ------------*/
+
+static node_ty *BalanceLL(avl_ty *avl, node_ty *root)
 {
 	node_ty *pivot = NULL;
 	node_ty *save_right_of_pivot = NULL;
-	
+
 	assert(NULL != root);
-	
-	pivot = GetChildren(root)[LEFT];
+
+	pivot = OwnNode(avl, GetChildren(root)[LEFT]);
 	save_right_of_pivot = GetChildren(pivot)[RIGHT];
 	pivot->childrens[RIGHT] = root;
 	root->childrens[LEFT] = save_right_of_pivot;
-	
+	++avl->rotations;
+
+	UpdateNode(avl, root);
+	UpdateNode(avl, pivot);
+
 	return pivot;
 }
 
 
-static node_ty *BalanceRR(node_ty *root)
+static node_ty *BalanceRR(avl_ty *avl, node_ty *root)
 {
 	node_ty *pivot = NULL;
 	node_ty *save_left_of_pivot = NULL;
 
 	assert(NULL != root);
-	
-	pivot = GetChildren(root)[RIGHT];
+
+	pivot = OwnNode(avl, GetChildren(root)[RIGHT]);
 	save_left_of_pivot = GetChildren(pivot)[LEFT];
 	pivot->childrens[LEFT] = root;
 	root->childrens[RIGHT] = save_left_of_pivot;
-	
+	++avl->rotations;
+
+	UpdateNode(avl, root);
+	UpdateNode(avl, pivot);
+
 	return pivot;
 }
 
 
-static void LeftRotation(node_ty *father_of_root, node_ty *root, avl_children_ty side)
+static node_ty *BalanceLR(avl_ty *avl, node_ty *root)
 {
-	node_ty *pivot = NULL;
-	node_ty *save_left_of_pivot = NULL;
-	
-	assert(NULL != father_of_root);
 	assert(NULL != root);
-	
-	pivot = GetChildren(root)[RIGHT];
-	save_left_of_pivot = GetChildren(pivot)[LEFT];
-	father_of_root->childrens[side] = pivot;
-	root->childrens[RIGHT] = save_left_of_pivot;
-	pivot->childrens[LEFT] = root;
+
+	root->childrens[LEFT] = BalanceRR(avl,
+									  OwnNode(avl, GetChildren(root)[LEFT]));
+
+	return BalanceLL(avl, root);
 }
 
 
-static void RightRotation(node_ty *father_of_root, node_ty *root, avl_children_ty side)
+static node_ty *BalanceRL(avl_ty *avl, node_ty *root)
 {
-	node_ty *pivot = NULL;
-	node_ty *save_right_of_pivot = NULL;
-	
-	assert(NULL != father_of_root);
 	assert(NULL != root);
-	
-	pivot = GetChildren(root)[LEFT];
-	save_right_of_pivot = GetChildren(pivot)[RIGHT];
-	father_of_root->childrens[side] = pivot;
-	root->childrens[LEFT] = save_right_of_pivot;
-	pivot->childrens[RIGHT] = root;
-}
 
-static node_ty *BalanceLR(node_ty *root)
-{
-	node_ty *pivot = NULL;
+	root->childrens[RIGHT] = BalanceLL(avl,
+									   OwnNode(avl, GetChildren(root)[RIGHT]));
 
-	assert(NULL != root);
-	
-	pivot = GetChildren(root)[LEFT];
-	LeftRotation(root, pivot, LEFT);
-	
-	return BalanceLL(root);
+	return BalanceRR(avl, root);
 }
 
 
-static node_ty *BalanceRL(node_ty *root)
+/*--------------- weak avl ------------*/
+
+/* the rank of a missing child is -1, so a leaf has rank diffs 1,1 */
+static long RankDiff(node_ty *node, avl_children_ty side)
 {
-	node_ty *pivot = NULL;
-	
-	assert(NULL != root);
-	
-	pivot = GetChildren(root)[RIGHT];
-	RightRotation(root, pivot, RIGHT);
-	
-	return BalanceRR(root);
+	assert(NULL != node);
+
+	return GetHight(node) - GetHight(GetChildren(node)[side]);
 }
 
+static void AddRank(node_ty *node, long diff)
+{
+	SetHight(node, GetHight(node) + diff);
+}
 
-static int HaveLeftChild(node_ty *node)
+/* the child on side was promoted to the rank of node */
+static node_ty *WeakInsertFix(avl_ty *avl, node_ty *node,
+							  avl_children_ty side)
 {
-	return (NULL != GetChildren(node)[LEFT]);
+	avl_children_ty other = (LEFT == side) ? RIGHT : LEFT;
+	node_ty *new_root = NULL;
+
+	if(1 == RankDiff(node, other))
+	{
+		AddRank(node, 1);
+		return node;
+	}
+
+	/* the inner grand child is 2 below the child - single rotation */
+	if(2 == RankDiff(GetChildren(node)[side], other))
+	{
+		new_root = balance_funcs_lut[(LEFT == side) ? LL : RR](avl, node);
+		AddRank(node, -1);
+		return new_root;
+	}
+
+	new_root = balance_funcs_lut[(LEFT == side) ? LR : RL](avl, node);
+	AddRank(new_root, 1);
+	AddRank(GetChildren(new_root)[LEFT], -1);
+	AddRank(GetChildren(new_root)[RIGHT], -1);
+
+	return new_root;
 }
 
-static int HaveRightChild(node_ty *node)
+/* the child on side fell 3 below node. demotions may go on at the
+   parent, a rotation ends the fix */
+static node_ty *WeakRemoveFix(avl_ty *avl, node_ty *node,
+							  avl_children_ty side)
 {
-	return (NULL != GetChildren(node)[RIGHT]);
+	avl_children_ty other = (LEFT == side) ? RIGHT : LEFT;
+	node_ty *sibling = NULL;
+	node_ty *new_root = NULL;
+
+	if(2 == RankDiff(node, other))
+	{
+		AddRank(node, -1);
+		return node;
+	}
+
+	sibling = OwnNode(avl, GetChildren(node)[other]);
+	GetChildren(node)[other] = sibling;
+	if(2 == RankDiff(sibling, LEFT) && 2 == RankDiff(sibling, RIGHT))
+	{
+		AddRank(node, -1);
+		AddRank(sibling, -1);
+		return node;
+	}
+
+	/* the outer grand child is 1 below the sibling - single rotation */
+	if(1 == RankDiff(sibling, other))
+	{
+		new_root = balance_funcs_lut[(LEFT == side) ? RR : LL](avl, node);
+		AddRank(sibling, 1);
+		AddRank(node, -1);
+		if(NULL == GetChildren(node)[LEFT] && NULL == GetChildren(node)[RIGHT])
+		{
+			AddRank(node, -1);
+		}
+		return new_root;
+	}
+
+	new_root = balance_funcs_lut[(LEFT == side) ? RL : LR](avl, node);
+	AddRank(new_root, 2);
+	AddRank(sibling, -1);
+	AddRank(node, -2);
+
+	return new_root;
 }
 
-static int HeightsDiff(node_ty *node)
+/* at most one child of node changed its rank by 1 since node was
+   balanced, so only one of the violations is found */
+static node_ty *WeakBalance(avl_ty *avl, node_ty *node)
 {
-	int left_subtree_hight = 0;
-	int right_subtree_hight = 0;
-	assert(NULL != node);
-	
-	left_subtree_hight = (!HaveLeftChild(node)) ? 0 :
-								 GetHight(GetChildren(node)[LEFT]) + 1;
-	
-	right_subtree_hight = (!HaveRightChild(node)) ? 0 :
-								 GetHight(GetChildren(node)[RIGHT]) + 1;
-	
-	return (left_subtree_hight - right_subtree_hight);
+	int side = LEFT;
+
+	UpdateNode(avl, node);
+
+	for(side = LEFT; side < CHILDREN_NUM; ++side)
+	{
+		if(0 == RankDiff(node, (avl_children_ty)side))
+		{
+			return WeakInsertFix(avl, node, (avl_children_ty)side);
+		}
+		if(3 == RankDiff(node, (avl_children_ty)side))
+		{
+			return WeakRemoveFix(avl, node, (avl_children_ty)side);
+		}
+	}
+
+	/* a leaf left with rank 1 */
+	if(NULL == GetChildren(node)[LEFT] && NULL == GetChildren(node)[RIGHT])
+	{
+		SetHight(node, 0);
+	}
+
+	return node;
 }
 
 
-static int IsBalance(node_ty *node)
+static int HeightsDiff(node_ty *node)
 {
-	return ((NULL == node) ||(-1 <= HeightsDiff(node) && 1 >= HeightsDiff(node)));
+	assert(NULL != node);
+
+	return (int)(GetHight(GetChildren(node)[LEFT]) -
+				 GetHight(GetChildren(node)[RIGHT]));
 }
 
 
@@ -801,19 +3418,19 @@ static int IsBalance(node_ty *node)
 static int LeftHigherOrEqualFromRight(node_ty *node)
 {
 	assert(NULL != node);
-	return (GetHight(GetChildren(node)[LEFT]) >= 
+	return (GetHight(GetChildren(node)[LEFT]) >=
 						GetHight(GetChildren(node)[RIGHT]));
 }
 
 static int RightHigherOrEqualFromLeft(node_ty *node)
 {
 	assert(NULL != node);
-	return (GetHight(GetChildren(node)[RIGHT]) >= 
+	return (GetHight(GetChildren(node)[RIGHT]) >=
 						GetHight(GetChildren(node)[LEFT]));
 }
-	
 
-					 
+
+
 static void TreePrintR(node_ty *node, int level)
 {
     int i = 0;
@@ -821,33 +3438,24 @@ static void TreePrintR(node_ty *node, int level)
     {
         return;
     }
-     
+
     level += MAX_HEIGHT;
- 
+
     TreePrintR(node->childrens[RIGHT], level);
 
     for (i = MAX_HEIGHT; i < level; i++)
     {
         printf("   ");
     }
-    
+
     printf("Num: %d H:%ld\n",  *(int *)node->data, node->hight);
- 
+
     TreePrintR(node->childrens[LEFT], level);
-}							 
-						 
+}
+
 void TreePrint(avl_ty *avl)
 {
     printf("\n----------------------------TREE-----------------------------\n");
     TreePrintR(avl->root, 0);
     printf("\n-------------------------------------------------------------\n");
 }
-
-
-				 
-						 
-						 
-						 
-						 
-						 
-						 
@@ -10,6 +10,9 @@
 
 #include <stddef.h> /* size_t */
 
+#define AVL_LATENCY_BUCKETS 256
+#define AVL_AGGREGATE_MAX_SIZE 32
+
 typedef enum 
 {
     INORDER     = 0,
@@ -17,6 +20,21 @@ typedef enum
     POST_ORDER  = 2
 }trav_ty;
 
+typedef enum
+{
+	STRICT_AVL = 0,
+	WEAK_AVL   = 1
+}balance_ty;
+
+typedef enum
+{
+	LATENCY_INSERT  = 0,
+	LATENCY_FIND    = 1,
+	LATENCY_REMOVE  = 2,
+	LATENCY_FOREACH = 3,
+	LATENCY_OPS_NUM = 4
+}latency_op_ty;
+
 typedef enum
 {
 	SUCCESS = 0,
@@ -31,6 +49,16 @@ typedef enum
 
 typedef struct avl avl_ty;
 typedef struct node node_ty;
+typedef struct avl_cursor avl_cursor_ty;
+
+/* counts of operations by their time in timer ticks, the tsc on x86.
+   times below 4 have a bucket each, above that each power of 2 is
+   split to 4 buckets, so a bucket holds times within 25% */
+typedef struct
+{
+	size_t counts[AVL_LATENCY_BUCKETS];
+	size_t total;
+} avl_histogram_ty;
 
 typedef int(*cmp_func)(const void *avl_data,
                        const void *user_data,
@@ -38,6 +66,38 @@ typedef int(*cmp_func)(const void *avl_data,
 
 typedef int(*action_func)(void *data, void *params);
 
+/* recompute the aggregate of a node from its data and the aggregates
+   of its childrens (NULL for a missing child) */
+typedef void(*aug_func)(void *aggregate,
+                        const void *data,
+                        const void *left_aggregate,
+                        const void *right_aggregate,
+                        void *params);
+
+/* get the string key of an element */
+typedef const char *(*str_key_func)(const void *data, void *params);
+
+/* get the half open interval [start, end) of an element */
+typedef void(*interval_func)(const void *data,
+                             long *start,
+                             long *end,
+                             void *params);
+
+/* hash the key of an element, equal elements must get equal hashes */
+typedef unsigned long(*hash_func)(const void *data, void *params);
+
+/* get two elements that are equal by the compare function */
+typedef int(*change_func)(void *old_data, void *new_data, void *params);
+
+/* compare one element of the tree with n user elements at once,
+   out[i] gets what cmp_func returns for (avl_data, user_datas[i]),
+   so it is positive when the tree element is the bigger one */
+typedef void(*cmp_batch_func)(const void *avl_data,
+                              const void **user_datas,
+                              size_t n,
+                              int *out,
+                              void *params);
+
 /*
 DESCRIPTION : create a new avl tree
 PARAMETERS : pointer compare function,
@@ -47,6 +107,77 @@ COMPLEXITY : time - O(1), space - O(1)
 */
 avl_ty *AvlCreate(cmp_func cmp, void *params);
 
+/*
+DESCRIPTION : create a new avl tree with a balancing policy.
+STRICT_AVL keeps the hights of sibling sub trees within 1, like
+AvlCreate. WEAK_AVL keeps ranks instead: a rank is 1 or 2 above
+the ranks of the childrens and leaves have rank 0. inserts rotate
+like STRICT_AVL, removes rotate at most twice and fix O(1) ranks
+amortized, and the hight stays below 2*log(n).
+PARAMETERS : pointer compare function, params to compare
+function and the balancing policy.
+RETURN : pointer to the new avl tree.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+avl_ty *AvlCreateWithPolicy(cmp_func cmp, void *params, balance_ty balance);
+
+/*
+DESCRIPTION : create a new avl tree that keeps a user defined
+aggregate of aug_size bytes in each node. the aggregate is
+recomputed by aug on insert, remove and rotations. aug_size
+must not be more than AVL_AGGREGATE_MAX_SIZE.
+PARAMETERS : pointer compare function, params to compare
+and aug functions, aug function and size of the aggregate.
+RETURN : pointer to the new avl tree.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+avl_ty *AvlCreateAugmented(cmp_func cmp, void *params,
+                           aug_func aug, size_t aug_size);
+
+/*
+DESCRIPTION : create a new avl multiset. equal elements share one
+node with a count, so inserting and removing a duplicate does
+not allocate. the node keeps the first inserted element.
+PARAMETERS : pointer compare function,
+and params to compare function.
+RETURN : pointer to the new avl tree.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+avl_ty *AvlCreateMultiset(cmp_func cmp, void *params);
+
+/*
+DESCRIPTION : create a new avl tree of string keyed elements.
+each node caches the first 16 bytes of its key, so most compares
+are settled without reading the element. cmp is called only when
+the prefixes are equal and must order the keys like strcmp.
+PARAMETERS : pointer compare function, params to compare
+and str_key functions, str_key function.
+RETURN : pointer to the new avl tree.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+avl_ty *AvlCreateString(cmp_func cmp, void *params, str_key_func str_key);
+
+/*
+DESCRIPTION : create a new interval tree. each node keeps the
+max end of its sub tree. cmp must order the elements by start.
+PARAMETERS : pointer compare function, params to compare
+and interval functions, interval function.
+RETURN : pointer to the new avl tree.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+avl_ty *AvlCreateInterval(cmp_func cmp, void *params, interval_func interval);
+
+/*
+DESCRIPTION : create a new avl tree that also has a batch compare
+function. AvlFindBatch compares each node it visits with all the
+searched elements that reach it in one call, the node first.
+PARAMETERS : pointer compare function, pointer batch compare
+function, params to both.
+RETURN : pointer to the new avl tree.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+avl_ty *AvlCreateBatch(cmp_func cmp, cmp_batch_func cmp_batch, void *params);
+
 /*
 DESCRIPTION : destroy exist avl tree
 PARAMETERS : pointer to avl
@@ -64,27 +195,74 @@ COMPLEXITY : time - O(logn), space - O(1)
 status_ty AvlInsert(avl_ty *avl, void *data);
 
 /*
-DESCRIPTION : remove element from avl
+DESCRIPTION : insert sorted elements to an empty avl, building
+a balanced tree without comparing them.
+PARAMETERS : pointer to empty avl, array of elements sorted by
+the compare function of avl, num of elements.
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(n), space - O(logn) 
+*/
+status_ty AvlBulkLoad(avl_ty *avl, void **sorted, size_t n);
+
+/*
+DESCRIPTION : remove element from avl, in a multiset
+one occurrence of the element is removed
 PARAMETERS : pointer to avl, pointer
 data of the element
-RETURN : void
-COMPLEXITY : time - O(logn), space - O(1) 
+RETURN : SUCCESS, or FAIL if memory ran out copying nodes
+shared with a clone. the element is not removed then.
+COMPLEXITY : time - O(logn), amortized with lazy removes,
+space - O(1) 
 */
-void AvlRemove(avl_ty *avl, void *data);
+status_ty AvlRemove(avl_ty *avl, void *data);
 
 /*
-DESCRIPTION : return the hight of avl tree
+DESCRIPTION : create a copy of avl that shares all its nodes.
+each tree copies the shared nodes on the path of its inserts and
+removes, so changing one does not change the other, and a node
+is freed with the last tree that has it. the copy has no cache,
+filter, index or latency histograms, and a running AvlCompactStep
+of avl is stopped.
+the trees may be used from different threads.
+PARAMETERS : pointer to avl
+RETURN : pointer to the copy, or NULL on failure.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+avl_ty *AvlClone(avl_ty *avl);
+
+/*
+DESCRIPTION : walk old and new in order and report the elements only
+in new, the elements only in old, and the equal elements that are
+different pointers, or have different counts in a multiset. sub trees
+shared by clones are skipped, so after AvlClone the walk is about the
+size of the changes. a NULL function is not called. stops when a
+function returns non zero.
+PARAMETERS : pointers to the old and new avls, of one compare
+function, functions for added, removed and changed elements,
+params to the functions.
+RETURN : SUCCESS, or FAIL if stopped by a function or out of memory.
+COMPLEXITY : time - O(k*logn) for k changes since a clone, else
+O(n + m), space - O(logn) 
+*/
+status_ty AvlDiff(const avl_ty *old_avl, const avl_ty *new_avl,
+                  action_func on_added, action_func on_removed,
+                  change_func on_changed, void *params);
+
+/*
+DESCRIPTION : return the hight of avl tree. a WEAK_AVL tree is
+walked, since its ranks only bound the hight.
 PARAMETERS : pointer to avl.
 RETURN : the hight(long)
-COMPLEXITY : time - O(n), space - O(1) 
+COMPLEXITY : time - O(n), space - O(logn) 
 */
 long AvlHeight(const avl_ty *avl);
 
 /*
-DESCRIPTION : return the num of elements in avl tree
+DESCRIPTION : return the num of elements in avl tree,
+counting every occurrence in a multiset
 PARAMETERS : pointer to avl.
 RETURN : num of elements(size_t)
-COMPLEXITY : time - O(n), space - O(1) 
+COMPLEXITY : time - O(1), space - O(1) 
 */	
 size_t AvlSize(const avl_ty *avl);
 
@@ -104,17 +282,292 @@ COMPLEXITY : time - O(log(n)), space - O(1)
 */
 status_ty AvlFind(const avl_ty *avl, void *data);
 
+/*
+DESCRIPTION : return how many times data is in an avl multiset.
+for an avl that is not a multiset, 1 if data is found, else 0.
+PARAMETERS : pointer to avl, pointer to data.
+RETURN : num of occurrences(size_t)
+COMPLEXITY : time - O(log(n)), space - O(1) 
+*/
+size_t AvlCount(const avl_ty *avl, void *data);
+
+/*
+DESCRIPTION : find n elements in one walk of the tree. the elements
+are split between the childrens at each node, so a node is compared
+once with all the elements that pass it.
+PARAMETERS : pointer to avl, array of n pointers to data, array of
+n flags set to TRUE for the found elements and FALSE for the others.
+RETURN : SUCCESS, or FAIL if memory ran out.
+COMPLEXITY : time - O(n*log(n)), space - O(n) 
+*/
+status_ty AvlFindBatch(const avl_ty *avl, void **datas, size_t n,
+                                                     bool_ty *found);
+
 /*
 DESCRIPTION : executes a function on each
-element in avl tree.
+element in avl tree. in a multiset each distinct
+element is visited once. stops when the function
+returns non zero.
 PARAMETERS : pointer to avl, pointer to action function,
 pointer to params of action function and traversal order.
-RETURN : SUCCESS or FAIL.
+RETURN : SUCCESS, or FAIL if stopped by the action function.
 COMPLEXITY : time - O(n), space - O(1) 
 */
 status_ty AvlForEach(avl_ty *avl, action_func action,
 						 void *params, trav_ty trav);
+
+/*
+DESCRIPTION : create a cursor for in order walks on avl. avl may be
+changed between moves, AvlCursorNext then continues from the first
+element greater than the one returned last, which must not be freed
+until the cursor moves. elements equal to it are skipped. in a
+multiset each distinct element is visited once.
+PARAMETERS : pointer to avl.
+RETURN : pointer to the new cursor, not positioned.
+COMPLEXITY : time - O(1), space - O(logn) 
+*/
+avl_cursor_ty *AvlCursorCreate(const avl_ty *avl);
+
+/*
+DESCRIPTION : destroy a cursor
+PARAMETERS : pointer to cursor
+RETURN : void
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+void AvlCursorDestroy(avl_cursor_ty *cursor);
+
+/*
+DESCRIPTION : move the cursor to the smallest element
+PARAMETERS : pointer to cursor
+RETURN : the element, or NULL if avl is empty.
+COMPLEXITY : time - O(logn), space - O(1) 
+*/
+void *AvlCursorFirst(avl_cursor_ty *cursor);
+
+/*
+DESCRIPTION : move the cursor to the first element
+that is not smaller than data
+PARAMETERS : pointer to cursor, pointer to data
+RETURN : the element, or NULL if there is none.
+COMPLEXITY : time - O(logn), space - O(1) 
+*/
+void *AvlCursorSeek(avl_cursor_ty *cursor, void *data);
+
+/*
+DESCRIPTION : move the cursor to the next element
+PARAMETERS : pointer to cursor
+RETURN : the element, or NULL at the end.
+COMPLEXITY : time - O(1) amortized, space - O(1) 
+*/
+void *AvlCursorNext(avl_cursor_ty *cursor);
+
+/*
+DESCRIPTION : executes a function in order on at most max_nodes
+elements, starting after the element state visited last, or at the
+smallest element for a new cursor. avl may be changed between calls
+as with AvlCursorNext. stops when the function returns non zero.
+PARAMETERS : pointer to avl, cursor of avl holding the position,
+pointer to action function, pointer to params of action function,
+max num of elements for this call, pointer to a flag set to TRUE
+when the walk is done or stopped.
+RETURN : SUCCESS, or FAIL if stopped by the action function.
+COMPLEXITY : time - O(max_nodes + logn), space - O(1) 
+*/
+status_ty AvlForEachBudget(avl_ty *avl, avl_cursor_ty *state,
+                           action_func action, void *params,
+                           size_t max_nodes, bool_ty *is_done);
+
+/*
+DESCRIPTION : return the element at the cursor
+PARAMETERS : pointer to cursor
+RETURN : the element, or NULL at the end.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+void *AvlCursorGet(const avl_cursor_ty *cursor);
+
+/*
+DESCRIPTION : reduce the elements in [lo, hi] of an augmented
+avl tree with its aug function.
+PARAMETERS : pointer to augmented avl, pointers to lo and hi,
+pointer to aug_size bytes for the result.
+RETURN : SUCCESS, or FAIL if no element is in range.
+COMPLEXITY : time - O(logn), space - O(1) 
+*/
+status_ty AvlAggregateRange(const avl_ty *avl, const void *lo,
+                            const void *hi, void *out);
+
+/*
+DESCRIPTION : executes a function on each interval of an
+interval tree that contains point, in start order. stops
+when the function returns non zero.
+PARAMETERS : pointer to interval avl, the point, pointer to
+action function and pointer to params of action function.
+RETURN : SUCCESS, or FAIL if stopped by the action function.
+COMPLEXITY : time - O(logn + k), space - O(logn) 
+*/
+status_ty AvlIntervalStab(const avl_ty *avl, long point,
+                          action_func action, void *params);
+
+/*
+DESCRIPTION : executes a function on each interval of an
+interval tree that overlaps [lo, hi), in start order. stops
+when the function returns non zero.
+PARAMETERS : pointer to interval avl, lo and hi, pointer to
+action function and pointer to params of action function.
+RETURN : SUCCESS, or FAIL if stopped by the action function.
+COMPLEXITY : time - O(logn + k), space - O(logn) 
+*/
+status_ty AvlIntervalOverlap(const avl_ty *avl, long lo, long hi,
+                             action_func action, void *params);
 						 
+/*
+DESCRIPTION : relocate the nodes of avl into one allocation, laid out
+in blocks of the top levels of each sub tree, so searches touch fewer
+cache lines and pages. tree shape and elements are not changed.
+PARAMETERS : pointer to avl.
+RETURN : SUCCESS or FAIL.
+COMPLEXITY : time - O(n), space - O(n) 
+*/
+status_ty AvlCompact(avl_ty *avl);
+
+/*
+DESCRIPTION : run AvlCompact in slices. each call relocates about
+max_nodes nodes and returns. the avl may be changed between calls,
+nodes inserted or rotated into the relocated part stay in place.
+PARAMETERS : pointer to avl, max nodes for this slice, pointer
+to a flag set to TRUE when the compaction is done.
+RETURN : SUCCESS or FAIL.
+COMPLEXITY : time - O(max_nodes), space - O(n) 
+*/
+status_ty AvlCompactStep(avl_ty *avl, size_t max_nodes, bool_ty *is_done);
+
+/*
+DESCRIPTION : count the nodes of avl that are in an arena of
+AvlCompact, lazy removed nodes included.
+PARAMETERS : pointer to avl
+RETURN : num of nodes in arenas
+COMPLEXITY : time - O(n), space - O(logn) 
+*/
+size_t AvlCountCompacted(const avl_ty *avl);
+
+/*
+DESCRIPTION : put a small set associative cache of found nodes in
+front of AvlFind and AvlCount, so repeated finds of hot keys skip
+the walk from the root. concurrent finds may share the cache, but
+inserts and removes still need exclusive access. a stat count of a
+concurrent find may be lost.
+PARAMETERS : pointer to avl, hash function, num of cached nodes,
+rounded up to a power of 2.
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(entries), space - O(entries) 
+*/
+status_ty AvlEnableCache(avl_ty *avl, hash_func hash, size_t entries);
+
+/*
+DESCRIPTION : get the num of finds served by the cache and
+the num of finds that walked the tree
+PARAMETERS : pointer to avl, pointers to hits and misses
+RETURN : void
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+void AvlGetCacheStats(const avl_ty *avl, size_t *hits, size_t *misses);
+
+/*
+DESCRIPTION : get the num of single rotations done since the tree
+was created, a double rotation counts two.
+PARAMETERS : pointer to avl
+RETURN : num of rotations(size_t)
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+size_t AvlGetRotations(const avl_ty *avl);
+
+/*
+DESCRIPTION : get the latency histogram of one kind of operation
+since the tree was created or reset. the times are recorded only
+when avl.c is compiled with AVL_LATENCY, else nothing is measured.
+the histograms are allocated by the first measured operation, and a
+clone starts without them. the first 8 threads that measure record
+to their own copies, later threads share those, and the copies are
+summed here.
+PARAMETERS : pointer to avl, the operation, pointer to histogram
+RETURN : SUCCESS, or FAIL with an empty histogram when compiled
+without AVL_LATENCY.
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+status_ty AvlGetLatencyHistogram(const avl_ty *avl, latency_op_ty op,
+                                 avl_histogram_ty *hist);
+
+/*
+DESCRIPTION : clear the latency histograms of all operations.
+no thread may use the tree meanwhile.
+PARAMETERS : pointer to avl
+RETURN : void
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+void AvlResetLatency(avl_ty *avl);
+
+/*
+DESCRIPTION : get the time that percentile of the operations in
+hist did not pass, rounded up to the end of its bucket.
+PARAMETERS : pointer to histogram, percentile between 0 and 100
+RETURN : the time in ticks, 0 for an empty histogram
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+unsigned long AvlLatencyPercentile(const avl_histogram_ty *hist,
+                                   double percentile);
+
+/*
+DESCRIPTION : keep a counting bloom filter of the elements, so
+AvlFind and AvlCount of most missing elements return without
+walking the tree.
+PARAMETERS : pointer to avl, hash function, expected num of
+elements, rate of missing elements that still walk the tree
+when avl holds capacity elements.
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(n + capacity), space - O(capacity) 
+*/
+status_ty AvlEnableFilter(avl_ty *avl, hash_func hash, size_t capacity,
+                                                  double false_positive);
+
+/*
+DESCRIPTION : keep a hash index from the elements to their nodes,
+updated by every insert and remove. AvlFind and AvlCount look up
+the index instead of walking the tree, ordered operations still
+use the tree.
+PARAMETERS : pointer to avl, hash function.
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(n), space - O(n) 
+*/
+status_ty AvlEnableIndex(avl_ty *avl, hash_func hash);
+
+/*
+DESCRIPTION : make removes lazy. the node of a removed element is
+only marked dead, with no rotations, and finds, cursors and
+traversals pass over it. an insert of an equal element revives the
+node. when the dead nodes pass max_dead_percent of the nodes, the
+tree is rebuilt balanced from its live nodes in linear time.
+the elements must be unique, a dead node hides equal elements
+below it. not for augmented trees, their aggregates would count
+the dead elements.
+PARAMETERS : pointer to avl, percent of dead nodes that starts a
+rebuild, 1 to 100.
+RETURN : void
+COMPLEXITY : time - O(1), space - O(1) 
+*/
+void AvlEnableLazyRemove(avl_ty *avl, size_t max_dead_percent);
+
+/*
+DESCRIPTION : compare functions of elements that are pointers to
+int or to double, with batch versions that use SIMD when the target
+supports it. for AvlCreate or AvlCreateBatch.
+*/
+int AvlCmpInts(const void *avl_data, const void *user_data, void *params);
+void AvlCmpBatchInts(const void *avl_data, const void **user_datas, size_t n,
+                                                int *out, void *params);
+int AvlCmpDoubles(const void *avl_data, const void *user_data, void *params);
+void AvlCmpBatchDoubles(const void *avl_data, const void **user_datas, size_t n,
+                                                   int *out, void *params);
+
 void TreePrint(avl_ty *avl);
 
 #endif /* __ILRD_OL127_128_AVLTREE_H__ */
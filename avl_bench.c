@@ -0,0 +1,1306 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_create, pthread_mutex_t */
+#include <stdio.h> /* printf, sprintf */
+#include <math.h> /* pow */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* strcmp, strcpy */
+#include <time.h> /* clock_gettime */
+
+#include "avl.h"
+#include "avl_block.h"
+#include "avl_fc.h"
+#include "avl_lsm.h"
+#include "avl_merge.h"
+#include "avl_paged.h"
+#include "avl_snapshot.h"
+
+#define STR_NUM 200000
+#define STR_MAX 128
+#define INT_NUM 1000000
+#define THREADS_NUM 8
+#define ZIPF_S 0.99
+#define ZIPF_FINDS 4000000
+#define CACHE_ENTRIES 16384
+#define PAGED_NUM 200000
+#define PAGED_PATH "avl_bench.db"
+#define BATCH_SIZE 4096
+#define LSM_THRESHOLD 65536
+#define MERGE_TREES 256
+#define MERGE_TOP 100
+#define CHECKPOINT_PATH "avl_bench.snap"
+#define DIFF_CHANGES 100
+#define LAZY_DEAD_PERCENT 50
+#define LAZY_BURST (INT_NUM * 3 / 5)
+
+typedef void (*bench_func)(void);
+
+typedef struct
+{
+	const char *name;
+	bench_func bench;
+} bench_ty;
+
+void StringKeysBench(void);
+void BlockKeysBench(void);
+void CompactBench(void);
+void CombiningBench(void);
+void HotKeysBench(void);
+void MissesBench(void);
+void PagedBench(void);
+void BatchBench(void);
+void IngestBench(void);
+void IndexBench(void);
+void CloneBench(void);
+void MergeBench(void);
+void CheckpointBench(void);
+void DiffBench(void);
+void PolicyBench(void);
+void LatencyBench(void);
+void LazyRemoveBench(void);
+
+double Now(void);
+void Shuffle(void **arr, size_t n);
+void ShuffleLongs(long *arr, size_t n);
+char *MakeUrl(size_t i);
+char *MakePath(size_t i);
+int CompareLongs(const void *avl_data, const void *user_data, void *params);
+unsigned long HashLong(const void *data, void *params);
+int CompareStrings(const void *avl_data, const void *user_data, void *params);
+const char *GetString(const void *data, void *params);
+
+
+bench_ty benches[] = {
+						{"strings", &StringKeysBench},
+						{"blocks", &BlockKeysBench},
+						{"compact", &CompactBench},
+						{"combining", &CombiningBench},
+						{"hotkeys", &HotKeysBench},
+						{"misses", &MissesBench},
+						{"paged", &PagedBench},
+						{"batch", &BatchBench},
+						{"ingest", &IngestBench},
+						{"index", &IndexBench},
+						{"clone", &CloneBench},
+						{"merge", &MergeBench},
+						{"checkpoint", &CheckpointBench},
+						{"diff", &DiffBench},
+						{"policy", &PolicyBench},
+						{"latency", &LatencyBench},
+						{"lazy", &LazyRemoveBench}
+					 };
+
+
+int main(int argc, char *argv[])
+{
+	size_t i = 0;
+
+	for(i = 0; i < sizeof(benches) / sizeof(benches[0]); ++i)
+	{
+		if(1 == argc || 0 == strcmp(argv[1], benches[i].name))
+		{
+			printf("--- %s ---\n", benches[i].name);
+			benches[i].bench();
+		}
+	}
+
+	return 0;
+}
+
+
+static double LookupAll(avl_ty *avl, void **probes, size_t n)
+{
+	double start = Now();
+	size_t i = 0;
+
+	for(i = 0; i < n; ++i)
+	{
+		if(SUCCESS != AvlFind(avl, probes[i]))
+		{
+			abort();
+		}
+	}
+
+	return (Now() - start) * 1e9 / n;
+}
+
+static void StringDatasetBench(const char *name, char *(*make)(size_t))
+{
+	void **keys = (void **)malloc(STR_NUM * sizeof(void *));
+	void **probes = (void **)malloc(STR_NUM * sizeof(void *));
+	avl_ty *plain = AvlCreate(&CompareStrings, NULL);
+	avl_ty *prefixed = AvlCreateString(&CompareStrings, NULL, &GetString);
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != probes && NULL != plain && NULL != prefixed);
+
+	for(i = 0; i < STR_NUM; ++i)
+	{
+		keys[i] = make(i);
+		probes[i] = make(i);
+		AvlInsert(plain, keys[i]);
+		AvlInsert(prefixed, keys[i]);
+	}
+	Shuffle(probes, STR_NUM);
+
+	printf("%-6s plain cmp      : %6.1f ns/find\n", name,
+											LookupAll(plain, probes, STR_NUM));
+	printf("%-6s prefix cached  : %6.1f ns/find\n", name,
+										LookupAll(prefixed, probes, STR_NUM));
+
+	AvlDestroy(plain);
+	AvlDestroy(prefixed);
+	for(i = 0; i < STR_NUM; ++i)
+	{
+		free(keys[i]);
+		free(probes[i]);
+	}
+	free(keys);
+	free(probes);
+}
+
+void StringKeysBench(void)
+{
+	StringDatasetBench("urls", &MakeUrl);
+	StringDatasetBench("paths", &MakePath);
+}
+
+
+void BlockKeysBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long *probes = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	avl_block_ty *blocks = AvlBlockCreate();
+	double start = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != probes && NULL != avl && NULL != blocks);
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i * 3;
+		probes[i] = keys[i];
+	}
+	ShuffleLongs(keys, INT_NUM);
+	ShuffleLongs(probes, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+		AvlBlockInsert(blocks, keys[i], keys + i);
+	}
+
+	start = Now();
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		if(SUCCESS != AvlFind(avl, probes + i))
+		{
+			abort();
+		}
+	}
+	printf("node per key   : %6.1f ns/find, hight %ld\n",
+		   (Now() - start) * 1e9 / INT_NUM, AvlHeight(avl));
+
+	start = Now();
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		if(SUCCESS != AvlBlockFind(blocks, probes[i], NULL))
+		{
+			abort();
+		}
+	}
+	printf("block per node : %6.1f ns/find, hight %ld\n",
+		   (Now() - start) * 1e9 / INT_NUM, AvlBlockHeight(blocks));
+
+	AvlDestroy(avl);
+	AvlBlockDestroy(blocks);
+	free(keys);
+	free(probes);
+}
+
+
+static double FindLongs(avl_ty *avl, long *probes, size_t n)
+{
+	double start = Now();
+	size_t i = 0;
+
+	for(i = 0; i < n; ++i)
+	{
+		if(SUCCESS != AvlFind(avl, probes + i))
+		{
+			abort();
+		}
+	}
+
+	return (Now() - start) * 1e9 / n;
+}
+
+void CompactBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long *probes = (long *)malloc(INT_NUM * sizeof(long));
+	void **garbage = (void **)malloc(INT_NUM * sizeof(void *));
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	double start = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != probes && NULL != garbage && NULL != avl);
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+		probes[i] = keys[i];
+	}
+	ShuffleLongs(keys, INT_NUM);
+	ShuffleLongs(probes, INT_NUM);
+
+	/* interleave the nodes with other allocations and churn the tree */
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+		garbage[i] = malloc(16 + rand() % 256);
+	}
+	for(i = 0; i < INT_NUM; i += 2)
+	{
+		AvlRemove(avl, keys + i);
+		free(garbage[i]);
+		garbage[i] = malloc(16 + rand() % 256);
+	}
+	for(i = 0; i < INT_NUM; i += 2)
+	{
+		AvlInsert(avl, keys + i);
+	}
+
+	printf("fragmented     : %6.1f ns/find\n", FindLongs(avl, probes, INT_NUM));
+
+	start = Now();
+	AvlCompact(avl);
+	printf("compaction     : %6.1f ms\n", (Now() - start) * 1e3);
+
+	printf("compacted      : %6.1f ns/find\n", FindLongs(avl, probes, INT_NUM));
+
+	AvlDestroy(avl);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		free(garbage[i]);
+	}
+	free(garbage);
+	free(keys);
+	free(probes);
+}
+
+
+typedef struct
+{
+	pthread_mutex_t *lock;
+	avl_ty *avl;
+	avl_fc_ty *fc;
+	long *keys;
+} contended_ty;
+
+static void *MutexWorker(void *arg)
+{
+	contended_ty *worker = (contended_ty *)arg;
+	size_t i = 0;
+
+	for(i = 0; i < INT_NUM / THREADS_NUM; ++i)
+	{
+		pthread_mutex_lock(worker->lock);
+		AvlInsert(worker->avl, worker->keys + i);
+		pthread_mutex_unlock(worker->lock);
+	}
+
+	return NULL;
+}
+
+static void *CombiningWorker(void *arg)
+{
+	contended_ty *worker = (contended_ty *)arg;
+	avl_fc_slot_ty *slot = AvlFcJoin(worker->fc);
+	size_t i = 0;
+
+	assert(NULL != slot);
+	for(i = 0; i < INT_NUM / THREADS_NUM; ++i)
+	{
+		AvlFcInsert(slot, worker->keys + i);
+	}
+
+	return NULL;
+}
+
+static double RunWorkers(void *(*work)(void *), contended_ty *workers)
+{
+	pthread_t threads[THREADS_NUM];
+	double start = Now();
+	size_t i = 0;
+
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		pthread_create(threads + i, NULL, work, workers + i);
+	}
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	return (Now() - start) * 1e9 / INT_NUM;
+}
+
+void CombiningBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	contended_ty workers[THREADS_NUM];
+	pthread_mutex_t lock;
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	avl_fc_ty *fc = AvlFcCreate(&CompareLongs, NULL, THREADS_NUM);
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != avl && NULL != fc);
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	pthread_mutex_init(&lock, NULL);
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		workers[i].lock = &lock;
+		workers[i].avl = avl;
+		workers[i].fc = fc;
+		workers[i].keys = keys + i * (INT_NUM / THREADS_NUM);
+	}
+
+	printf("mutex, %d threads     : %6.1f ns/insert\n", THREADS_NUM,
+										RunWorkers(&MutexWorker, workers));
+	printf("combining, %d threads : %6.1f ns/insert\n", THREADS_NUM,
+									RunWorkers(&CombiningWorker, workers));
+
+	pthread_mutex_destroy(&lock);
+	AvlDestroy(avl);
+	AvlFcDestroy(fc);
+	free(keys);
+}
+
+
+/* probes of keys ranked by a zipf distribution, rank r drawn with
+   probability proportional to 1 / r^ZIPF_S */
+static long *MakeZipfTrace(const long *keys, size_t n, size_t trace_size)
+{
+	double *cdf = (double *)malloc(n * sizeof(double));
+	long *trace = (long *)malloc(trace_size * sizeof(long));
+	double sum = 0;
+	double u = 0;
+	size_t lo = 0;
+	size_t hi = 0;
+	size_t i = 0;
+
+	assert(NULL != cdf && NULL != trace);
+
+	for(i = 0; i < n; ++i)
+	{
+		sum += 1.0 / pow((double)(i + 1), ZIPF_S);
+		cdf[i] = sum;
+	}
+	for(i = 0; i < trace_size; ++i)
+	{
+		u = (double)rand() / ((double)RAND_MAX + 1) * sum;
+		lo = 0;
+		hi = n - 1;
+		while(lo < hi)
+		{
+			if(cdf[lo + (hi - lo) / 2] < u)
+			{
+				lo = lo + (hi - lo) / 2 + 1;
+			}
+			else
+			{
+				hi = lo + (hi - lo) / 2;
+			}
+		}
+		trace[i] = keys[lo];
+	}
+	free(cdf);
+
+	return trace;
+}
+
+void HotKeysBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long *trace = NULL;
+	avl_ty *plain = AvlCreate(&CompareLongs, NULL);
+	avl_ty *cached = AvlCreate(&CompareLongs, NULL);
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != plain && NULL != cached);
+	assert(SUCCESS == AvlEnableCache(cached, &HashLong, CACHE_ENTRIES));
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(plain, keys + i);
+		AvlInsert(cached, keys + i);
+	}
+	/* the hot ranks are spread over the key space */
+	trace = MakeZipfTrace(keys, INT_NUM, ZIPF_FINDS);
+
+	printf("zipf %.2f, plain  : %6.1f ns/find\n", ZIPF_S,
+								FindLongs(plain, trace, ZIPF_FINDS));
+	printf("zipf %.2f, cached : %6.1f ns/find\n", ZIPF_S,
+								FindLongs(cached, trace, ZIPF_FINDS));
+	AvlGetCacheStats(cached, &hits, &misses);
+	printf("cache hit rate   : %6.1f %%\n", 100.0 * hits / (hits + misses));
+
+	AvlDestroy(plain);
+	AvlDestroy(cached);
+	free(trace);
+	free(keys);
+}
+
+
+static double MissLongs(avl_ty *avl, long *probes, size_t n)
+{
+	double start = Now();
+	size_t i = 0;
+
+	for(i = 0; i < n; ++i)
+	{
+		if(FAIL != AvlFind(avl, probes + i))
+		{
+			abort();
+		}
+	}
+
+	return (Now() - start) * 1e9 / n;
+}
+
+void MissesBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long *probes = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *plain = AvlCreate(&CompareLongs, NULL);
+	avl_ty *filtered = AvlCreate(&CompareLongs, NULL);
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != probes && NULL != plain && NULL != filtered);
+	assert(SUCCESS == AvlEnableFilter(filtered, &HashLong, INT_NUM, 0.01));
+
+	/* even keys in the trees, odd ones missing */
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i * 2;
+		probes[i] = keys[i] + 1;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	ShuffleLongs(probes, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(plain, keys + i);
+		AvlInsert(filtered, keys + i);
+	}
+
+	printf("plain          : %6.1f ns/miss\n", MissLongs(plain, probes, INT_NUM));
+	printf("filter 1%%      : %6.1f ns/miss\n",
+									MissLongs(filtered, probes, INT_NUM));
+
+	AvlDestroy(plain);
+	AvlDestroy(filtered);
+	free(keys);
+	free(probes);
+}
+
+
+static double InsertLongs(avl_ty *avl, long *keys, size_t n)
+{
+	double start = Now();
+	size_t i = 0;
+
+	for(i = 0; i < n; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+
+	return (Now() - start) * 1e9 / n;
+}
+
+void IndexBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long *probes = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *plain = AvlCreate(&CompareLongs, NULL);
+	avl_ty *indexed = AvlCreate(&CompareLongs, NULL);
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != probes && NULL != plain && NULL != indexed);
+	assert(SUCCESS == AvlEnableIndex(indexed, &HashLong));
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+		probes[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	ShuffleLongs(probes, INT_NUM);
+
+	printf("plain   : %6.1f ns/insert\n", InsertLongs(plain, keys, INT_NUM));
+	printf("indexed : %6.1f ns/insert\n", InsertLongs(indexed, keys, INT_NUM));
+	printf("plain   : %6.1f ns/find\n", FindLongs(plain, probes, INT_NUM));
+	printf("indexed : %6.1f ns/find\n", FindLongs(indexed, probes, INT_NUM));
+
+	AvlDestroy(plain);
+	AvlDestroy(indexed);
+	free(keys);
+	free(probes);
+}
+
+
+static void PagedPoolBench(const long *keys, size_t pool_pages)
+{
+	avl_paged_ty *paged = NULL;
+	long record[2]; /* a key and a value, ordered by the key */
+	double insert_ns = 0;
+	double find_ns = 0;
+	double start = 0;
+	size_t reads = 0;
+	size_t writes = 0;
+	size_t i = 0;
+
+	remove(PAGED_PATH);
+	paged = AvlPagedOpen(PAGED_PATH, sizeof(record), &CompareLongs, NULL,
+															pool_pages);
+	assert(NULL != paged);
+
+	start = Now();
+	for(i = 0; i < PAGED_NUM; ++i)
+	{
+		record[0] = keys[i];
+		record[1] = keys[i] * 3;
+		AvlPagedInsert(paged, record);
+	}
+	insert_ns = (Now() - start) * 1e9 / PAGED_NUM;
+
+	start = Now();
+	for(i = 0; i < PAGED_NUM; ++i)
+	{
+		record[0] = keys[PAGED_NUM - 1 - i];
+		if(SUCCESS != AvlPagedFind(paged, record, record) ||
+		   record[1] != record[0] * 3)
+		{
+			abort();
+		}
+	}
+	find_ns = (Now() - start) * 1e9 / PAGED_NUM;
+
+	AvlPagedGetStats(paged, &reads, &writes);
+	printf("pool %5lu pages: %6.1f ns/insert %6.1f ns/find "
+		   "%8lu reads %8lu writes\n", (unsigned long)pool_pages,
+		   insert_ns, find_ns, (unsigned long)reads, (unsigned long)writes);
+
+	AvlPagedClose(paged);
+	remove(PAGED_PATH);
+}
+
+void PagedBench(void)
+{
+	long *keys = (long *)malloc(PAGED_NUM * sizeof(long));
+	size_t i = 0;
+
+	assert(NULL != keys);
+	for(i = 0; i < PAGED_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, PAGED_NUM);
+
+	/* the tree takes about 2000 pages, 10 times the middle pool */
+	PagedPoolBench(keys, 4096);
+	PagedPoolBench(keys, 200);
+	PagedPoolBench(keys, 32);
+
+	free(keys);
+}
+
+
+/* finds of int probes, one by one or BATCH_SIZE at a time */
+static double FindInts(avl_ty *avl, void **probes, size_t n, bool_ty batched)
+{
+	static bool_ty found[BATCH_SIZE];
+	double start = Now();
+	size_t i = 0;
+	size_t j = 0;
+
+	for(i = 0; i < n; i += BATCH_SIZE)
+	{
+		if(batched)
+		{
+			AvlFindBatch(avl, probes + i, BATCH_SIZE, found);
+		}
+		for(j = 0; !batched && j < BATCH_SIZE; ++j)
+		{
+			found[j] = (SUCCESS == AvlFind(avl, probes[i + j]));
+		}
+		for(j = 0; j < BATCH_SIZE; ++j)
+		{
+			if(!found[j])
+			{
+				abort();
+			}
+		}
+	}
+
+	return (Now() - start) * 1e9 / n;
+}
+
+void BatchBench(void)
+{
+	int *ints = (int *)malloc(INT_NUM * sizeof(int));
+	void **keys = (void **)malloc(INT_NUM * sizeof(void *));
+	void **probes = (void **)malloc(INT_NUM * sizeof(void *));
+	avl_ty *scalar = AvlCreate(&AvlCmpInts, NULL);
+	avl_ty *simd = AvlCreateBatch(&AvlCmpInts, &AvlCmpBatchInts, NULL);
+	size_t n = INT_NUM / BATCH_SIZE * BATCH_SIZE;
+	size_t i = 0;
+
+	assert(NULL != ints && NULL != keys && NULL != probes);
+	assert(NULL != scalar && NULL != simd);
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		ints[i] = (int)i;
+		keys[i] = ints + i;
+		probes[i] = ints + i;
+	}
+	AvlBulkLoad(scalar, keys, INT_NUM);
+	AvlBulkLoad(simd, keys, INT_NUM);
+	Shuffle(probes, INT_NUM);
+
+	printf("AvlFind        : %6.1f ns/find\n",
+								FindInts(scalar, probes, n, FALSE));
+	printf("batch, scalar  : %6.1f ns/find\n",
+								FindInts(scalar, probes, n, TRUE));
+	printf("batch, simd    : %6.1f ns/find\n",
+								FindInts(simd, probes, n, TRUE));
+
+	AvlDestroy(scalar);
+	AvlDestroy(simd);
+	free(ints);
+	free(keys);
+	free(probes);
+}
+
+
+/* inserts of shuffled keys, then a find of each */
+void IngestBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	avl_lsm_ty *lsm = AvlLsmCreate(&CompareLongs, NULL, LSM_THRESHOLD);
+	double start = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != avl && NULL != lsm);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+
+	start = Now();
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+	printf("AvlInsert      : %6.1f ns/insert\n",
+							(Now() - start) * 1e9 / INT_NUM);
+
+	start = Now();
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlLsmInsert(lsm, keys + i);
+	}
+	printf("buffered       : %6.1f ns/insert\n",
+							(Now() - start) * 1e9 / INT_NUM);
+	AvlLsmMerge(lsm);
+	printf("  with merge   : %6.1f ns/insert\n",
+							(Now() - start) * 1e9 / INT_NUM);
+
+	start = Now();
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		if(SUCCESS != AvlLsmFind(lsm, keys + i))
+		{
+			abort();
+		}
+	}
+	printf("buffered find  : %6.1f ns/find\n",
+							(Now() - start) * 1e9 / INT_NUM);
+
+	AvlDestroy(avl);
+	AvlLsmDestroy(lsm);
+	free(keys);
+}
+
+
+static double RemoveLongs(avl_ty *avl, long *keys, size_t n)
+{
+	double start = Now();
+	size_t i = 0;
+
+	for(i = 0; i < n; ++i)
+	{
+		AvlRemove(avl, keys + i);
+	}
+
+	return (Now() - start) * 1e9 / n;
+}
+
+static int InsertTo(void *data, void *params)
+{
+	return (SUCCESS != AvlInsert((avl_ty *)params, data));
+}
+
+/* a copy by inserts against a clone, then changes of the copy */
+void CloneBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	avl_ty *copy = AvlCreate(&CompareLongs, NULL);
+	avl_ty *clone = NULL;
+	double start = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != avl && NULL != copy);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+
+	start = Now();
+	AvlForEach(avl, &InsertTo, copy, INORDER);
+	printf("copy by inserts : %8.3f ms\n", (Now() - start) * 1e3);
+	start = Now();
+	clone = AvlClone(avl);
+	printf("AvlClone        : %8.3f ms\n", (Now() - start) * 1e3);
+
+	ShuffleLongs(keys, INT_NUM);
+	printf("copy, remove    : %6.1f ns/remove\n",
+						RemoveLongs(copy, keys, INT_NUM / 10));
+	printf("clone, remove   : %6.1f ns/remove\n",
+						RemoveLongs(clone, keys, INT_NUM / 10));
+	printf("clone, again    : %6.1f ns/remove\n",
+			RemoveLongs(clone, keys + INT_NUM / 10, INT_NUM / 10));
+
+	AvlDestroy(avl);
+	AvlDestroy(copy);
+	AvlDestroy(clone);
+	free(keys);
+}
+
+
+static int CollectLong(void *data, void *params)
+{
+	long ***next = (long ***)params;
+
+	**next = (long *)data;
+	++*next;
+
+	return 0;
+}
+
+static int CompareLongPtrs(const void *a, const void *b)
+{
+	return CompareLongs(*(long *const *)a, *(long *const *)b, NULL);
+}
+
+/* the smallest elements of many trees, by collecting and sorting
+   them against a merge cursor */
+void MergeBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long **all = (long **)malloc(INT_NUM * sizeof(long *));
+	long **next = all;
+	avl_ty *avls[MERGE_TREES];
+	avl_merge_ty *merge = NULL;
+	double start = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != all);
+	for(i = 0; i < MERGE_TREES; ++i)
+	{
+		avls[i] = AvlCreate(&CompareLongs, NULL);
+		assert(NULL != avls[i]);
+	}
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avls[i % MERGE_TREES], keys + i);
+	}
+
+	start = Now();
+	for(i = 0; i < MERGE_TREES; ++i)
+	{
+		AvlForEach(avls[i], &CollectLong, &next, INORDER);
+	}
+	qsort(all, INT_NUM, sizeof(long *), &CompareLongPtrs);
+	printf("collect and sort, top %d : %8.3f ms\n", MERGE_TOP,
+											(Now() - start) * 1e3);
+
+	start = Now();
+	merge = AvlMergeCreate(avls, MERGE_TREES, &CompareLongs, NULL);
+	assert(NULL != merge);
+	all[0] = (long *)AvlMergeFirst(merge);
+	for(i = 1; i < MERGE_TOP; ++i)
+	{
+		all[i] = (long *)AvlMergeNext(merge);
+	}
+	printf("merge cursor, top %d     : %8.3f ms\n", MERGE_TOP,
+											(Now() - start) * 1e3);
+	assert((long)MERGE_TOP - 1 == *all[MERGE_TOP - 1]);
+
+	start = Now();
+	while(NULL != AvlMergeNext(merge))
+	{
+	}
+	printf("merge cursor, all       : %6.1f ns/element\n",
+							(Now() - start) * 1e9 / (INT_NUM - MERGE_TOP));
+
+	AvlMergeDestroy(merge);
+	for(i = 0; i < MERGE_TREES; ++i)
+	{
+		AvlDestroy(avls[i]);
+	}
+	free(all);
+	free(keys);
+}
+
+
+static size_t EncodeLong(const void *data, void *buf, size_t buf_size,
+													 void *params)
+{
+	(void)params;
+	if(sizeof(long) <= buf_size)
+	{
+		memcpy(buf, data, sizeof(long));
+	}
+
+	return sizeof(long);
+}
+
+/* the time writers wait for a blocking snapshot against a background
+   one, with inserts going on while it is written */
+void CheckpointBench(void)
+{
+	long *keys = (long *)malloc(2 * INT_NUM * sizeof(long));
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	avl_checkpoint_ty *checkpoint = NULL;
+	avl_checkpoint_stats_ty stats;
+	double start = 0;
+	size_t inserted = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != avl);
+	for(i = 0; i < 2 * INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+
+	start = Now();
+	assert(SUCCESS == AvlSnapshotSave(avl, CHECKPOINT_PATH, &EncodeLong,
+																NULL));
+	printf("AvlSnapshotSave    : %8.3f ms writers wait\n",
+											(Now() - start) * 1e3);
+
+	checkpoint = AvlCheckpointAsync(avl, CHECKPOINT_PATH, &EncodeLong, NULL);
+	assert(NULL != checkpoint);
+	while(!AvlCheckpointIsDone(checkpoint) && inserted < INT_NUM)
+	{
+		AvlInsert(avl, keys + INT_NUM + inserted);
+		++inserted;
+	}
+	assert(SUCCESS == AvlCheckpointWait(checkpoint, &stats));
+	printf("AvlCheckpointAsync : %8.3f ms writers wait\n",
+											stats.pause_seconds * 1e3);
+	printf("  background write : %8.3f ms, %6.1f MB/s\n",
+			stats.write_seconds * 1e3,
+			stats.bytes / stats.write_seconds / (1024 * 1024));
+	printf("  inserts meanwhile: %lu\n", (unsigned long)inserted);
+
+	AvlDestroy(avl);
+	remove(CHECKPOINT_PATH);
+	free(keys);
+}
+
+
+static int CountDiff(void *data, void *params)
+{
+	(void)data;
+	++*(size_t *)params;
+
+	return 0;
+}
+
+/* a clone with a few changes against an equal tree built apart */
+void DiffBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	avl_ty *copy = AvlCreate(&CompareLongs, NULL);
+	avl_ty *clone = NULL;
+	size_t found = 0;
+	double start = 0;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != avl && NULL != copy);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+		AvlInsert(copy, keys + i);
+	}
+	clone = AvlClone(avl);
+	assert(NULL != clone);
+	for(i = 0; i < DIFF_CHANGES; ++i)
+	{
+		AvlRemove(clone, keys + i);
+		AvlRemove(copy, keys + i);
+	}
+
+	start = Now();
+	AvlDiff(avl, clone, &CountDiff, &CountDiff, NULL, &found);
+	printf("diff of a clone    : %8.3f ms, %lu changes\n",
+				(Now() - start) * 1e3, (unsigned long)found);
+	found = 0;
+	start = Now();
+	AvlDiff(avl, copy, &CountDiff, &CountDiff, NULL, &found);
+	printf("diff of a copy     : %8.3f ms, %lu changes\n",
+				(Now() - start) * 1e3, (unsigned long)found);
+
+	AvlDestroy(avl);
+	AvlDestroy(clone);
+	AvlDestroy(copy);
+	free(keys);
+}
+
+static void PrintPolicyPhase(const char *phase, double start,
+							 size_t rotations, size_t ops)
+{
+	printf("  %-8s: %7.1f ns/op, %.3f rotations/op\n", phase,
+				(Now() - start) * 1e9 / ops, (double)rotations / ops);
+}
+
+/* keys holds 2 * INT_NUM keys. insert the first half, then remove
+   one and insert one of the second half per step, then remove all */
+static void PolicyWorkload(const char *name, balance_ty balance, long *keys)
+{
+	avl_ty *avl = AvlCreateWithPolicy(&CompareLongs, NULL, balance);
+	size_t rotations = 0;
+	double start = 0;
+	size_t i = 0;
+
+	assert(NULL != avl);
+	printf("%s\n", name);
+
+	start = Now();
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+	PrintPolicyPhase("insert", start, AvlGetRotations(avl), INT_NUM);
+
+	rotations = AvlGetRotations(avl);
+	start = Now();
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlRemove(avl, keys + i);
+		AvlInsert(avl, keys + INT_NUM + i);
+	}
+	PrintPolicyPhase("mixed", start, AvlGetRotations(avl) - rotations,
+															2 * INT_NUM);
+	printf("  %-8s: %ld\n", "hight", AvlHeight(avl));
+
+	rotations = AvlGetRotations(avl);
+	start = Now();
+	for(i = INT_NUM; i < 2 * INT_NUM; ++i)
+	{
+		AvlRemove(avl, keys + i);
+	}
+	PrintPolicyPhase("remove", start, AvlGetRotations(avl) - rotations,
+																INT_NUM);
+
+	AvlDestroy(avl);
+}
+
+void PolicyBench(void)
+{
+	long *keys = (long *)malloc(2 * INT_NUM * sizeof(long));
+	size_t i = 0;
+
+	assert(NULL != keys);
+	for(i = 0; i < 2 * INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+	}
+	ShuffleLongs(keys, 2 * INT_NUM);
+
+	PolicyWorkload("strict avl", STRICT_AVL, keys);
+	PolicyWorkload("weak avl", WEAK_AVL, keys);
+
+	free(keys);
+}
+
+static void PrintLatency(const avl_ty *avl, latency_op_ty op, const char *name)
+{
+	avl_histogram_ty hist;
+
+	AvlGetLatencyHistogram(avl, op, &hist);
+	printf("%-8s: p50 %6lu, p99 %6lu, p99.9 %7lu, max %8lu ticks\n", name,
+				AvlLatencyPercentile(&hist, 50),
+				AvlLatencyPercentile(&hist, 99),
+				AvlLatencyPercentile(&hist, 99.9),
+				AvlLatencyPercentile(&hist, 100));
+}
+
+/* the tails of random inserts, finds and removes, needs avl.c
+   compiled with -DAVL_LATENCY */
+void LatencyBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long *probes = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	avl_histogram_ty hist;
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != probes && NULL != avl);
+	if(SUCCESS != AvlGetLatencyHistogram(avl, LATENCY_INSERT, &hist))
+	{
+		printf("avl.c is compiled without AVL_LATENCY\n");
+		AvlDestroy(avl);
+		free(keys);
+		free(probes);
+		return;
+	}
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+		probes[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	ShuffleLongs(probes, INT_NUM);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		if(SUCCESS != AvlFind(avl, probes + i))
+		{
+			abort();
+		}
+	}
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlRemove(avl, probes + i);
+	}
+	assert(AvlIsEmpty(avl));
+	PrintLatency(avl, LATENCY_INSERT, "insert");
+	PrintLatency(avl, LATENCY_FIND, "find");
+	PrintLatency(avl, LATENCY_REMOVE, "remove");
+
+	AvlDestroy(avl);
+	free(keys);
+	free(probes);
+}
+
+/* a burst of removes of random keys, then finds of the rest */
+static void RemoveBurst(const char *name, avl_ty *avl, long *keys,
+						long *probes)
+{
+	double start = 0;
+	size_t i = 0;
+
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+
+	start = Now();
+	for(i = 0; i < LAZY_BURST; ++i)
+	{
+		AvlRemove(avl, probes + i);
+	}
+	printf("%-6s: %7.1f ns/remove", name, (Now() - start) * 1e9 / LAZY_BURST);
+
+	start = Now();
+	for(i = LAZY_BURST; i < INT_NUM; ++i)
+	{
+		if(SUCCESS != AvlFind(avl, probes + i))
+		{
+			abort();
+		}
+	}
+	printf(", %7.1f ns/find, hight %ld\n",
+			(Now() - start) * 1e9 / (INT_NUM - LAZY_BURST), AvlHeight(avl));
+}
+
+void LazyRemoveBench(void)
+{
+	long *keys = (long *)malloc(INT_NUM * sizeof(long));
+	long *probes = (long *)malloc(INT_NUM * sizeof(long));
+	avl_ty *eager = AvlCreate(&CompareLongs, NULL);
+	avl_ty *lazy = AvlCreate(&CompareLongs, NULL);
+	size_t i = 0;
+
+	assert(NULL != keys && NULL != probes && NULL != eager && NULL != lazy);
+	for(i = 0; i < INT_NUM; ++i)
+	{
+		keys[i] = (long)i;
+		probes[i] = (long)i;
+	}
+	ShuffleLongs(keys, INT_NUM);
+	ShuffleLongs(probes, INT_NUM);
+	AvlEnableLazyRemove(lazy, LAZY_DEAD_PERCENT);
+
+	RemoveBurst("eager", eager, keys, probes);
+	RemoveBurst("lazy", lazy, keys, probes);
+	assert(AvlSize(eager) == AvlSize(lazy));
+
+	AvlDestroy(eager);
+	AvlDestroy(lazy);
+	free(keys);
+	free(probes);
+}
+
+
+double Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void Shuffle(void **arr, size_t n)
+{
+	size_t i = 0;
+	size_t j = 0;
+	void *tmp = NULL;
+
+	for(i = n - 1; 0 < i; --i)
+	{
+		j = (size_t)rand() % (i + 1);
+		tmp = arr[i];
+		arr[i] = arr[j];
+		arr[j] = tmp;
+	}
+}
+
+void ShuffleLongs(long *arr, size_t n)
+{
+	size_t i = 0;
+	size_t j = 0;
+	long tmp = 0;
+
+	for(i = n - 1; 0 < i; --i)
+	{
+		j = (size_t)rand() % (i + 1);
+		tmp = arr[i];
+		arr[i] = arr[j];
+		arr[j] = tmp;
+	}
+}
+
+static const char *hosts[] = {"www.example.com", "api.example.com",
+							  "cdn.static.net", "docs.project.org",
+							  "shop.example.co.uk", "news.site.io",
+							  "mail.service.com", "git.company.dev"};
+static const char *words[] = {"index", "users", "products", "v1", "v2",
+							  "images", "search", "lib", "share", "include",
+							  "bin", "local", "src", "static", "docs"};
+
+/* deterministic in i, so the same i always gives an equal string */
+char *MakeUrl(size_t i)
+{
+	char *url = (char *)malloc(STR_MAX);
+	size_t h = i * 2654435761UL;
+
+	assert(NULL != url);
+	sprintf(url, "https://%s/%s/%s/%lu",
+			hosts[h % 8], words[(h >> 8) % 15], words[(h >> 16) % 15],
+			(unsigned long)i);
+
+	return url;
+}
+
+char *MakePath(size_t i)
+{
+	char *path = (char *)malloc(STR_MAX);
+	size_t h = i * 2654435761UL;
+
+	assert(NULL != path);
+	sprintf(path, "/%s/%s/%s/file%lu.c",
+			words[h % 15], words[(h >> 8) % 15], words[(h >> 16) % 15],
+			(unsigned long)i);
+
+	return path;
+}
+
+int CompareLongs(const void *avl_data, const void *user_data, void *params)
+{
+	long avl_long = *(const long *)avl_data;
+	long user_long = *(const long *)user_data;
+	(void)params;
+
+	return (avl_long > user_long) - (avl_long < user_long);
+}
+
+unsigned long HashLong(const void *data, void *params)
+{
+	unsigned long key = (unsigned long)*(const long *)data;
+	(void)params;
+
+	key ^= key >> 16;
+	key *= 0x45d9f3bUL;
+	key ^= key >> 16;
+
+	return key;
+}
+
+int CompareStrings(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+	return strcmp((const char *)avl_data, (const char *)user_data);
+}
+
+const char *GetString(const void *data, void *params)
+{
+	(void)params;
+	return (const char *)data;
+}
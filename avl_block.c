@@ -0,0 +1,615 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : avl tree of sorted integer blocks   *
+ *                                                   *
+ *****************************************************/
+#include <assert.h> /* assert */
+#include <limits.h> /* LONG_MAX */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memmove, memcpy */
+
+#if defined(__LP64__) && (defined(__AVX2__) || defined(__SSE4_2__))
+#include <immintrin.h>
+#endif
+
+#include "avl_block.h"
+
+#define UNDERFLOW_SIZE (AVL_BLOCK_SIZE / 4)
+
+typedef enum
+{
+	LEFT,
+	RIGHT,
+	CHILDREN_NUM
+} block_children_ty;
+
+typedef struct block_node block_node_ty;
+
+/* the unused tail of keys is kept LONG_MAX, so a search can scan
+   whole vectors without masking */
+struct block_node
+{
+	size_t count;
+	long hight;
+	block_node_ty *childrens[CHILDREN_NUM];
+	long keys[AVL_BLOCK_SIZE];
+	void *values[AVL_BLOCK_SIZE];
+};
+
+struct avl_block
+{
+	block_node_ty *root;
+	size_t size;
+};
+
+static block_node_ty *SubTreeBalance(block_node_ty *sub_tree);
+
+
+/*--------------- block search ------------*/
+
+#if defined(__LP64__) && (defined(__AVX2__) || defined(__SSE4_2__))
+static const unsigned char bits_lut[16] = {0, 1, 1, 2, 1, 2, 2, 3,
+										   1, 2, 2, 3, 2, 3, 3, 4};
+#endif
+
+/* num of keys in the block that are smaller than key */
+static size_t LowerBound(const block_node_ty *node, long key)
+{
+	size_t less = 0;
+	size_t i = 0;
+
+#if defined(__LP64__) && defined(__AVX2__)
+	__m256i probe = _mm256_set1_epi64x(key);
+
+	for(i = 0; i < node->count; i += 4)
+	{
+		__m256i keys = _mm256_loadu_si256((const __m256i *)(node->keys + i));
+		int mask = _mm256_movemask_pd(
+						_mm256_castsi256_pd(_mm256_cmpgt_epi64(probe, keys)));
+
+		less += bits_lut[mask];
+		if(0xf != mask)
+		{
+			break;
+		}
+	}
+#elif defined(__LP64__) && defined(__SSE4_2__)
+	__m128i probe = _mm_set1_epi64x(key);
+
+	for(i = 0; i < node->count; i += 2)
+	{
+		__m128i keys = _mm_loadu_si128((const __m128i *)(node->keys + i));
+		int mask = _mm_movemask_pd(
+						_mm_castsi128_pd(_mm_cmpgt_epi64(probe, keys)));
+
+		less += bits_lut[mask];
+		if(0x3 != mask)
+		{
+			break;
+		}
+	}
+#else
+	for(i = 0; i < node->count; ++i)
+	{
+		less += (node->keys[i] < key);
+	}
+#endif
+
+	return less;
+}
+
+static long GetMin(const block_node_ty *node)
+{
+	return node->keys[0];
+}
+
+static long GetMax(const block_node_ty *node)
+{
+	return node->keys[node->count - 1];
+}
+
+
+/*--------------- blocks ------------*/
+
+static block_node_ty *CreateBlock(void)
+{
+	size_t i = 0;
+	block_node_ty *new_node = (block_node_ty *)malloc(sizeof(block_node_ty));
+	if(NULL == new_node)
+	{
+		return NULL;
+	}
+
+	new_node->count = 0;
+	new_node->hight = 0;
+	new_node->childrens[LEFT] = NULL;
+	new_node->childrens[RIGHT] = NULL;
+	for(i = 0; i < AVL_BLOCK_SIZE; ++i)
+	{
+		new_node->keys[i] = LONG_MAX;
+	}
+
+	return new_node;
+}
+
+static void InsertAt(block_node_ty *node, size_t pos, long key, void *value)
+{
+	assert(AVL_BLOCK_SIZE > node->count);
+
+	memmove(node->keys + pos + 1, node->keys + pos,
+							(node->count - pos) * sizeof(long));
+	memmove(node->values + pos + 1, node->values + pos,
+							(node->count - pos) * sizeof(void *));
+	node->keys[pos] = key;
+	node->values[pos] = value;
+	++node->count;
+}
+
+static void RemoveAt(block_node_ty *node, size_t pos)
+{
+	memmove(node->keys + pos, node->keys + pos + 1,
+							(node->count - pos - 1) * sizeof(long));
+	memmove(node->values + pos, node->values + pos + 1,
+							(node->count - pos - 1) * sizeof(void *));
+	--node->count;
+	node->keys[node->count] = LONG_MAX;
+}
+
+/* move the keys of src after the keys of dest, all of src must be bigger */
+static void AppendBlock(block_node_ty *dest, block_node_ty *src)
+{
+	memcpy(dest->keys + dest->count, src->keys, src->count * sizeof(long));
+	memcpy(dest->values + dest->count, src->values,
+										src->count * sizeof(void *));
+	dest->count += src->count;
+}
+
+/* move the keys of src before the keys of dest, all of src must be smaller */
+static void PrependBlock(block_node_ty *dest, block_node_ty *src)
+{
+	memmove(dest->keys + src->count, dest->keys, dest->count * sizeof(long));
+	memmove(dest->values + src->count, dest->values,
+										dest->count * sizeof(void *));
+	memcpy(dest->keys, src->keys, src->count * sizeof(long));
+	memcpy(dest->values, src->values, src->count * sizeof(void *));
+	dest->count += src->count;
+}
+
+
+/*--------------- tree ------------*/
+
+avl_block_ty *AvlBlockCreate(void)
+{
+	avl_block_ty *new_tree = (avl_block_ty *)malloc(sizeof(avl_block_ty));
+	if(NULL == new_tree)
+	{
+		return NULL;
+	}
+
+	new_tree->root = NULL;
+	new_tree->size = 0;
+
+	return new_tree;
+}
+
+
+static void RecursionDestroy(block_node_ty *root)
+{
+	if(NULL == root)
+	{
+		return;
+	}
+	RecursionDestroy(root->childrens[LEFT]);
+	RecursionDestroy(root->childrens[RIGHT]);
+	free(root);
+}
+
+void AvlBlockDestroy(avl_block_ty *tree)
+{
+	assert(NULL != tree);
+
+	RecursionDestroy(tree->root);
+	free(tree);
+}
+
+
+static block_node_ty *InsertMostLeft(block_node_ty *root, block_node_ty *node)
+{
+	if(NULL == root)
+	{
+		return node;
+	}
+
+	root->childrens[LEFT] = InsertMostLeft(root->childrens[LEFT], node);
+
+	return SubTreeBalance(root);
+}
+
+/* insert into the block of root, splitting it when it is full */
+static block_node_ty *InsertToBlock(avl_block_ty *tree, block_node_ty *root,
+								long key, void *value, status_ty *status)
+{
+	block_node_ty *upper = NULL;
+	size_t pos = LowerBound(root, key);
+
+	if(pos < root->count && key == root->keys[pos])
+	{
+		root->values[pos] = value;
+		return root;
+	}
+
+	if(AVL_BLOCK_SIZE > root->count)
+	{
+		InsertAt(root, pos, key, value);
+		++tree->size;
+		return root;
+	}
+
+	upper = CreateBlock();
+	if(NULL == upper)
+	{
+		*status = FAIL;
+		return root;
+	}
+
+	root->count = AVL_BLOCK_SIZE / 2;
+	memcpy(upper->keys, root->keys + AVL_BLOCK_SIZE / 2,
+							(AVL_BLOCK_SIZE / 2) * sizeof(long));
+	memcpy(upper->values, root->values + AVL_BLOCK_SIZE / 2,
+							(AVL_BLOCK_SIZE / 2) * sizeof(void *));
+	upper->count = AVL_BLOCK_SIZE / 2;
+	for(pos = AVL_BLOCK_SIZE / 2; pos < AVL_BLOCK_SIZE; ++pos)
+	{
+		root->keys[pos] = LONG_MAX;
+	}
+
+	if(key < GetMin(upper))
+	{
+		InsertAt(root, LowerBound(root, key), key, value);
+	}
+	else
+	{
+		InsertAt(upper, LowerBound(upper, key), key, value);
+	}
+	++tree->size;
+
+	/* upper comes right after root in key order */
+	root->childrens[RIGHT] = InsertMostLeft(root->childrens[RIGHT], upper);
+
+	return SubTreeBalance(root);
+}
+
+static block_node_ty *RecursiveInsert(avl_block_ty *tree, block_node_ty *root,
+								long key, void *value, status_ty *status)
+{
+	if(NULL == root)
+	{
+		root = CreateBlock();
+		if(NULL == root)
+		{
+			*status = FAIL;
+			return NULL;
+		}
+		InsertAt(root, 0, key, value);
+		++tree->size;
+		return root;
+	}
+
+	if(key < GetMin(root) && NULL != root->childrens[LEFT])
+	{
+		root->childrens[LEFT] = RecursiveInsert(tree, root->childrens[LEFT],
+												key, value, status);
+	}
+	else if(key > GetMax(root) && NULL != root->childrens[RIGHT])
+	{
+		root->childrens[RIGHT] = RecursiveInsert(tree, root->childrens[RIGHT],
+												 key, value, status);
+	}
+	else
+	{
+		return InsertToBlock(tree, root, key, value, status);
+	}
+
+	return SubTreeBalance(root);
+}
+
+status_ty AvlBlockInsert(avl_block_ty *tree, long key, void *value)
+{
+	status_ty status = SUCCESS;
+	assert(NULL != tree);
+
+	tree->root = RecursiveInsert(tree, tree->root, key, value, &status);
+
+	return status;
+}
+
+
+static block_node_ty *RemoveMostLeft(block_node_ty *root,
+										block_node_ty **most_left)
+{
+	if(NULL == root->childrens[LEFT])
+	{
+		*most_left = root;
+		return root->childrens[RIGHT];
+	}
+
+	root->childrens[LEFT] = RemoveMostLeft(root->childrens[LEFT], most_left);
+
+	return SubTreeBalance(root);
+}
+
+static block_node_ty *RemoveMostRight(block_node_ty *root,
+										block_node_ty **most_right)
+{
+	if(NULL == root->childrens[RIGHT])
+	{
+		*most_right = root;
+		return root->childrens[LEFT];
+	}
+
+	root->childrens[RIGHT] = RemoveMostRight(root->childrens[RIGHT],
+															most_right);
+
+	return SubTreeBalance(root);
+}
+
+static block_node_ty *GetMostLeft(block_node_ty *node)
+{
+	while(NULL != node->childrens[LEFT])
+	{
+		node = node->childrens[LEFT];
+	}
+	return node;
+}
+
+static block_node_ty *GetMostRight(block_node_ty *node)
+{
+	while(NULL != node->childrens[RIGHT])
+	{
+		node = node->childrens[RIGHT];
+	}
+	return node;
+}
+
+/* merge a small block with its next or previous block in its sub tree */
+static void MergeNeighbour(block_node_ty *node)
+{
+	block_node_ty *neighbour = NULL;
+
+	if(NULL != node->childrens[RIGHT] &&
+	   AVL_BLOCK_SIZE >= node->count +
+	   					 GetMostLeft(node->childrens[RIGHT])->count)
+	{
+		node->childrens[RIGHT] = RemoveMostLeft(node->childrens[RIGHT],
+																&neighbour);
+		AppendBlock(node, neighbour);
+		free(neighbour);
+	}
+	else if(NULL != node->childrens[LEFT] &&
+			AVL_BLOCK_SIZE >= node->count +
+							  GetMostRight(node->childrens[LEFT])->count)
+	{
+		node->childrens[LEFT] = RemoveMostRight(node->childrens[LEFT],
+																&neighbour);
+		PrependBlock(node, neighbour);
+		free(neighbour);
+	}
+}
+
+static block_node_ty *RemoveNode(block_node_ty *rm_node)
+{
+	block_node_ty *next = NULL;
+	block_node_ty *right_sub_tree = NULL;
+
+	if(NULL == rm_node->childrens[LEFT] || NULL == rm_node->childrens[RIGHT])
+	{
+		next = (NULL == rm_node->childrens[LEFT]) ?
+		rm_node->childrens[RIGHT] :
+		rm_node->childrens[LEFT];
+
+		free(rm_node);
+		return next;
+	}
+
+	right_sub_tree = RemoveMostLeft(rm_node->childrens[RIGHT], &next);
+	next->childrens[LEFT] = rm_node->childrens[LEFT];
+	next->childrens[RIGHT] = right_sub_tree;
+	free(rm_node);
+
+	return SubTreeBalance(next);
+}
+
+static block_node_ty *RecursiveRemove(avl_block_ty *tree, block_node_ty *root,
+																 long key)
+{
+	size_t pos = 0;
+
+	if(NULL == root)
+	{
+		return NULL;
+	}
+
+	if(key < GetMin(root))
+	{
+		root->childrens[LEFT] = RecursiveRemove(tree, root->childrens[LEFT],
+																	 key);
+	}
+	else if(key > GetMax(root))
+	{
+		root->childrens[RIGHT] = RecursiveRemove(tree, root->childrens[RIGHT],
+																	 key);
+	}
+	else
+	{
+		pos = LowerBound(root, key);
+		if(key != root->keys[pos])
+		{
+			return root;
+		}
+
+		RemoveAt(root, pos);
+		--tree->size;
+		if(0 == root->count)
+		{
+			return RemoveNode(root);
+		}
+		if(UNDERFLOW_SIZE > root->count)
+		{
+			MergeNeighbour(root);
+		}
+	}
+
+	return SubTreeBalance(root);
+}
+
+void AvlBlockRemove(avl_block_ty *tree, long key)
+{
+	assert(NULL != tree);
+
+	tree->root = RecursiveRemove(tree, tree->root, key);
+}
+
+
+status_ty AvlBlockFind(const avl_block_ty *tree, long key, void **value)
+{
+	block_node_ty *node = NULL;
+	size_t pos = 0;
+
+	assert(NULL != tree);
+
+	node = tree->root;
+	while(NULL != node)
+	{
+		if(key < GetMin(node))
+		{
+			node = node->childrens[LEFT];
+		}
+		else if(key > GetMax(node))
+		{
+			node = node->childrens[RIGHT];
+		}
+		else
+		{
+			pos = LowerBound(node, key);
+			if(key != node->keys[pos])
+			{
+				return FAIL;
+			}
+			if(NULL != value)
+			{
+				*value = node->values[pos];
+			}
+			return SUCCESS;
+		}
+	}
+
+	return FAIL;
+}
+
+
+size_t AvlBlockSize(const avl_block_ty *tree)
+{
+	assert(NULL != tree);
+
+	return tree->size;
+}
+
+long AvlBlockHeight(const avl_block_ty *tree)
+{
+	assert(NULL != tree);
+
+	return (NULL == tree->root) ? 0 : tree->root->hight;
+}
+
+
+static status_ty InOrder(block_node_ty *root, block_action_func action,
+														 void *params)
+{
+	size_t i = 0;
+
+	if(NULL == root)
+	{
+		return SUCCESS;
+	}
+
+	if(SUCCESS != InOrder(root->childrens[LEFT], action, params))
+	{
+		return FAIL;
+	}
+	for(i = 0; i < root->count; ++i)
+	{
+		if(0 != action(root->keys[i], root->values[i], params))
+		{
+			return FAIL;
+		}
+	}
+
+	return InOrder(root->childrens[RIGHT], action, params);
+}
+
+status_ty AvlBlockForEach(avl_block_ty *tree, block_action_func action,
+															 void *params)
+{
+	assert(NULL != tree);
+	assert(NULL != action);
+
+	return InOrder(tree->root, action, params);
+}
+
+
+/*--------------- balance ------------*/
+
+/* plain avl rotations, like avl_paged. the rotations of avl.c also
+   copy shared nodes, count rotations, keep aggregates and weak ranks,
+   none of which a block tree has */
+static long GetHight(block_node_ty *node)
+{
+	return (NULL == node) ? -1 : node->hight;
+}
+
+static void UpdateHight(block_node_ty *node)
+{
+	long left_hight = GetHight(node->childrens[LEFT]);
+	long right_hight = GetHight(node->childrens[RIGHT]);
+
+	node->hight = 1 + ((left_hight >= right_hight) ? left_hight : right_hight);
+}
+
+/* rotate the child at side up over root, returns the new sub tree root */
+static block_node_ty *Rotate(block_node_ty *root, block_children_ty side)
+{
+	block_children_ty other = (LEFT == side) ? RIGHT : LEFT;
+	block_node_ty *child = root->childrens[side];
+
+	root->childrens[side] = child->childrens[other];
+	child->childrens[other] = root;
+	UpdateHight(root);
+	UpdateHight(child);
+
+	return child;
+}
+
+static block_node_ty *SubTreeBalance(block_node_ty *sub_tree)
+{
+	long diff = GetHight(sub_tree->childrens[LEFT]) -
+				GetHight(sub_tree->childrens[RIGHT]);
+	block_children_ty high = (0 < diff) ? LEFT : RIGHT;
+	block_children_ty low = (0 < diff) ? RIGHT : LEFT;
+	block_node_ty *child = NULL;
+
+	if(-1 <= diff && 1 >= diff)
+	{
+		UpdateHight(sub_tree);
+		return sub_tree;
+	}
+
+	child = sub_tree->childrens[high];
+	if(GetHight(child->childrens[low]) > GetHight(child->childrens[high]))
+	{
+		sub_tree->childrens[high] = Rotate(child, low);
+	}
+
+	return Rotate(sub_tree, high);
+}
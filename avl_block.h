@@ -0,0 +1,96 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : avl tree of sorted integer blocks   *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_BLOCK_H__
+#define __ILRD_OL127_128_AVL_BLOCK_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+
+/* keys per node, between 16 and 64 and a multiple of 4 */
+#ifndef AVL_BLOCK_SIZE
+#define AVL_BLOCK_SIZE 32
+#endif
+
+typedef struct avl_block avl_block_ty;
+
+typedef int(*block_action_func)(long key, void *value, void *params);
+
+/*
+DESCRIPTION : create a new avl of integer keys. each node keeps a
+sorted block of up to AVL_BLOCK_SIZE keys and their values, searched
+with SIMD when the target supports it.
+PARAMETERS : void
+RETURN : pointer to the new tree.
+COMPLEXITY : time - O(1), space - O(1)
+*/
+avl_block_ty *AvlBlockCreate(void);
+
+/*
+DESCRIPTION : destroy exist block tree
+PARAMETERS : pointer to tree
+RETURN : void
+COMPLEXITY : time - O(n), space - O(1)
+*/
+void AvlBlockDestroy(avl_block_ty *tree);
+
+/*
+DESCRIPTION : insert key with its value. if key exists its value
+is replaced. a full block is split in two.
+PARAMETERS : pointer to tree, key and value
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlBlockInsert(avl_block_ty *tree, long key, void *value);
+
+/*
+DESCRIPTION : remove key from the tree. a block that falls under a
+quarter full is merged with its neighbour when they fit in one block.
+PARAMETERS : pointer to tree, key
+RETURN : void
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+void AvlBlockRemove(avl_block_ty *tree, long key);
+
+/*
+DESCRIPTION : find key in the tree
+PARAMETERS : pointer to tree, key, pointer to the value
+found or NULL
+RETURN : SUCCESS if found, else FAIL.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlBlockFind(const avl_block_ty *tree, long key, void **value);
+
+/*
+DESCRIPTION : return the num of keys in the tree
+PARAMETERS : pointer to tree.
+RETURN : num of keys(size_t)
+COMPLEXITY : time - O(1), space - O(1)
+*/
+size_t AvlBlockSize(const avl_block_ty *tree);
+
+/*
+DESCRIPTION : return the hight of the tree of blocks
+PARAMETERS : pointer to tree.
+RETURN : the hight(long)
+COMPLEXITY : time - O(1), space - O(1)
+*/
+long AvlBlockHeight(const avl_block_ty *tree);
+
+/*
+DESCRIPTION : executes a function on each key and value
+in key order. stops when the function returns non zero.
+PARAMETERS : pointer to tree, pointer to action function,
+pointer to params of action function.
+RETURN : SUCCESS, or FAIL if stopped by the action function.
+COMPLEXITY : time - O(n), space - O(logn)
+*/
+status_ty AvlBlockForEach(avl_block_ty *tree, block_action_func action,
+                                                             void *params);
+
+#endif /* __ILRD_OL127_128_AVL_BLOCK_H__ */
@@ -0,0 +1,150 @@
+#include <assert.h> /* assert */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* rand */
+#include "avl_block.h"
+
+#define KEYS_RANGE 5000
+
+
+void AvlBlockCreateTest(void);
+void AvlBlockInsertFindTest(void);
+void AvlBlockRemoveTest(void);
+void AvlBlockRandomTest(void);
+
+int CheckOrder(long key, void *value, void *params);
+
+
+int main(void)
+{
+	AvlBlockCreateTest();
+	AvlBlockInsertFindTest();
+	AvlBlockRemoveTest();
+	AvlBlockRandomTest();
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlBlockCreateTest(void)
+{
+	avl_block_ty *tree = AvlBlockCreate();
+	assert(NULL != tree);
+	assert(0 == AvlBlockSize(tree));
+	assert(FAIL == AvlBlockFind(tree, 1, NULL));
+	AvlBlockRemove(tree, 1);
+	AvlBlockDestroy(tree);
+}
+
+void AvlBlockInsertFindTest(void)
+{
+	static long values[10000];
+	void *value = NULL;
+	long i = 0;
+	avl_block_ty *tree = AvlBlockCreate();
+
+	/* descending to split blocks from the left too */
+	for(i = 9999; i >= 0; --i)
+	{
+		values[i] = i;
+		assert(SUCCESS == AvlBlockInsert(tree, i * 2, values + i));
+	}
+
+	assert(10000 == AvlBlockSize(tree));
+	/* 10000 keys in blocks of at least half AVL_BLOCK_SIZE */
+	assert(12 > AvlBlockHeight(tree));
+
+	for(i = 0; i < 10000; ++i)
+	{
+		assert(SUCCESS == AvlBlockFind(tree, i * 2, &value));
+		assert(values + i == value);
+		assert(FAIL == AvlBlockFind(tree, i * 2 + 1, NULL));
+	}
+	assert(FAIL == AvlBlockFind(tree, -1, NULL));
+
+	/* insert existing key replaces its value */
+	assert(SUCCESS == AvlBlockInsert(tree, 20, values));
+	assert(SUCCESS == AvlBlockFind(tree, 20, &value));
+	assert(values == value);
+	assert(10000 == AvlBlockSize(tree));
+
+	AvlBlockDestroy(tree);
+}
+
+void AvlBlockRemoveTest(void)
+{
+	long i = 0;
+	avl_block_ty *tree = AvlBlockCreate();
+
+	for(i = 0; i < 1000; ++i)
+	{
+		assert(SUCCESS == AvlBlockInsert(tree, i, NULL));
+	}
+	for(i = 0; i < 1000; i += 2)
+	{
+		AvlBlockRemove(tree, i);
+	}
+	AvlBlockRemove(tree, 2000);
+
+	assert(500 == AvlBlockSize(tree));
+	for(i = 0; i < 1000; ++i)
+	{
+		assert((i % 2 ? SUCCESS : FAIL) == AvlBlockFind(tree, i, NULL));
+	}
+
+	for(i = 1; i < 1000; i += 2)
+	{
+		AvlBlockRemove(tree, i);
+	}
+	assert(0 == AvlBlockSize(tree));
+	assert(0 == AvlBlockHeight(tree));
+
+	AvlBlockDestroy(tree);
+}
+
+void AvlBlockRandomTest(void)
+{
+	static int in_tree[KEYS_RANGE];
+	size_t size = 0;
+	long last = -1;
+	long key = 0;
+	int i = 0;
+	avl_block_ty *tree = AvlBlockCreate();
+
+	for(i = 0; i < 100000; ++i)
+	{
+		key = rand() % KEYS_RANGE;
+		if(rand() % 2)
+		{
+			assert(SUCCESS == AvlBlockInsert(tree, key, NULL));
+			size += !in_tree[key];
+			in_tree[key] = 1;
+		}
+		else
+		{
+			AvlBlockRemove(tree, key);
+			size -= in_tree[key];
+			in_tree[key] = 0;
+		}
+
+		assert(size == AvlBlockSize(tree));
+		key = rand() % KEYS_RANGE;
+		assert((in_tree[key] ? SUCCESS : FAIL) == AvlBlockFind(tree, key, NULL));
+	}
+
+	assert(SUCCESS == AvlBlockForEach(tree, &CheckOrder, &last));
+
+	AvlBlockDestroy(tree);
+}
+
+
+int CheckOrder(long key, void *value, void *params)
+{
+	long *last = (long *)params;
+	(void)value;
+
+	assert(*last < key);
+	*last = key;
+	return 0;
+}
@@ -0,0 +1,273 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : flat combining avl for many threads *
+ *                                                   *
+ *****************************************************/
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_mutex_t */
+#include <sched.h> /* sched_yield */
+#include <stdlib.h> /* malloc, calloc, free */
+
+#include "avl_fc.h"
+
+#define SPINS_BEFORE_YIELD 64
+#define COMBINE_PASSES 3
+
+typedef enum
+{
+	OP_INSERT,
+	OP_REMOVE,
+	OP_FIND
+} op_ty;
+
+typedef enum
+{
+	SLOT_IDLE,
+	SLOT_POSTED,
+	SLOT_DONE
+} slot_state_ty;
+
+/* a slot is written by its thread while idle, and by the combiner
+   while posted. state moves between them behind a full barrier */
+struct avl_fc_slot
+{
+	volatile int state;
+	op_ty op;
+	void *data;
+	status_ty status;
+	avl_fc_ty *fc;
+	char pad[64]; /* threads spinning on neighbour slots share no line */
+};
+
+struct avl_fc
+{
+	avl_ty *avl;
+	cmp_func cmp;
+	void *params;
+	pthread_mutex_t lock;
+	avl_fc_slot_ty *slots;
+	avl_fc_slot_ty **batch;
+	size_t slots_num;
+	size_t joined;
+};
+
+
+avl_fc_ty *AvlFcCreate(cmp_func cmp, void *params, size_t slots_num)
+{
+	avl_fc_ty *fc = NULL;
+	size_t i = 0;
+
+	assert(NULL != cmp);
+	assert(0 < slots_num);
+
+	fc = (avl_fc_ty *)malloc(sizeof(avl_fc_ty));
+	if(NULL == fc)
+	{
+		return NULL;
+	}
+
+	fc->avl = AvlCreate(cmp, params);
+	fc->slots = (avl_fc_slot_ty *)calloc(slots_num, sizeof(avl_fc_slot_ty));
+	fc->batch = (avl_fc_slot_ty **)malloc(slots_num *
+										  sizeof(avl_fc_slot_ty *));
+	if(NULL == fc->avl || NULL == fc->slots || NULL == fc->batch)
+	{
+		if(NULL != fc->avl)
+		{
+			AvlDestroy(fc->avl);
+		}
+		free(fc->slots);
+		free(fc->batch);
+		free(fc);
+		return NULL;
+	}
+
+	for(i = 0; i < slots_num; ++i)
+	{
+		fc->slots[i].state = SLOT_IDLE;
+		fc->slots[i].fc = fc;
+	}
+	fc->cmp = cmp;
+	fc->params = params;
+	fc->slots_num = slots_num;
+	fc->joined = 0;
+	pthread_mutex_init(&fc->lock, NULL);
+
+	return fc;
+}
+
+
+void AvlFcDestroy(avl_fc_ty *fc)
+{
+	assert(NULL != fc);
+
+	pthread_mutex_destroy(&fc->lock);
+	AvlDestroy(fc->avl);
+	free(fc->slots);
+	free(fc->batch);
+	free(fc);
+}
+
+
+avl_fc_slot_ty *AvlFcJoin(avl_fc_ty *fc)
+{
+	size_t index = 0;
+
+	assert(NULL != fc);
+
+	index = __sync_fetch_and_add(&fc->joined, 1);
+	if(index >= fc->slots_num)
+	{
+		return NULL;
+	}
+
+	return fc->slots + index;
+}
+
+
+avl_ty *AvlFcAvl(avl_fc_ty *fc)
+{
+	assert(NULL != fc);
+
+	return fc->avl;
+}
+
+
+/*--------------- combining ------------*/
+
+/* insertion sort by data, stable so the operations of one key keep
+   the slot order. the batch is at most slots_num long */
+static void SortBatch(const avl_fc_ty *fc, size_t batch_size)
+{
+	avl_fc_slot_ty **batch = fc->batch;
+	avl_fc_slot_ty *slot = NULL;
+	size_t i = 0;
+	size_t j = 0;
+
+	for(i = 1; i < batch_size; ++i)
+	{
+		slot = batch[i];
+		for(j = i; 0 < j &&
+			 0 < fc->cmp(batch[j - 1]->data, slot->data, fc->params); --j)
+		{
+			batch[j] = batch[j - 1];
+		}
+		batch[j] = slot;
+	}
+}
+
+static void Apply(avl_ty *avl, avl_fc_slot_ty *slot)
+{
+	switch(slot->op)
+	{
+		case OP_INSERT:
+			slot->status = AvlInsert(avl, slot->data);
+			break;
+		case OP_REMOVE:
+			slot->status = AvlRemove(avl, slot->data);
+			break;
+		case OP_FIND:
+			slot->status = AvlFind(avl, slot->data);
+			break;
+	}
+}
+
+/* apply the posted operations, the lock must be held */
+static void Combine(avl_fc_ty *fc)
+{
+	size_t batch_size = 0;
+	size_t pass = 0;
+	size_t i = 0;
+
+	for(pass = 0; pass < COMBINE_PASSES; ++pass)
+	{
+		batch_size = 0;
+		for(i = 0; i < fc->slots_num; ++i)
+		{
+			if(SLOT_POSTED == fc->slots[i].state)
+			{
+				fc->batch[batch_size] = fc->slots + i;
+				++batch_size;
+			}
+		}
+		if(0 == batch_size)
+		{
+			return;
+		}
+		__sync_synchronize();
+
+		/* neighbouring keys walk the same nodes while they are cached */
+		SortBatch(fc, batch_size);
+		for(i = 0; i < batch_size; ++i)
+		{
+			Apply(fc->avl, fc->batch[i]);
+		}
+
+		__sync_synchronize();
+		for(i = 0; i < batch_size; ++i)
+		{
+			fc->batch[i]->state = SLOT_DONE;
+		}
+	}
+}
+
+static status_ty Post(avl_fc_slot_ty *slot, op_ty op, void *data)
+{
+	avl_fc_ty *fc = slot->fc;
+	size_t spins = 0;
+
+	assert(SLOT_IDLE == slot->state);
+
+	slot->op = op;
+	slot->data = data;
+	__sync_synchronize();
+	slot->state = SLOT_POSTED;
+
+	while(SLOT_DONE != slot->state)
+	{
+		if(0 == pthread_mutex_trylock(&fc->lock))
+		{
+			Combine(fc);
+			pthread_mutex_unlock(&fc->lock);
+			continue;
+		}
+
+		++spins;
+		if(0 == spins % SPINS_BEFORE_YIELD)
+		{
+			sched_yield();
+		}
+	}
+	__sync_synchronize();
+	slot->state = SLOT_IDLE;
+
+	return slot->status;
+}
+
+
+status_ty AvlFcInsert(avl_fc_slot_ty *slot, void *data)
+{
+	assert(NULL != slot);
+
+	return Post(slot, OP_INSERT, data);
+}
+
+
+status_ty AvlFcRemove(avl_fc_slot_ty *slot, void *data)
+{
+	assert(NULL != slot);
+
+	return Post(slot, OP_REMOVE, data);
+}
+
+
+status_ty AvlFcFind(avl_fc_slot_ty *slot, void *data)
+{
+	assert(NULL != slot);
+
+	return Post(slot, OP_FIND, data);
+}
@@ -0,0 +1,79 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : flat combining avl for many threads *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_FC_H__
+#define __ILRD_OL127_128_AVL_FC_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+
+typedef struct avl_fc avl_fc_ty;
+typedef struct avl_fc_slot avl_fc_slot_ty;
+
+/*
+DESCRIPTION : create a new avl shared by up to slots_num threads.
+each thread posts its operations to its own slot, and the thread
+that gets the lock applies all posted operations in key order.
+PARAMETERS : pointer compare function, params to compare function,
+max num of threads.
+RETURN : pointer to the new tree.
+COMPLEXITY : time - O(slots_num), space - O(slots_num)
+*/
+avl_fc_ty *AvlFcCreate(cmp_func cmp, void *params, size_t slots_num);
+
+/*
+DESCRIPTION : destroy exist tree, no thread may use it
+PARAMETERS : pointer to tree
+RETURN : void
+COMPLEXITY : time - O(n), space - O(1)
+*/
+void AvlFcDestroy(avl_fc_ty *fc);
+
+/*
+DESCRIPTION : take a slot for the calling thread. thread safe.
+PARAMETERS : pointer to tree
+RETURN : pointer to the slot, or NULL if all are taken.
+COMPLEXITY : time - O(1), space - O(1)
+*/
+avl_fc_slot_ty *AvlFcJoin(avl_fc_ty *fc);
+
+/*
+DESCRIPTION : insert new element through the slot of the thread
+PARAMETERS : pointer to slot, pointer to data
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(logn) amortized, space - O(1)
+*/
+status_ty AvlFcInsert(avl_fc_slot_ty *slot, void *data);
+
+/*
+DESCRIPTION : remove element through the slot of the thread
+PARAMETERS : pointer to slot, pointer to data
+RETURN : SUCCESS, or FAIL if memory ran out copying nodes
+shared with a clone. the element is not removed then.
+COMPLEXITY : time - O(logn) amortized, space - O(1)
+*/
+status_ty AvlFcRemove(avl_fc_slot_ty *slot, void *data);
+
+/*
+DESCRIPTION : check if data exist through the slot of the thread
+PARAMETERS : pointer to slot, pointer to data
+RETURN : SUCCESS if found, else FAIL.
+COMPLEXITY : time - O(logn) amortized, space - O(1)
+*/
+status_ty AvlFcFind(avl_fc_slot_ty *slot, void *data);
+
+/*
+DESCRIPTION : return the avl of the tree, for use when no
+thread changes it
+PARAMETERS : pointer to tree
+RETURN : pointer to avl
+COMPLEXITY : time - O(1), space - O(1)
+*/
+avl_ty *AvlFcAvl(avl_fc_ty *fc);
+
+#endif /* __ILRD_OL127_128_AVL_FC_H__ */
@@ -0,0 +1,169 @@
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_create, pthread_join */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include "avl_fc.h"
+
+#define THREADS_NUM 8
+#define PER_THREAD 2000
+
+
+void AvlFcBasicTest(void);
+void AvlFcThreadsTest(void);
+
+int CompareInts(const void *avl_data, const void *user_data, void *params);
+int CheckOrder(void *avl_data, void *params);
+void *Worker(void *arg);
+
+
+int main(void)
+{
+	AvlFcBasicTest();
+	AvlFcThreadsTest();
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlFcBasicTest(void)
+{
+	int arr[100] = {0};
+	avl_fc_slot_ty *slot = NULL;
+	avl_ty *clone = NULL;
+	int last = -1;
+	int i = 0;
+	avl_fc_ty *fc = AvlFcCreate(&CompareInts, NULL, 2);
+	assert(NULL != fc);
+
+	slot = AvlFcJoin(fc);
+	assert(NULL != slot);
+	assert(NULL != AvlFcJoin(fc));
+	assert(NULL == AvlFcJoin(fc));
+
+	for(i = 0; i < 100; ++i)
+	{
+		arr[i] = (i * 37) % 100;
+		assert(SUCCESS == AvlFcInsert(slot, arr + i));
+	}
+	for(i = 0; i < 100; ++i)
+	{
+		assert(SUCCESS == AvlFcFind(slot, arr + i));
+	}
+	for(i = 0; i < 100; ++i)
+	{
+		if(0 == arr[i] % 2)
+		{
+			assert(SUCCESS == AvlFcRemove(slot, arr + i));
+		}
+	}
+	for(i = 0; i < 100; ++i)
+	{
+		assert((arr[i] % 2 ? SUCCESS : FAIL) == AvlFcFind(slot, arr + i));
+	}
+
+	assert(50 == AvlSize(AvlFcAvl(fc)));
+	assert(SUCCESS == AvlForEach(AvlFcAvl(fc), &CheckOrder, &last, INORDER));
+	assert(99 == last);
+
+	/* a remove copies the nodes shared with a clone of the tree */
+	clone = AvlClone(AvlFcAvl(fc));
+	assert(NULL != clone);
+	assert(SUCCESS == AvlFcRemove(slot, arr + 1));
+	assert(FAIL == AvlFcFind(slot, arr + 1));
+	assert(SUCCESS == AvlFind(clone, arr + 1));
+	AvlDestroy(clone);
+
+	AvlFcDestroy(fc);
+}
+
+typedef struct
+{
+	avl_fc_ty *fc;
+	int *arr;
+} thread_args_ty;
+
+void AvlFcThreadsTest(void)
+{
+	static int arr[THREADS_NUM * PER_THREAD];
+	pthread_t threads[THREADS_NUM];
+	thread_args_ty args[THREADS_NUM];
+	int last = -1;
+	int i = 0;
+	avl_fc_ty *fc = AvlFcCreate(&CompareInts, NULL, THREADS_NUM);
+	assert(NULL != fc);
+
+	/* interleaved keys so the batches of the threads mix */
+	for(i = 0; i < THREADS_NUM * PER_THREAD; ++i)
+	{
+		arr[i] = (i % PER_THREAD) * THREADS_NUM + i / PER_THREAD;
+	}
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		args[i].fc = fc;
+		args[i].arr = arr + i * PER_THREAD;
+		assert(0 == pthread_create(threads + i, NULL, &Worker, args + i));
+	}
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	/* each thread removed the elements at its even indexes */
+	assert(THREADS_NUM * PER_THREAD / 2 == AvlSize(AvlFcAvl(fc)));
+	for(i = 0; i < THREADS_NUM * PER_THREAD; ++i)
+	{
+		assert(((i % PER_THREAD) % 2 ? SUCCESS : FAIL) ==
+									AvlFind(AvlFcAvl(fc), arr + i));
+	}
+	assert(SUCCESS == AvlForEach(AvlFcAvl(fc), &CheckOrder, &last, INORDER));
+
+	AvlFcDestroy(fc);
+}
+
+
+int CompareInts(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+	return *(const int *)avl_data - *(const int *)user_data;
+}
+
+int CheckOrder(void *avl_data, void *params)
+{
+	int *last = (int *)params;
+
+	assert(*last < *(int *)avl_data);
+	*last = *(int *)avl_data;
+	return 0;
+}
+
+void *Worker(void *arg)
+{
+	thread_args_ty *args = (thread_args_ty *)arg;
+	avl_fc_slot_ty *slot = AvlFcJoin(args->fc);
+	int i = 0;
+
+	if(NULL == slot)
+	{
+		abort();
+	}
+	for(i = 0; i < PER_THREAD; ++i)
+	{
+		if(SUCCESS != AvlFcInsert(slot, args->arr + i))
+		{
+			abort();
+		}
+	}
+	for(i = 0; i < PER_THREAD; i += 2)
+	{
+		AvlFcRemove(slot, args->arr + i);
+		if(FAIL != AvlFcFind(slot, args->arr + i) ||
+		   SUCCESS != AvlFcFind(slot, args->arr + i + 1))
+		{
+			abort();
+		}
+	}
+
+	return NULL;
+}
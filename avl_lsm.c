@@ -0,0 +1,581 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : avl with a buffer of writes         *
+ *                                                   *
+ *****************************************************/
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_mutex_t, pthread_rwlock_t */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
+
+#include "avl_lsm.h"
+
+typedef struct
+{
+	void *data;
+	bool_ty is_remove;
+} lsm_op_ty;
+
+typedef struct
+{
+	void **elements;
+	size_t num;
+} collect_ty;
+
+/* writes go to active. a full active becomes frozen, sorted, and
+   the merging thread is the only one that changes the tree. the
+   buffers are guarded by lock, the tree by tree_lock, and no
+   thread holds both. the sorted prefix of active is kept for finds.
+   a cursor holds tree_lock for reading until it is destroyed */
+struct avl_lsm
+{
+	avl_ty *avl;
+	cmp_func cmp;
+	void *params;
+	size_t threshold;
+	lsm_op_ty *active;
+	size_t active_num;
+	size_t active_sorted;
+	lsm_op_ty *frozen;
+	size_t frozen_num;
+	lsm_op_ty *scratch;
+	lsm_op_ty *batch;
+	size_t freezes;
+	size_t merges;
+	status_ty merge_status;
+	bool_ty is_stopping;
+	pthread_mutex_t lock;
+	pthread_cond_t has_frozen;
+	pthread_cond_t merged;
+	pthread_rwlock_t tree_lock;
+	pthread_t merger;
+};
+
+static void *MergeLoop(void *arg);
+
+
+/*--------------- buffers ------------*/
+
+static void MergeOps(const avl_lsm_ty *lsm, lsm_op_ty *ops, size_t mid,
+												  size_t n, lsm_op_ty *scratch)
+{
+	size_t i = 0;
+	size_t j = mid;
+	size_t k = 0;
+
+	while(i < mid && j < n)
+	{
+		if(0 < lsm->cmp(ops[i].data, ops[j].data, lsm->params))
+		{
+			scratch[k++] = ops[j++];
+		}
+		else
+		{
+			scratch[k++] = ops[i++];
+		}
+	}
+	memcpy(scratch + k, ops + i, (mid - i) * sizeof(lsm_op_ty));
+	k += mid - i;
+	memcpy(scratch + k, ops + j, (n - j) * sizeof(lsm_op_ty));
+	memcpy(ops, scratch, n * sizeof(lsm_op_ty));
+}
+
+/* stable, so the operations on one element keep their order */
+static void SortOps(const avl_lsm_ty *lsm, lsm_op_ty *ops, size_t n,
+												lsm_op_ty *scratch)
+{
+	if(2 > n)
+	{
+		return;
+	}
+	SortOps(lsm, ops, n / 2, scratch);
+	SortOps(lsm, ops + n / 2, n - n / 2, scratch);
+	MergeOps(lsm, ops, n / 2, n, scratch);
+}
+
+static void SortActive(avl_lsm_ty *lsm)
+{
+	if(lsm->active_sorted == lsm->active_num)
+	{
+		return;
+	}
+	SortOps(lsm, lsm->active + lsm->active_sorted,
+			lsm->active_num - lsm->active_sorted, lsm->scratch);
+	MergeOps(lsm, lsm->active, lsm->active_sorted, lsm->active_num,
+													  lsm->scratch);
+	lsm->active_sorted = lsm->active_num;
+}
+
+/* the last operation on data in sorted ops, or NULL */
+static const lsm_op_ty *FindOp(const avl_lsm_ty *lsm, const lsm_op_ty *ops,
+											   size_t n, const void *data)
+{
+	size_t lo = 0;
+	size_t hi = n;
+	size_t mid = 0;
+
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if(0 < lsm->cmp(ops[mid].data, data, lsm->params))
+		{
+			hi = mid;
+		}
+		else
+		{
+			lo = mid + 1;
+		}
+	}
+
+	if(0 < lo && 0 == lsm->cmp(ops[lo - 1].data, data, lsm->params))
+	{
+		return ops + lo - 1;
+	}
+	return NULL;
+}
+
+/* the lock must be held and frozen empty */
+static void Freeze(avl_lsm_ty *lsm)
+{
+	lsm_op_ty *empty = lsm->frozen;
+
+	assert(0 == lsm->frozen_num);
+
+	SortActive(lsm);
+	lsm->frozen = lsm->active;
+	lsm->frozen_num = lsm->active_num;
+	lsm->active = empty;
+	lsm->active_num = 0;
+	lsm->active_sorted = 0;
+	++lsm->freezes;
+	pthread_cond_signal(&lsm->has_frozen);
+}
+
+static void Append(avl_lsm_ty *lsm, void *data, bool_ty is_remove)
+{
+	pthread_mutex_lock(&lsm->lock);
+	while(lsm->active_num == lsm->threshold)
+	{
+		if(0 == lsm->frozen_num)
+		{
+			Freeze(lsm);
+		}
+		else
+		{
+			pthread_cond_wait(&lsm->merged, &lsm->lock);
+		}
+	}
+
+	lsm->active[lsm->active_num].data = data;
+	lsm->active[lsm->active_num].is_remove = is_remove;
+	++lsm->active_num;
+	if(lsm->active_num == lsm->threshold && 0 == lsm->frozen_num)
+	{
+		Freeze(lsm);
+	}
+	pthread_mutex_unlock(&lsm->lock);
+}
+
+
+/*--------------- merging ------------*/
+
+static size_t Log2(size_t n)
+{
+	size_t log = 0;
+
+	while(1 < n)
+	{
+		n >>= 1;
+		++log;
+	}
+
+	return log;
+}
+
+static int CollectElement(void *data, void *params)
+{
+	collect_ty *collect = (collect_ty *)params;
+
+	collect->elements[collect->num] = data;
+	++collect->num;
+
+	return 0;
+}
+
+static status_ty ApplyBatch(avl_lsm_ty *lsm, size_t n)
+{
+	status_ty status = SUCCESS;
+	size_t i = 0;
+
+	pthread_rwlock_wrlock(&lsm->tree_lock);
+	for(i = 0; i < n; ++i)
+	{
+		/* lsm->avl is never cloned, so the remove cannot fail */
+		(void)AvlRemove(lsm->avl, lsm->batch[i].data);
+		if(!lsm->batch[i].is_remove &&
+		   SUCCESS != AvlInsert(lsm->avl, lsm->batch[i].data))
+		{
+			status = FAIL;
+		}
+	}
+	pthread_rwlock_unlock(&lsm->tree_lock);
+
+	return status;
+}
+
+/* join the tree with the batch into a new tree. only the merging
+   thread changes the tree, so it is read without the lock */
+static status_ty RebuildTree(avl_lsm_ty *lsm, size_t n)
+{
+	size_t size = AvlSize(lsm->avl);
+	void **merged = (void **)malloc((size + n) * sizeof(void *) + 1);
+	avl_ty *new_avl = AvlCreate(lsm->cmp, lsm->params);
+	avl_ty *old_avl = NULL;
+	collect_ty tree;
+	size_t merged_num = 0;
+	size_t i = 0;
+	size_t j = 0;
+	int cmp_res = 0;
+
+	if(NULL == merged || NULL == new_avl)
+	{
+		free(merged);
+		if(NULL != new_avl)
+		{
+			AvlDestroy(new_avl);
+		}
+		return ApplyBatch(lsm, n);
+	}
+
+	/* the tree goes to the tail, the front is filled as it is read */
+	tree.elements = merged + n;
+	tree.num = 0;
+	AvlForEach(lsm->avl, &CollectElement, &tree, INORDER);
+	while(i < size || j < n)
+	{
+		cmp_res = (i == size) ? 1 : (j == n) ? -1 :
+				  lsm->cmp(tree.elements[i], lsm->batch[j].data, lsm->params);
+		if(0 > cmp_res)
+		{
+			merged[merged_num++] = tree.elements[i++];
+			continue;
+		}
+		if(!lsm->batch[j].is_remove)
+		{
+			merged[merged_num++] = lsm->batch[j].data;
+		}
+		i += (0 == cmp_res);
+		++j;
+	}
+
+	if(SUCCESS != AvlBulkLoad(new_avl, merged, merged_num))
+	{
+		free(merged);
+		AvlDestroy(new_avl);
+		return ApplyBatch(lsm, n);
+	}
+	free(merged);
+
+	pthread_rwlock_wrlock(&lsm->tree_lock);
+	old_avl = lsm->avl;
+	lsm->avl = new_avl;
+	pthread_rwlock_unlock(&lsm->tree_lock);
+	AvlDestroy(old_avl);
+
+	return SUCCESS;
+}
+
+/* keep the last operation on each element of the sorted frozen,
+   then insert them one by one, or rebuild the tree when that is
+   cheaper than n searches */
+static status_ty MergeFrozen(avl_lsm_ty *lsm, size_t frozen_num)
+{
+	size_t size = AvlSize(lsm->avl);
+	size_t n = 0;
+	size_t i = 0;
+
+	for(i = 0; i < frozen_num; ++i)
+	{
+		if(i + 1 == frozen_num || 0 != lsm->cmp(lsm->frozen[i].data,
+										lsm->frozen[i + 1].data, lsm->params))
+		{
+			lsm->batch[n] = lsm->frozen[i];
+			++n;
+		}
+	}
+
+	if(n * Log2(size + 1) >= size)
+	{
+		return RebuildTree(lsm, n);
+	}
+	return ApplyBatch(lsm, n);
+}
+
+/* frozen is not changed while it is not empty, so it is merged
+   without the lock */
+static void *MergeLoop(void *arg)
+{
+	avl_lsm_ty *lsm = (avl_lsm_ty *)arg;
+	status_ty status = SUCCESS;
+	size_t frozen_num = 0;
+
+	pthread_mutex_lock(&lsm->lock);
+	for(;;)
+	{
+		while(0 == lsm->frozen_num && !lsm->is_stopping)
+		{
+			pthread_cond_wait(&lsm->has_frozen, &lsm->lock);
+		}
+		if(0 == lsm->frozen_num)
+		{
+			break;
+		}
+		frozen_num = lsm->frozen_num;
+		pthread_mutex_unlock(&lsm->lock);
+
+		status = MergeFrozen(lsm, frozen_num);
+
+		pthread_mutex_lock(&lsm->lock);
+		if(SUCCESS != status)
+		{
+			lsm->merge_status = FAIL;
+		}
+		lsm->frozen_num = 0;
+		++lsm->merges;
+		pthread_cond_broadcast(&lsm->merged);
+	}
+	pthread_mutex_unlock(&lsm->lock);
+
+	return NULL;
+}
+
+
+/*--------------- public ------------*/
+
+static void FreeLsm(avl_lsm_ty *lsm)
+{
+	if(NULL != lsm->avl)
+	{
+		AvlDestroy(lsm->avl);
+	}
+	free(lsm->active);
+	free(lsm->frozen);
+	free(lsm->scratch);
+	free(lsm->batch);
+	free(lsm);
+}
+
+avl_lsm_ty *AvlLsmCreate(cmp_func cmp, void *params, size_t threshold)
+{
+	avl_lsm_ty *lsm = NULL;
+	size_t buffer_size = threshold * sizeof(lsm_op_ty);
+
+	assert(NULL != cmp);
+	assert(0 < threshold);
+
+	lsm = (avl_lsm_ty *)malloc(sizeof(avl_lsm_ty));
+	if(NULL == lsm)
+	{
+		return NULL;
+	}
+
+	lsm->avl = AvlCreate(cmp, params);
+	lsm->active = (lsm_op_ty *)malloc(buffer_size);
+	lsm->frozen = (lsm_op_ty *)malloc(buffer_size);
+	lsm->scratch = (lsm_op_ty *)malloc(buffer_size);
+	lsm->batch = (lsm_op_ty *)malloc(buffer_size);
+	if(NULL == lsm->avl || NULL == lsm->active || NULL == lsm->frozen ||
+	   NULL == lsm->scratch || NULL == lsm->batch)
+	{
+		FreeLsm(lsm);
+		return NULL;
+	}
+
+	lsm->cmp = cmp;
+	lsm->params = params;
+	lsm->threshold = threshold;
+	lsm->active_num = 0;
+	lsm->active_sorted = 0;
+	lsm->frozen_num = 0;
+	lsm->freezes = 0;
+	lsm->merges = 0;
+	lsm->merge_status = SUCCESS;
+	lsm->is_stopping = FALSE;
+	pthread_mutex_init(&lsm->lock, NULL);
+	pthread_cond_init(&lsm->has_frozen, NULL);
+	pthread_cond_init(&lsm->merged, NULL);
+	pthread_rwlock_init(&lsm->tree_lock, NULL);
+
+	if(0 != pthread_create(&lsm->merger, NULL, &MergeLoop, lsm))
+	{
+		pthread_mutex_destroy(&lsm->lock);
+		pthread_cond_destroy(&lsm->has_frozen);
+		pthread_cond_destroy(&lsm->merged);
+		pthread_rwlock_destroy(&lsm->tree_lock);
+		FreeLsm(lsm);
+		return NULL;
+	}
+
+	return lsm;
+}
+
+
+void AvlLsmDestroy(avl_lsm_ty *lsm)
+{
+	assert(NULL != lsm);
+
+	pthread_mutex_lock(&lsm->lock);
+	lsm->is_stopping = TRUE;
+	pthread_cond_signal(&lsm->has_frozen);
+	pthread_mutex_unlock(&lsm->lock);
+	pthread_join(lsm->merger, NULL);
+
+	pthread_mutex_destroy(&lsm->lock);
+	pthread_cond_destroy(&lsm->has_frozen);
+	pthread_cond_destroy(&lsm->merged);
+	pthread_rwlock_destroy(&lsm->tree_lock);
+	FreeLsm(lsm);
+}
+
+
+void AvlLsmInsert(avl_lsm_ty *lsm, void *data)
+{
+	assert(NULL != lsm);
+
+	Append(lsm, data, FALSE);
+}
+
+
+void AvlLsmRemove(avl_lsm_ty *lsm, void *data)
+{
+	assert(NULL != lsm);
+
+	Append(lsm, data, TRUE);
+}
+
+
+/* the last operation on data decides, the newest buffer first */
+status_ty AvlLsmFind(avl_lsm_ty *lsm, void *data)
+{
+	const lsm_op_ty *op = NULL;
+	status_ty status = SUCCESS;
+	bool_ty is_buffered = FALSE;
+
+	assert(NULL != lsm);
+
+	/* the buffers may be reused as soon as the lock is released */
+	pthread_mutex_lock(&lsm->lock);
+	SortActive(lsm);
+	op = FindOp(lsm, lsm->active, lsm->active_num, data);
+	if(NULL == op)
+	{
+		op = FindOp(lsm, lsm->frozen, lsm->frozen_num, data);
+	}
+	if(NULL != op)
+	{
+		is_buffered = TRUE;
+		status = op->is_remove ? FAIL : SUCCESS;
+	}
+	pthread_mutex_unlock(&lsm->lock);
+	if(is_buffered)
+	{
+		return status;
+	}
+
+	pthread_rwlock_rdlock(&lsm->tree_lock);
+	status = AvlFind(lsm->avl, data);
+	pthread_rwlock_unlock(&lsm->tree_lock);
+
+	return status;
+}
+
+
+status_ty AvlLsmMerge(avl_lsm_ty *lsm)
+{
+	status_ty status = SUCCESS;
+	size_t target = 0;
+
+	assert(NULL != lsm);
+
+	pthread_mutex_lock(&lsm->lock);
+	while(0 != lsm->active_num && 0 != lsm->frozen_num)
+	{
+		pthread_cond_wait(&lsm->merged, &lsm->lock);
+	}
+	if(0 != lsm->active_num)
+	{
+		Freeze(lsm);
+	}
+	target = lsm->freezes;
+	while(lsm->merges < target)
+	{
+		pthread_cond_wait(&lsm->merged, &lsm->lock);
+	}
+	status = lsm->merge_status;
+	pthread_mutex_unlock(&lsm->lock);
+
+	return status;
+}
+
+
+size_t AvlLsmSize(avl_lsm_ty *lsm)
+{
+	size_t size = 0;
+
+	assert(NULL != lsm);
+
+	AvlLsmMerge(lsm);
+	pthread_rwlock_rdlock(&lsm->tree_lock);
+	size = AvlSize(lsm->avl);
+	pthread_rwlock_unlock(&lsm->tree_lock);
+
+	return size;
+}
+
+
+status_ty AvlLsmForEach(avl_lsm_ty *lsm, action_func action, void *params)
+{
+	status_ty status = SUCCESS;
+
+	assert(NULL != lsm);
+	assert(NULL != action);
+
+	AvlLsmMerge(lsm);
+	pthread_rwlock_rdlock(&lsm->tree_lock);
+	status = AvlForEach(lsm->avl, action, params, INORDER);
+	pthread_rwlock_unlock(&lsm->tree_lock);
+
+	return status;
+}
+
+
+avl_cursor_ty *AvlLsmCursorCreate(avl_lsm_ty *lsm)
+{
+	avl_cursor_ty *cursor = NULL;
+
+	assert(NULL != lsm);
+
+	AvlLsmMerge(lsm);
+	pthread_rwlock_rdlock(&lsm->tree_lock);
+	cursor = AvlCursorCreate(lsm->avl);
+	if(NULL == cursor)
+	{
+		pthread_rwlock_unlock(&lsm->tree_lock);
+	}
+
+	return cursor;
+}
+
+
+void AvlLsmCursorDestroy(avl_lsm_ty *lsm, avl_cursor_ty *cursor)
+{
+	assert(NULL != lsm);
+	assert(NULL != cursor);
+
+	AvlCursorDestroy(cursor);
+	pthread_rwlock_unlock(&lsm->tree_lock);
+}
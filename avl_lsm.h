@@ -0,0 +1,118 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : avl with a buffer of writes         *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_LSM_H__
+#define __ILRD_OL127_128_AVL_LSM_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+
+typedef struct avl_lsm avl_lsm_ty;
+
+/*
+DESCRIPTION : create a new avl whose inserts and removes are
+appended to a buffer. when threshold operations are buffered,
+the buffer is sorted and merged into the tree by a background
+thread while a new buffer takes the writes. finds look at the
+buffers before the tree, so they see every write that returned.
+the elements are unique by cmp.
+PARAMETERS : pointer compare function, params to compare function,
+num of operations in a buffer.
+RETURN : pointer to the new tree, or NULL on failure.
+COMPLEXITY : time - O(1), space - O(threshold)
+*/
+avl_lsm_ty *AvlLsmCreate(cmp_func cmp, void *params, size_t threshold);
+
+/*
+DESCRIPTION : stop the merging thread and destroy the tree.
+no thread may use it.
+PARAMETERS : pointer to tree
+RETURN : void
+COMPLEXITY : time - O(n), space - O(1)
+*/
+void AvlLsmDestroy(avl_lsm_ty *lsm);
+
+/*
+DESCRIPTION : insert data, replacing an equal element. waits only
+when both buffers are full. thread safe.
+PARAMETERS : pointer to tree, pointer to data
+RETURN : void
+COMPLEXITY : time - O(1) amortized, space - O(1)
+*/
+void AvlLsmInsert(avl_lsm_ty *lsm, void *data);
+
+/*
+DESCRIPTION : remove the element equal to data, by buffering a
+tombstone for it. thread safe.
+PARAMETERS : pointer to tree, pointer to data
+RETURN : void
+COMPLEXITY : time - O(1) amortized, space - O(1)
+*/
+void AvlLsmRemove(avl_lsm_ty *lsm, void *data);
+
+/*
+DESCRIPTION : check if data exist in the tree. thread safe.
+PARAMETERS : pointer to tree, pointer to data
+RETURN : SUCCESS if found, else FAIL.
+COMPLEXITY : time - O(logn + threshold*log(threshold)) when writes
+came since the last find, else O(logn), space - O(1)
+*/
+status_ty AvlLsmFind(avl_lsm_ty *lsm, void *data);
+
+/*
+DESCRIPTION : merge every operation that returned before the call
+into the tree, and wait for it. thread safe.
+PARAMETERS : pointer to tree
+RETURN : SUCCESS, or FAIL if memory ran out in any merge since
+the tree was created.
+COMPLEXITY : time - O(threshold*logn), space - O(n)
+*/
+status_ty AvlLsmMerge(avl_lsm_ty *lsm);
+
+/*
+DESCRIPTION : merge the buffers and return the num of elements.
+thread safe.
+PARAMETERS : pointer to tree
+RETURN : num of elements(size_t)
+COMPLEXITY : time - O(threshold*logn), space - O(n)
+*/
+size_t AvlLsmSize(avl_lsm_ty *lsm);
+
+/*
+DESCRIPTION : merge the buffers and executes a function on each
+element in order. stops when the function returns non zero.
+writes go on while it runs, and are merged after it.
+PARAMETERS : pointer to tree, pointer to action function,
+pointer to params of action function.
+RETURN : SUCCESS, or FAIL if stopped by the action function.
+COMPLEXITY : time - O(n), space - O(logn)
+*/
+status_ty AvlLsmForEach(avl_lsm_ty *lsm, action_func action, void *params);
+
+/*
+DESCRIPTION : merge the buffers and create a cursor on the tree.
+merges wait until the cursor is destroyed by AvlLsmCursorDestroy,
+so writes made meanwhile are not seen by it. the thread that holds
+the cursor must not call AvlLsmMerge, AvlLsmSize, AvlLsmForEach or
+AvlLsmCursorCreate, or write more than threshold operations, since
+these wait for a merge that waits for the cursor.
+PARAMETERS : pointer to tree
+RETURN : pointer to the cursor, or NULL on failure.
+COMPLEXITY : time - O(threshold*logn), space - O(1)
+*/
+avl_cursor_ty *AvlLsmCursorCreate(avl_lsm_ty *lsm);
+
+/*
+DESCRIPTION : destroy a cursor of AvlLsmCursorCreate
+PARAMETERS : pointer to tree, pointer to cursor
+RETURN : void
+COMPLEXITY : time - O(1), space - O(1)
+*/
+void AvlLsmCursorDestroy(avl_lsm_ty *lsm, avl_cursor_ty *cursor);
+
+#endif /* __ILRD_OL127_128_AVL_LSM_H__ */
@@ -0,0 +1,236 @@
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_create, pthread_join */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* rand */
+#include "avl_lsm.h"
+
+#define KEYS_RANGE 500
+#define OPS_NUM 20000
+#define THREADS_NUM 4
+#define PER_THREAD 5000
+
+typedef struct
+{
+	avl_lsm_ty *lsm;
+	int *keys;
+} worker_ty;
+
+
+void AvlLsmBasicTest(void);
+void AvlLsmModelTest(void);
+void AvlLsmCursorTest(void);
+void AvlLsmThreadsTest(void);
+
+int CompareInts(const void *avl_data, const void *user_data, void *params);
+int CheckOrder(void *avl_data, void *params);
+void *InsertKeys(void *arg);
+
+
+int main(void)
+{
+	AvlLsmBasicTest();
+	AvlLsmModelTest();
+	AvlLsmCursorTest();
+	AvlLsmThreadsTest();
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlLsmBasicTest(void)
+{
+	int arr[100] = {0};
+	int other[100] = {0};
+	int last = -1;
+	int i = 0;
+	avl_lsm_ty *lsm = AvlLsmCreate(&CompareInts, NULL, 16);
+
+	assert(NULL != lsm);
+	assert(0 == AvlLsmSize(lsm));
+
+	for(i = 0; i < 100; ++i)
+	{
+		arr[i] = i;
+		other[i] = i;
+		AvlLsmInsert(lsm, arr + i);
+	}
+	/* the buffered tombstones hide the elements before any merge */
+	for(i = 0; i < 100; i += 2)
+	{
+		AvlLsmRemove(lsm, arr + i);
+		assert(FAIL == AvlLsmFind(lsm, arr + i));
+		assert(SUCCESS == AvlLsmFind(lsm, arr + i + 1));
+	}
+	assert(50 == AvlLsmSize(lsm));
+
+	/* an equal element replaces the one in the tree */
+	AvlLsmInsert(lsm, other + 1);
+	AvlLsmInsert(lsm, other + 2);
+	assert(SUCCESS == AvlLsmFind(lsm, arr + 2));
+	AvlLsmRemove(lsm, arr + 97);
+	AvlLsmInsert(lsm, arr + 97);
+	assert(51 == AvlLsmSize(lsm));
+	assert(SUCCESS == AvlLsmForEach(lsm, &CheckOrder, &last));
+	assert(99 == last);
+
+	AvlLsmDestroy(lsm);
+}
+
+/* random operations checked against an array after each one */
+void AvlLsmModelTest(void)
+{
+	static unsigned char model[KEYS_RANGE];
+	static int keys[KEYS_RANGE];
+	avl_lsm_ty *lsm = AvlLsmCreate(&CompareInts, NULL, 64);
+	size_t size = 0;
+	int key = 0;
+	int i = 0;
+
+	assert(NULL != lsm);
+	for(i = 0; i < KEYS_RANGE; ++i)
+	{
+		keys[i] = i;
+	}
+
+	for(i = 0; i < OPS_NUM; ++i)
+	{
+		key = rand() % KEYS_RANGE;
+		if(rand() % 3)
+		{
+			AvlLsmInsert(lsm, keys + key);
+			size += !model[key];
+			model[key] = 1;
+		}
+		else
+		{
+			AvlLsmRemove(lsm, keys + key);
+			size -= model[key];
+			model[key] = 0;
+		}
+
+		key = rand() % KEYS_RANGE;
+		assert((model[key] ? SUCCESS : FAIL) == AvlLsmFind(lsm, keys + key));
+		if(0 == i % 1000)
+		{
+			assert(size == AvlLsmSize(lsm));
+		}
+	}
+
+	assert(SUCCESS == AvlLsmMerge(lsm));
+	assert(size == AvlLsmSize(lsm));
+	for(i = 0; i < KEYS_RANGE; ++i)
+	{
+		assert((model[i] ? SUCCESS : FAIL) == AvlLsmFind(lsm, keys + i));
+	}
+
+	AvlLsmDestroy(lsm);
+}
+
+void AvlLsmCursorTest(void)
+{
+	int arr[200] = {0};
+	avl_lsm_ty *lsm = AvlLsmCreate(&CompareInts, NULL, 1000);
+	avl_cursor_ty *cursor = NULL;
+	int *data = NULL;
+	int i = 0;
+
+	assert(NULL != lsm);
+	for(i = 0; i < 200; ++i)
+	{
+		arr[i] = 199 - i;
+		AvlLsmInsert(lsm, arr + i);
+	}
+
+	/* all in the buffer, the cursor merges them first */
+	cursor = AvlLsmCursorCreate(lsm);
+	assert(NULL != cursor);
+	for(i = 0; i < 100; ++i)
+	{
+		AvlLsmRemove(lsm, arr + i);
+	}
+	for(data = AvlCursorFirst(cursor), i = 0; NULL != data;
+		data = AvlCursorNext(cursor), ++i)
+	{
+		assert(i == *data);
+	}
+	assert(200 == i);
+	AvlLsmCursorDestroy(lsm, cursor);
+
+	cursor = AvlLsmCursorCreate(lsm);
+	assert(NULL != cursor);
+	assert(49 == *(int *)AvlCursorSeek(cursor, arr + 150));
+	assert(NULL == AvlCursorSeek(cursor, arr + 50));
+	AvlLsmCursorDestroy(lsm, cursor);
+	assert(100 == AvlLsmSize(lsm));
+
+	AvlLsmDestroy(lsm);
+}
+
+void AvlLsmThreadsTest(void)
+{
+	static int keys[THREADS_NUM][PER_THREAD];
+	pthread_t threads[THREADS_NUM];
+	worker_ty workers[THREADS_NUM];
+	avl_lsm_ty *lsm = AvlLsmCreate(&CompareInts, NULL, 256);
+	int last = -1;
+	int i = 0;
+	int j = 0;
+
+	assert(NULL != lsm);
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		for(j = 0; j < PER_THREAD; ++j)
+		{
+			keys[i][j] = j * THREADS_NUM + i;
+		}
+		workers[i].lsm = lsm;
+		workers[i].keys = keys[i];
+		assert(0 == pthread_create(threads + i, NULL, &InsertKeys,
+															workers + i));
+	}
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	assert(THREADS_NUM * PER_THREAD == AvlLsmSize(lsm));
+	assert(SUCCESS == AvlLsmForEach(lsm, &CheckOrder, &last));
+	assert(THREADS_NUM * PER_THREAD - 1 == last);
+
+	AvlLsmDestroy(lsm);
+}
+
+
+int CompareInts(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+
+	return (*(const int *)avl_data - *(const int *)user_data);
+}
+
+int CheckOrder(void *avl_data, void *params)
+{
+	int *last = (int *)params;
+
+	assert(*last < *(int *)avl_data);
+	*last = *(int *)avl_data;
+
+	return 0;
+}
+
+/* each key is found right after its insert */
+void *InsertKeys(void *arg)
+{
+	worker_ty *worker = (worker_ty *)arg;
+	int i = 0;
+
+	for(i = 0; i < PER_THREAD; ++i)
+	{
+		AvlLsmInsert(worker->lsm, worker->keys + i);
+		assert(SUCCESS == AvlLsmFind(worker->lsm, worker->keys + i));
+	}
+
+	return NULL;
+}
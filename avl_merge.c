@@ -0,0 +1,201 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : ordered walk over many avls         *
+ *                                                   *
+ *****************************************************/
+#include <assert.h> /* assert */
+#include <stdlib.h> /* malloc, free */
+
+#include "avl_merge.h"
+
+/* heap holds the indexes of the cursors that are not at their end,
+   the cursor with the smallest element on top */
+struct avl_merge
+{
+	cmp_func cmp;
+	void *params;
+	avl_cursor_ty **cursors;
+	size_t cursors_num;
+	size_t *heap;
+	size_t heap_num;
+};
+
+
+static int IsBefore(const avl_merge_ty *merge, size_t a, size_t b)
+{
+	int cmp_res = merge->cmp(AvlCursorGet(merge->cursors[a]),
+							 AvlCursorGet(merge->cursors[b]), merge->params);
+
+	return (0 > cmp_res || (0 == cmp_res && a < b));
+}
+
+static void SiftDown(avl_merge_ty *merge, size_t i)
+{
+	size_t *heap = merge->heap;
+	size_t child = 0;
+	size_t tmp = 0;
+
+	for(child = 2 * i + 1; child < merge->heap_num; child = 2 * i + 1)
+	{
+		if(child + 1 < merge->heap_num &&
+		   IsBefore(merge, heap[child + 1], heap[child]))
+		{
+			++child;
+		}
+		if(!IsBefore(merge, heap[child], heap[i]))
+		{
+			return;
+		}
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+/* heapify the cursors after each one was positioned */
+static void *BuildHeap(avl_merge_ty *merge)
+{
+	size_t i = 0;
+
+	merge->heap_num = 0;
+	for(i = 0; i < merge->cursors_num; ++i)
+	{
+		if(NULL != AvlCursorGet(merge->cursors[i]))
+		{
+			merge->heap[merge->heap_num] = i;
+			++merge->heap_num;
+		}
+	}
+	for(i = merge->heap_num / 2; 0 < i; --i)
+	{
+		SiftDown(merge, i - 1);
+	}
+
+	return AvlMergeGet(merge);
+}
+
+
+avl_merge_ty *AvlMergeCreate(avl_ty **avls, size_t n, cmp_func cmp,
+													  void *params)
+{
+	avl_merge_ty *merge = NULL;
+	size_t i = 0;
+
+	assert(0 == n || NULL != avls);
+	assert(NULL != cmp);
+
+	merge = (avl_merge_ty *)malloc(sizeof(avl_merge_ty));
+	if(NULL == merge)
+	{
+		return NULL;
+	}
+	merge->cursors = (avl_cursor_ty **)malloc(n * (sizeof(avl_cursor_ty *) +
+												   sizeof(size_t)) + 1);
+	if(NULL == merge->cursors)
+	{
+		free(merge);
+		return NULL;
+	}
+
+	merge->cmp = cmp;
+	merge->params = params;
+	merge->heap = (size_t *)(merge->cursors + n);
+	merge->heap_num = 0;
+	merge->cursors_num = 0;
+	for(i = 0; i < n; ++i)
+	{
+		merge->cursors[i] = AvlCursorCreate(avls[i]);
+		if(NULL == merge->cursors[i])
+		{
+			AvlMergeDestroy(merge);
+			return NULL;
+		}
+		++merge->cursors_num;
+	}
+
+	return merge;
+}
+
+
+void AvlMergeDestroy(avl_merge_ty *merge)
+{
+	size_t i = 0;
+
+	assert(NULL != merge);
+
+	for(i = 0; i < merge->cursors_num; ++i)
+	{
+		AvlCursorDestroy(merge->cursors[i]);
+	}
+	free(merge->cursors);
+	free(merge);
+}
+
+
+void *AvlMergeFirst(avl_merge_ty *merge)
+{
+	size_t i = 0;
+
+	assert(NULL != merge);
+
+	for(i = 0; i < merge->cursors_num; ++i)
+	{
+		AvlCursorFirst(merge->cursors[i]);
+	}
+
+	return BuildHeap(merge);
+}
+
+
+void *AvlMergeSeek(avl_merge_ty *merge, void *data)
+{
+	size_t i = 0;
+
+	assert(NULL != merge);
+
+	for(i = 0; i < merge->cursors_num; ++i)
+	{
+		AvlCursorSeek(merge->cursors[i], data);
+	}
+
+	return BuildHeap(merge);
+}
+
+
+void *AvlMergeNext(avl_merge_ty *merge)
+{
+	size_t top = 0;
+
+	assert(NULL != merge);
+
+	if(0 == merge->heap_num)
+	{
+		return NULL;
+	}
+
+	top = merge->heap[0];
+	if(NULL == AvlCursorNext(merge->cursors[top]))
+	{
+		--merge->heap_num;
+		merge->heap[0] = merge->heap[merge->heap_num];
+	}
+	SiftDown(merge, 0);
+
+	return AvlMergeGet(merge);
+}
+
+
+void *AvlMergeGet(const avl_merge_ty *merge)
+{
+	assert(NULL != merge);
+
+	if(0 == merge->heap_num)
+	{
+		return NULL;
+	}
+
+	return AvlCursorGet(merge->cursors[merge->heap[0]]);
+}
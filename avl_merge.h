@@ -0,0 +1,74 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : ordered walk over many avls         *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_MERGE_H__
+#define __ILRD_OL127_128_AVL_MERGE_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+
+typedef struct avl_merge avl_merge_ty;
+
+/*
+DESCRIPTION : create a cursor that walks the elements of all the
+avls in one order, as if they were in one multiset. equal elements
+of different avls are returned in the order of the avls. each avl
+has its own cursor positioned on its next element, so the avls may
+be changed between moves as with AvlCursorNext, and a change is
+seen from after the element each cursor is on.
+PARAMETERS : array of avls, num of avls, compare function and its
+params, ordering the elements as the compare functions of the avls.
+RETURN : pointer to the new cursor, not positioned, or NULL on failure.
+COMPLEXITY : time - O(n), space - O(n*logm), n avls of m elements
+*/
+avl_merge_ty *AvlMergeCreate(avl_ty **avls, size_t n, cmp_func cmp,
+                                                      void *params);
+
+/*
+DESCRIPTION : destroy a merge cursor, the avls are not changed.
+PARAMETERS : pointer to merge cursor
+RETURN : void
+COMPLEXITY : time - O(n), space - O(1)
+*/
+void AvlMergeDestroy(avl_merge_ty *merge);
+
+/*
+DESCRIPTION : move the cursor to the smallest element of all avls
+PARAMETERS : pointer to merge cursor
+RETURN : the element, or NULL if all avls are empty.
+COMPLEXITY : time - O(n*logm), space - O(1)
+*/
+void *AvlMergeFirst(avl_merge_ty *merge);
+
+/*
+DESCRIPTION : move the cursor to the first element of all avls
+that is not smaller than data
+PARAMETERS : pointer to merge cursor, pointer to data
+RETURN : the element, or NULL if there is none.
+COMPLEXITY : time - O(n*logm), space - O(1)
+*/
+void *AvlMergeSeek(avl_merge_ty *merge, void *data);
+
+/*
+DESCRIPTION : move the cursor to the next element, so k moves after
+AvlMergeFirst give the k smallest elements.
+PARAMETERS : pointer to merge cursor
+RETURN : the element, or NULL at the end.
+COMPLEXITY : time - O(logn) amortized, space - O(1)
+*/
+void *AvlMergeNext(avl_merge_ty *merge);
+
+/*
+DESCRIPTION : return the element at the cursor
+PARAMETERS : pointer to merge cursor
+RETURN : the element, or NULL at the end.
+COMPLEXITY : time - O(1), space - O(1)
+*/
+void *AvlMergeGet(const avl_merge_ty *merge);
+
+#endif /* __ILRD_OL127_128_AVL_MERGE_H__ */
@@ -0,0 +1,184 @@
+#include <assert.h> /* assert */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* rand */
+#include "avl_merge.h"
+
+#define TREES_NUM 16
+#define KEYS_NUM 10000
+
+
+void AvlMergeOrderTest(void);
+void AvlMergeSeekTest(void);
+void AvlMergeEmptyTest(void);
+
+int CompareInts(const void *avl_data, const void *user_data, void *params);
+
+
+int main(void)
+{
+	AvlMergeOrderTest();
+	AvlMergeSeekTest();
+	AvlMergeEmptyTest();
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlMergeOrderTest(void)
+{
+	static int keys[KEYS_NUM];
+	static int twins[KEYS_NUM];
+	avl_ty *avls[TREES_NUM];
+	avl_merge_ty *merge = NULL;
+	int *data = NULL;
+	int *prev = NULL;
+	int count = 0;
+	int i = 0;
+
+	for(i = 0; i < TREES_NUM; ++i)
+	{
+		avls[i] = AvlCreate(&CompareInts, NULL);
+		assert(NULL != avls[i]);
+	}
+	/* every tenth key is also in the tree after its own */
+	for(i = 0; i < KEYS_NUM; ++i)
+	{
+		keys[i] = i;
+		twins[i] = i;
+		AvlInsert(avls[i % (TREES_NUM - 1)], keys + i);
+		if(0 == i % 10)
+		{
+			AvlInsert(avls[i % (TREES_NUM - 1) + 1], twins + i);
+		}
+	}
+
+	merge = AvlMergeCreate(avls, TREES_NUM, &CompareInts, NULL);
+	assert(NULL != merge);
+	for(data = AvlMergeFirst(merge); NULL != data;
+		data = AvlMergeNext(merge), ++count)
+	{
+		assert(data == AvlMergeGet(merge));
+		if(NULL != prev && *prev == *data)
+		{
+			assert(prev == keys + *data);
+			assert(data == twins + *data);
+		}
+		else
+		{
+			assert(NULL == prev || *prev + 1 == *data);
+			assert(data == keys + *data);
+		}
+		prev = data;
+	}
+	assert(KEYS_NUM + KEYS_NUM / 10 == count);
+	assert(NULL == AvlMergeGet(merge));
+	assert(NULL == AvlMergeNext(merge));
+
+	/* the trees change between moves, after the element read ahead */
+	assert(0 == *(int *)AvlMergeFirst(merge));
+	AvlRemove(avls[1], keys + 1);
+	AvlRemove(avls[2], keys + 2);
+	AvlRemove(avls[3], keys + 3);
+	assert(0 == *(int *)AvlMergeNext(merge));
+	assert(2 == *(int *)AvlMergeNext(merge));
+	assert(3 == *(int *)AvlMergeNext(merge));
+	for(i = 4; i < 20; ++i)
+	{
+		assert(i == *(int *)AvlMergeNext(merge));
+		if(0 == i % 10)
+		{
+			assert(i == *(int *)AvlMergeNext(merge));
+		}
+	}
+
+	AvlMergeDestroy(merge);
+	for(i = 0; i < TREES_NUM; ++i)
+	{
+		AvlDestroy(avls[i]);
+	}
+}
+
+void AvlMergeSeekTest(void)
+{
+	int keys[300] = {0};
+	avl_ty *avls[3];
+	avl_merge_ty *merge = NULL;
+	int key = 0;
+	int i = 0;
+
+	for(i = 0; i < 3; ++i)
+	{
+		avls[i] = AvlCreate(&CompareInts, NULL);
+		assert(NULL != avls[i]);
+	}
+	for(i = 0; i < 300; ++i)
+	{
+		keys[i] = 2 * i;
+		AvlInsert(avls[rand() % 3], keys + i);
+	}
+
+	merge = AvlMergeCreate(avls, 3, &CompareInts, NULL);
+	assert(NULL != merge);
+	key = 101;
+	assert(102 == *(int *)AvlMergeSeek(merge, &key));
+	assert(104 == *(int *)AvlMergeNext(merge));
+	key = 598;
+	assert(598 == *(int *)AvlMergeSeek(merge, &key));
+	assert(NULL == AvlMergeNext(merge));
+	key = 599;
+	assert(NULL == AvlMergeSeek(merge, &key));
+
+	/* top 5 */
+	assert(0 == *(int *)AvlMergeFirst(merge));
+	for(i = 1; i < 5; ++i)
+	{
+		assert(2 * i == *(int *)AvlMergeNext(merge));
+	}
+
+	AvlMergeDestroy(merge);
+	for(i = 0; i < 3; ++i)
+	{
+		AvlDestroy(avls[i]);
+	}
+}
+
+void AvlMergeEmptyTest(void)
+{
+	int key = 7;
+	avl_ty *avls[2];
+	avl_merge_ty *merge = NULL;
+
+	merge = AvlMergeCreate(NULL, 0, &CompareInts, NULL);
+	assert(NULL != merge);
+	assert(NULL == AvlMergeFirst(merge));
+	assert(NULL == AvlMergeNext(merge));
+	AvlMergeDestroy(merge);
+
+	avls[0] = AvlCreate(&CompareInts, NULL);
+	avls[1] = AvlCreate(&CompareInts, NULL);
+	assert(NULL != avls[0] && NULL != avls[1]);
+	merge = AvlMergeCreate(avls, 2, &CompareInts, NULL);
+	assert(NULL != merge);
+	assert(NULL == AvlMergeNext(merge));
+	assert(NULL == AvlMergeFirst(merge));
+	assert(NULL == AvlMergeSeek(merge, &key));
+
+	/* a positioned cursor does not see an insert into a finished tree */
+	AvlInsert(avls[1], &key);
+	assert(7 == *(int *)AvlMergeFirst(merge));
+	assert(NULL == AvlMergeNext(merge));
+
+	AvlMergeDestroy(merge);
+	AvlDestroy(avls[0]);
+	AvlDestroy(avls[1]);
+}
+
+
+int CompareInts(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+
+	return (*(const int *)avl_data - *(const int *)user_data);
+}
@@ -0,0 +1,729 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : avl stored in file pages            *
+ *                                                   *
+ *****************************************************/
+#define _POSIX_C_SOURCE 200809L /* pread, pwrite */
+
+#include <assert.h> /* assert */
+#include <fcntl.h> /* open */
+#include <stdlib.h> /* malloc, calloc, free */
+#include <string.h> /* memcpy, memset, memcmp */
+#include <sys/stat.h> /* fstat */
+#include <unistd.h> /* pread, pwrite, fsync, close */
+
+#include "avl_paged.h"
+
+#define MAGIC "AVLPAGE"
+#define NO_NODE 0
+#define NO_FRAME (-1)
+
+typedef enum
+{
+	LEFT,
+	RIGHT,
+	CHILDREN_NUM
+} avl_children_ty;
+
+/* node ids are page * slots_per_page + slot. page 0 holds the meta,
+   so no node has the id NO_NODE */
+typedef unsigned long node_id_ty;
+
+/* a node in its page, followed by the record */
+typedef struct
+{
+	node_id_ty childrens[CHILDREN_NUM];
+	long hight;
+} paged_node_ty;
+
+/* free_head is 1 + the first freed slot, the freed slots are linked
+   through their left child */
+typedef struct
+{
+	unsigned long used;
+	unsigned long free_head;
+} page_header_ty;
+
+typedef struct
+{
+	char magic[sizeof(MAGIC)];
+	unsigned long record_size;
+	node_id_ty root;
+	unsigned long size;
+	unsigned long pages_num;
+	unsigned long last_page;
+} meta_ty;
+
+/* frames of a bucket are linked through next */
+typedef struct
+{
+	unsigned long page_no;
+	long next;
+	bool_ty is_used;
+	bool_ty is_dirty;
+	bool_ty is_referenced;
+	unsigned char *data;
+} frame_ty;
+
+/* the frames are replaced by CLOCK: the hand passes over referenced
+   frames once, clearing the bit, and takes the first frame without it.
+   after an io error the tree is broken, accesses get a zeroed page
+   and every call fails */
+struct avl_paged
+{
+	int fd;
+	cmp_func cmp;
+	void *params;
+	size_t record_size;
+	size_t node_size;
+	size_t slots_per_page;
+	meta_ty meta;
+	frame_ty *frames;
+	size_t frames_num;
+	size_t hand;
+	long *buckets;
+	size_t buckets_num;
+	unsigned char *pages;
+	unsigned char *bad_page;
+	size_t reads;
+	size_t writes;
+	status_ty io_status;
+};
+
+
+/*--------------- buffer pool ------------*/
+
+static status_ty WritePage(avl_paged_ty *paged, frame_ty *frame)
+{
+	off_t offset = (off_t)frame->page_no * AVL_PAGE_SIZE;
+
+	++paged->writes;
+	if(AVL_PAGE_SIZE != pwrite(paged->fd, frame->data, AVL_PAGE_SIZE, offset))
+	{
+		return FAIL;
+	}
+	frame->is_dirty = FALSE;
+
+	return SUCCESS;
+}
+
+/* pages after the end of the file are read as zeros */
+static status_ty ReadPage(avl_paged_ty *paged, frame_ty *frame)
+{
+	off_t offset = (off_t)frame->page_no * AVL_PAGE_SIZE;
+	ssize_t got = 0;
+
+	++paged->reads;
+	got = pread(paged->fd, frame->data, AVL_PAGE_SIZE, offset);
+	if(0 > got)
+	{
+		return FAIL;
+	}
+	memset(frame->data + got, 0, AVL_PAGE_SIZE - (size_t)got);
+
+	return SUCCESS;
+}
+
+static void Unlink(avl_paged_ty *paged, long index)
+{
+	long *link = paged->buckets +
+				 paged->frames[index].page_no % paged->buckets_num;
+
+	while(*link != index)
+	{
+		link = &paged->frames[*link].next;
+	}
+	*link = paged->frames[index].next;
+}
+
+static long Evict(avl_paged_ty *paged)
+{
+	frame_ty *frame = NULL;
+	long index = 0;
+
+	for(;;)
+	{
+		index = (long)paged->hand;
+		frame = paged->frames + index;
+		paged->hand = (paged->hand + 1) % paged->frames_num;
+
+		if(!frame->is_used)
+		{
+			return index;
+		}
+		if(frame->is_referenced)
+		{
+			frame->is_referenced = FALSE;
+			continue;
+		}
+		if(frame->is_dirty && SUCCESS != WritePage(paged, frame))
+		{
+			paged->io_status = FAIL;
+		}
+		Unlink(paged, index);
+		frame->is_used = FALSE;
+
+		return index;
+	}
+}
+
+static unsigned char *GetPage(avl_paged_ty *paged, unsigned long page_no,
+												   bool_ty is_write)
+{
+	long *bucket = paged->buckets + page_no % paged->buckets_num;
+	frame_ty *frame = NULL;
+	long index = *bucket;
+
+	while(NO_FRAME != index && paged->frames[index].page_no != page_no)
+	{
+		index = paged->frames[index].next;
+	}
+
+	if(NO_FRAME == index)
+	{
+		index = Evict(paged);
+		frame = paged->frames + index;
+		frame->page_no = page_no;
+		if(SUCCESS != ReadPage(paged, frame))
+		{
+			paged->io_status = FAIL;
+			memset(paged->bad_page, 0, AVL_PAGE_SIZE);
+			return paged->bad_page;
+		}
+		frame->is_used = TRUE;
+		frame->is_dirty = FALSE;
+		frame->next = *bucket;
+		*bucket = index;
+	}
+
+	frame = paged->frames + index;
+	frame->is_referenced = TRUE;
+	frame->is_dirty |= is_write;
+
+	return frame->data;
+}
+
+
+/*--------------- nodes ------------*/
+
+static unsigned long PageOf(const avl_paged_ty *paged, node_id_ty id)
+{
+	return id / paged->slots_per_page;
+}
+
+/* valid until the next page access */
+static unsigned char *NodeAt(avl_paged_ty *paged, node_id_ty id,
+											  bool_ty is_write)
+{
+	unsigned char *page = GetPage(paged, PageOf(paged, id), is_write);
+
+	return page + sizeof(page_header_ty) +
+		   (id % paged->slots_per_page) * paged->node_size;
+}
+
+static const void *RecordOf(avl_paged_ty *paged, node_id_ty id)
+{
+	return NodeAt(paged, id, FALSE) + sizeof(paged_node_ty);
+}
+
+static void ReadNode(avl_paged_ty *paged, node_id_ty id, paged_node_ty *node)
+{
+	memcpy(node, NodeAt(paged, id, FALSE), sizeof(paged_node_ty));
+}
+
+static void WriteNode(avl_paged_ty *paged, node_id_ty id,
+										   const paged_node_ty *node)
+{
+	memcpy(NodeAt(paged, id, TRUE), node, sizeof(paged_node_ty));
+}
+
+static long GetHight(avl_paged_ty *paged, node_id_ty id)
+{
+	paged_node_ty node;
+
+	if(NO_NODE == id)
+	{
+		return -1;
+	}
+	ReadNode(paged, id, &node);
+
+	return node.hight;
+}
+
+/* take a slot in page_no, returns NO_NODE when it is full */
+static node_id_ty TakeSlot(avl_paged_ty *paged, unsigned long page_no)
+{
+	page_header_ty header;
+	unsigned char *page = GetPage(paged, page_no, FALSE);
+	paged_node_ty freed;
+	unsigned long slot = 0;
+
+	memcpy(&header, page, sizeof(page_header_ty));
+	if(0 != header.free_head)
+	{
+		slot = header.free_head - 1;
+		memcpy(&freed, page + sizeof(page_header_ty) +
+					   slot * paged->node_size, sizeof(paged_node_ty));
+		header.free_head = freed.childrens[LEFT];
+	}
+	else if(header.used < paged->slots_per_page)
+	{
+		slot = header.used;
+		++header.used;
+	}
+	else
+	{
+		return NO_NODE;
+	}
+	memcpy(GetPage(paged, page_no, TRUE), &header, sizeof(page_header_ty));
+
+	return page_no * paged->slots_per_page + slot;
+}
+
+/* a new node goes to the page of its parent while it has room */
+static node_id_ty AllocNode(avl_paged_ty *paged, unsigned long parent_page)
+{
+	node_id_ty id = NO_NODE;
+
+	if(0 != parent_page)
+	{
+		id = TakeSlot(paged, parent_page);
+	}
+	if(NO_NODE == id && 0 != paged->meta.last_page &&
+	   parent_page != paged->meta.last_page)
+	{
+		id = TakeSlot(paged, paged->meta.last_page);
+	}
+	if(NO_NODE == id)
+	{
+		paged->meta.last_page = paged->meta.pages_num;
+		++paged->meta.pages_num;
+		id = TakeSlot(paged, paged->meta.last_page);
+	}
+
+	return id;
+}
+
+static void FreeNode(avl_paged_ty *paged, node_id_ty id)
+{
+	page_header_ty header;
+	paged_node_ty node;
+	unsigned long page_no = PageOf(paged, id);
+
+	memcpy(&header, GetPage(paged, page_no, FALSE), sizeof(page_header_ty));
+	node.childrens[LEFT] = header.free_head;
+	node.childrens[RIGHT] = NO_NODE;
+	node.hight = 0;
+	WriteNode(paged, id, &node);
+	header.free_head = id % paged->slots_per_page + 1;
+	memcpy(GetPage(paged, page_no, TRUE), &header, sizeof(page_header_ty));
+}
+
+
+/*--------------- balance ------------*/
+
+static void UpdateHight(avl_paged_ty *paged, paged_node_ty *node)
+{
+	long left = GetHight(paged, node->childrens[LEFT]);
+	long right = GetHight(paged, node->childrens[RIGHT]);
+
+	node->hight = 1 + ((left >= right) ? left : right);
+}
+
+/* rotate the child at side up over id, returns the new sub tree root */
+static node_id_ty Rotate(avl_paged_ty *paged, node_id_ty id,
+											  avl_children_ty side)
+{
+	avl_children_ty other = (LEFT == side) ? RIGHT : LEFT;
+	paged_node_ty node;
+	paged_node_ty child;
+	node_id_ty child_id = NO_NODE;
+
+	ReadNode(paged, id, &node);
+	child_id = node.childrens[side];
+	ReadNode(paged, child_id, &child);
+
+	node.childrens[side] = child.childrens[other];
+	UpdateHight(paged, &node);
+	WriteNode(paged, id, &node);
+
+	child.childrens[other] = id;
+	UpdateHight(paged, &child);
+	WriteNode(paged, child_id, &child);
+
+	return child_id;
+}
+
+static node_id_ty Balance(avl_paged_ty *paged, node_id_ty id)
+{
+	paged_node_ty node;
+	paged_node_ty child;
+	long diff = 0;
+	avl_children_ty high = LEFT;
+	avl_children_ty low = RIGHT;
+
+	ReadNode(paged, id, &node);
+	diff = GetHight(paged, node.childrens[LEFT]) -
+		   GetHight(paged, node.childrens[RIGHT]);
+
+	if(-1 <= diff && 1 >= diff)
+	{
+		UpdateHight(paged, &node);
+		WriteNode(paged, id, &node);
+		return id;
+	}
+
+	if(0 > diff)
+	{
+		high = RIGHT;
+		low = LEFT;
+	}
+	ReadNode(paged, node.childrens[high], &child);
+	if(GetHight(paged, child.childrens[low]) >
+	   GetHight(paged, child.childrens[high]))
+	{
+		node.childrens[high] = Rotate(paged, node.childrens[high], low);
+		WriteNode(paged, id, &node);
+	}
+
+	return Rotate(paged, id, high);
+}
+
+
+/*--------------- tree ------------*/
+
+static node_id_ty Insert(avl_paged_ty *paged, node_id_ty id,
+						 const void *record, unsigned long parent_page)
+{
+	paged_node_ty node;
+	avl_children_ty side = LEFT;
+
+	if(NO_NODE == id)
+	{
+		id = AllocNode(paged, parent_page);
+		node.childrens[LEFT] = NO_NODE;
+		node.childrens[RIGHT] = NO_NODE;
+		node.hight = 0;
+		WriteNode(paged, id, &node);
+		memcpy(NodeAt(paged, id, TRUE) + sizeof(paged_node_ty), record,
+														paged->record_size);
+		return id;
+	}
+
+	side = (0 > paged->cmp(RecordOf(paged, id), record, paged->params)) ?
+																RIGHT : LEFT;
+	ReadNode(paged, id, &node);
+	node.childrens[side] = Insert(paged, node.childrens[side], record,
+												   PageOf(paged, id));
+	WriteNode(paged, id, &node);
+
+	return Balance(paged, id);
+}
+
+static node_id_ty RemoveMostLeft(avl_paged_ty *paged, node_id_ty id,
+												   node_id_ty *most_left)
+{
+	paged_node_ty node;
+
+	ReadNode(paged, id, &node);
+	if(NO_NODE == node.childrens[LEFT])
+	{
+		*most_left = id;
+		return node.childrens[RIGHT];
+	}
+
+	node.childrens[LEFT] = RemoveMostLeft(paged, node.childrens[LEFT],
+															most_left);
+	WriteNode(paged, id, &node);
+
+	return Balance(paged, id);
+}
+
+static node_id_ty RemoveNode(avl_paged_ty *paged, node_id_ty id)
+{
+	paged_node_ty node;
+	paged_node_ty next;
+	node_id_ty next_id = NO_NODE;
+	node_id_ty right = NO_NODE;
+
+	ReadNode(paged, id, &node);
+	if(NO_NODE == node.childrens[LEFT] || NO_NODE == node.childrens[RIGHT])
+	{
+		next_id = (NO_NODE == node.childrens[LEFT]) ?
+				  node.childrens[RIGHT] : node.childrens[LEFT];
+		FreeNode(paged, id);
+		return next_id;
+	}
+
+	/* two childrens - the next node takes its place */
+	right = RemoveMostLeft(paged, node.childrens[RIGHT], &next_id);
+	ReadNode(paged, next_id, &next);
+	next.childrens[LEFT] = node.childrens[LEFT];
+	next.childrens[RIGHT] = right;
+	WriteNode(paged, next_id, &next);
+	FreeNode(paged, id);
+
+	return Balance(paged, next_id);
+}
+
+static node_id_ty Remove(avl_paged_ty *paged, node_id_ty id,
+						 const void *record, bool_ty *found)
+{
+	paged_node_ty node;
+	avl_children_ty side = LEFT;
+	int cmp_res = 0;
+
+	if(NO_NODE == id)
+	{
+		return NO_NODE;
+	}
+
+	cmp_res = paged->cmp(RecordOf(paged, id), record, paged->params);
+	if(0 == cmp_res)
+	{
+		*found = TRUE;
+		return RemoveNode(paged, id);
+	}
+
+	side = (0 > cmp_res) ? RIGHT : LEFT;
+	ReadNode(paged, id, &node);
+	node.childrens[side] = Remove(paged, node.childrens[side], record, found);
+	WriteNode(paged, id, &node);
+
+	return Balance(paged, id);
+}
+
+
+/*--------------- public ------------*/
+
+static void FreePaged(avl_paged_ty *paged)
+{
+	if(0 <= paged->fd)
+	{
+		close(paged->fd);
+	}
+	free(paged->frames);
+	free(paged->buckets);
+	free(paged->pages);
+	free(paged->bad_page);
+	free(paged);
+}
+
+static status_ty LoadMeta(avl_paged_ty *paged)
+{
+	unsigned char page[AVL_PAGE_SIZE];
+	struct stat st;
+
+	if(0 != fstat(paged->fd, &st))
+	{
+		return FAIL;
+	}
+
+	if(0 == st.st_size)
+	{
+		memset(&paged->meta, 0, sizeof(meta_ty));
+		memcpy(paged->meta.magic, MAGIC, sizeof(MAGIC));
+		paged->meta.record_size = paged->record_size;
+		paged->meta.root = NO_NODE;
+		paged->meta.pages_num = 1;
+		return SUCCESS;
+	}
+
+	if(AVL_PAGE_SIZE != pread(paged->fd, page, AVL_PAGE_SIZE, 0))
+	{
+		return FAIL;
+	}
+	memcpy(&paged->meta, page, sizeof(meta_ty));
+	if(0 != memcmp(paged->meta.magic, MAGIC, sizeof(MAGIC)) ||
+	   paged->meta.record_size != paged->record_size)
+	{
+		return FAIL;
+	}
+
+	return SUCCESS;
+}
+
+avl_paged_ty *AvlPagedOpen(const char *path, size_t record_size,
+                           cmp_func cmp, void *params, size_t pool_pages)
+{
+	avl_paged_ty *paged = NULL;
+	size_t i = 0;
+
+	assert(NULL != path);
+	assert(NULL != cmp);
+	assert(0 < record_size);
+	assert(0 < pool_pages);
+
+	paged = (avl_paged_ty *)calloc(1, sizeof(avl_paged_ty));
+	if(NULL == paged)
+	{
+		return NULL;
+	}
+	paged->cmp = cmp;
+	paged->params = params;
+	paged->record_size = record_size;
+	paged->node_size = (sizeof(paged_node_ty) + record_size +
+						sizeof(long) - 1) & ~(sizeof(long) - 1);
+	paged->slots_per_page = (AVL_PAGE_SIZE - sizeof(page_header_ty)) /
+							paged->node_size;
+	paged->frames_num = pool_pages;
+	paged->buckets_num = pool_pages * 2;
+	paged->io_status = SUCCESS;
+	paged->fd = open(path, O_RDWR | O_CREAT, 0644);
+
+	paged->frames = (frame_ty *)calloc(pool_pages, sizeof(frame_ty));
+	paged->buckets = (long *)malloc(paged->buckets_num * sizeof(long));
+	paged->pages = (unsigned char *)malloc(pool_pages * AVL_PAGE_SIZE);
+	paged->bad_page = (unsigned char *)malloc(AVL_PAGE_SIZE);
+	if(2 > paged->slots_per_page || 0 > paged->fd || NULL == paged->frames ||
+	   NULL == paged->buckets || NULL == paged->pages ||
+	   NULL == paged->bad_page || SUCCESS != LoadMeta(paged))
+	{
+		FreePaged(paged);
+		return NULL;
+	}
+
+	for(i = 0; i < pool_pages; ++i)
+	{
+		paged->frames[i].data = paged->pages + i * AVL_PAGE_SIZE;
+		paged->frames[i].is_used = FALSE;
+	}
+	for(i = 0; i < paged->buckets_num; ++i)
+	{
+		paged->buckets[i] = NO_FRAME;
+	}
+
+	return paged;
+}
+
+
+status_ty AvlPagedClose(avl_paged_ty *paged)
+{
+	unsigned char page[AVL_PAGE_SIZE];
+	status_ty status = SUCCESS;
+	size_t i = 0;
+
+	assert(NULL != paged);
+
+	status = paged->io_status;
+	for(i = 0; i < paged->frames_num && SUCCESS == status; ++i)
+	{
+		if(paged->frames[i].is_used && paged->frames[i].is_dirty)
+		{
+			status = WritePage(paged, paged->frames + i);
+		}
+	}
+
+	/* the meta is written last, so it never points at unwritten pages */
+	memset(page, 0, AVL_PAGE_SIZE);
+	memcpy(page, &paged->meta, sizeof(meta_ty));
+	if(SUCCESS == status &&
+	   (0 != fsync(paged->fd) ||
+		AVL_PAGE_SIZE != pwrite(paged->fd, page, AVL_PAGE_SIZE, 0) ||
+		0 != fsync(paged->fd)))
+	{
+		status = FAIL;
+	}
+	FreePaged(paged);
+
+	return status;
+}
+
+
+status_ty AvlPagedInsert(avl_paged_ty *paged, const void *record)
+{
+	assert(NULL != paged);
+	assert(NULL != record);
+
+	if(SUCCESS != paged->io_status)
+	{
+		return FAIL;
+	}
+	paged->meta.root = Insert(paged, paged->meta.root, record, 0);
+	++paged->meta.size;
+
+	return paged->io_status;
+}
+
+
+status_ty AvlPagedRemove(avl_paged_ty *paged, const void *record)
+{
+	bool_ty found = FALSE;
+
+	assert(NULL != paged);
+	assert(NULL != record);
+
+	if(SUCCESS != paged->io_status)
+	{
+		return FAIL;
+	}
+	paged->meta.root = Remove(paged, paged->meta.root, record, &found);
+	if(found)
+	{
+		--paged->meta.size;
+	}
+
+	return paged->io_status;
+}
+
+
+status_ty AvlPagedFind(avl_paged_ty *paged, const void *record, void *found)
+{
+	paged_node_ty node;
+	node_id_ty id = NO_NODE;
+	int cmp_res = 0;
+
+	assert(NULL != paged);
+	assert(NULL != record);
+
+	for(id = paged->meta.root; NO_NODE != id && SUCCESS == paged->io_status;
+		id = node.childrens[(0 > cmp_res) ? RIGHT : LEFT])
+	{
+		cmp_res = paged->cmp(RecordOf(paged, id), record, paged->params);
+		if(0 == cmp_res)
+		{
+			if(NULL != found)
+			{
+				memcpy(found, RecordOf(paged, id), paged->record_size);
+			}
+			return paged->io_status;
+		}
+		ReadNode(paged, id, &node);
+	}
+
+	return FAIL;
+}
+
+
+size_t AvlPagedSize(const avl_paged_ty *paged)
+{
+	assert(NULL != paged);
+
+	return paged->meta.size;
+}
+
+
+long AvlPagedHeight(avl_paged_ty *paged)
+{
+	assert(NULL != paged);
+
+	if(NO_NODE == paged->meta.root)
+	{
+		return 0;
+	}
+	return GetHight(paged, paged->meta.root);
+}
+
+
+void AvlPagedGetStats(const avl_paged_ty *paged, size_t *reads,
+                                                size_t *writes)
+{
+	assert(NULL != paged);
+	assert(NULL != reads);
+	assert(NULL != writes);
+
+	*reads = paged->reads;
+	*writes = paged->writes;
+}
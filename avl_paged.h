@@ -0,0 +1,93 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : avl stored in file pages            *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_PAGED_H__
+#define __ILRD_OL127_128_AVL_PAGED_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+
+#define AVL_PAGE_SIZE 4096
+
+typedef struct avl_paged avl_paged_ty;
+
+/*
+DESCRIPTION : open an avl of fixed size records kept in 4 KiB pages
+of a file, creating the file when it does not exist. at most
+pool_pages pages are in memory, the others are read when needed
+and written back when evicted. new nodes are put in the page of
+their parent while it has room, so searches cross few pages.
+PARAMETERS : path of the file, size of a record, pointer compare
+function on records, params to compare function, num of pages
+in memory.
+RETURN : pointer to the tree, or NULL on failure or if the file
+holds records of another size.
+COMPLEXITY : time - O(pool_pages), space - O(pool_pages)
+*/
+avl_paged_ty *AvlPagedOpen(const char *path, size_t record_size,
+                           cmp_func cmp, void *params, size_t pool_pages);
+
+/*
+DESCRIPTION : write all changed pages to the file and close it
+PARAMETERS : pointer to tree
+RETURN : SUCCESS, or FAIL if the file could not be written.
+COMPLEXITY : time - O(pool_pages), space - O(1)
+*/
+status_ty AvlPagedClose(avl_paged_ty *paged);
+
+/*
+DESCRIPTION : insert a copy of record to the tree
+PARAMETERS : pointer to tree, pointer to record
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(logn) page accesses, space - O(logn)
+*/
+status_ty AvlPagedInsert(avl_paged_ty *paged, const void *record);
+
+/*
+DESCRIPTION : remove a record equal to record from the tree
+PARAMETERS : pointer to tree, pointer to record
+RETURN : SUCCESS, or FAIL on io failure.
+COMPLEXITY : time - O(logn) page accesses, space - O(logn)
+*/
+status_ty AvlPagedRemove(avl_paged_ty *paged, const void *record);
+
+/*
+DESCRIPTION : check if a record equal to record exist, and copy it
+PARAMETERS : pointer to tree, pointer to record, pointer to
+record_size bytes for the found record or NULL.
+RETURN : SUCCESS if found, else FAIL.
+COMPLEXITY : time - O(logn) page accesses, space - O(1)
+*/
+status_ty AvlPagedFind(avl_paged_ty *paged, const void *record, void *found);
+
+/*
+DESCRIPTION : return the num of records
+PARAMETERS : pointer to tree
+RETURN : num of records(size_t)
+COMPLEXITY : time - O(1), space - O(1)
+*/
+size_t AvlPagedSize(const avl_paged_ty *paged);
+
+/*
+DESCRIPTION : return the hight of the tree
+PARAMETERS : pointer to tree
+RETURN : the hight(long)
+COMPLEXITY : time - O(1) page accesses, space - O(1)
+*/
+long AvlPagedHeight(avl_paged_ty *paged);
+
+/*
+DESCRIPTION : get the num of pages read from and written to the file
+PARAMETERS : pointer to tree, pointers to reads and writes
+RETURN : void
+COMPLEXITY : time - O(1), space - O(1)
+*/
+void AvlPagedGetStats(const avl_paged_ty *paged, size_t *reads,
+                                                size_t *writes);
+
+#endif /* __ILRD_OL127_128_AVL_PAGED_H__ */
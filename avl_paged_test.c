@@ -0,0 +1,174 @@
+#include <assert.h> /* assert */
+#include <stdio.h> /* printf, remove */
+#include <stdlib.h> /* rand */
+#include <string.h> /* memset */
+#include "avl_paged.h"
+
+#define PATH "avl_paged_test.db"
+#define POOL_PAGES 4
+#define RECORDS_NUM 5000
+/* 1.44 * log2(5000) */
+#define MAX_HIGHT 18
+
+typedef struct
+{
+	long key;
+	long value;
+	char name[40];
+} record_ty;
+
+
+void AvlPagedBasicTest(void);
+void AvlPagedReopenTest(void);
+void AvlPagedRecordSizeTest(void);
+
+int CompareRecords(const void *avl_data, const void *user_data, void *params);
+void MakeRecord(record_ty *record, long key);
+
+
+int main(void)
+{
+	AvlPagedBasicTest();
+	AvlPagedReopenTest();
+	AvlPagedRecordSizeTest();
+	remove(PATH);
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlPagedBasicTest(void)
+{
+	avl_paged_ty *paged = NULL;
+	record_ty record;
+	record_ty found;
+	size_t reads = 0;
+	size_t writes = 0;
+	long i = 0;
+
+	remove(PATH);
+	paged = AvlPagedOpen(PATH, sizeof(record_ty), &CompareRecords, NULL,
+															POOL_PAGES);
+	assert(NULL != paged);
+	assert(0 == AvlPagedSize(paged));
+	assert(0 == AvlPagedHeight(paged));
+	MakeRecord(&record, 1);
+	assert(FAIL == AvlPagedFind(paged, &record, NULL));
+
+	/* far more pages than the pool, in random order */
+	for(i = 0; i < RECORDS_NUM; ++i)
+	{
+		MakeRecord(&record, (i * 7919) % RECORDS_NUM);
+		assert(SUCCESS == AvlPagedInsert(paged, &record));
+	}
+	assert(RECORDS_NUM == AvlPagedSize(paged));
+	assert(MAX_HIGHT >= AvlPagedHeight(paged));
+
+	for(i = 0; i < RECORDS_NUM; ++i)
+	{
+		memset(&found, 0, sizeof(record_ty));
+		record.key = i;
+		assert(SUCCESS == AvlPagedFind(paged, &record, &found));
+		assert(i == found.key);
+		assert(i * 3 == found.value);
+		assert(found.name[0] == (char)('a' + i % 26));
+	}
+	record.key = RECORDS_NUM;
+	assert(FAIL == AvlPagedFind(paged, &record, &found));
+
+	for(i = 0; i < RECORDS_NUM; i += 2)
+	{
+		record.key = i;
+		assert(SUCCESS == AvlPagedRemove(paged, &record));
+	}
+	record.key = RECORDS_NUM;
+	assert(SUCCESS == AvlPagedRemove(paged, &record));
+	assert(RECORDS_NUM / 2 == AvlPagedSize(paged));
+
+	/* freed slots are taken again */
+	AvlPagedGetStats(paged, &reads, &writes);
+	assert(0 < reads);
+	assert(0 < writes);
+	for(i = 0; i < RECORDS_NUM; i += 2)
+	{
+		MakeRecord(&record, i);
+		assert(SUCCESS == AvlPagedInsert(paged, &record));
+	}
+	for(i = 0; i < RECORDS_NUM; i += 2)
+	{
+		record.key = i;
+		assert(SUCCESS == AvlPagedRemove(paged, &record));
+	}
+	assert(SUCCESS == AvlPagedClose(paged));
+}
+
+void AvlPagedReopenTest(void)
+{
+	avl_paged_ty *paged = NULL;
+	record_ty record;
+	record_ty found;
+	long i = 0;
+
+	paged = AvlPagedOpen(PATH, sizeof(record_ty), &CompareRecords, NULL,
+															POOL_PAGES);
+	assert(NULL != paged);
+	assert(RECORDS_NUM / 2 == AvlPagedSize(paged));
+	assert(MAX_HIGHT >= AvlPagedHeight(paged));
+
+	for(i = 0; i < RECORDS_NUM; ++i)
+	{
+		record.key = i;
+		assert((i % 2 ? SUCCESS : FAIL) == AvlPagedFind(paged, &record,
+																&found));
+	}
+
+	/* equal keys are kept */
+	MakeRecord(&record, 1);
+	assert(SUCCESS == AvlPagedInsert(paged, &record));
+	assert(RECORDS_NUM / 2 + 1 == AvlPagedSize(paged));
+	assert(SUCCESS == AvlPagedRemove(paged, &record));
+	assert(SUCCESS == AvlPagedFind(paged, &record, NULL));
+
+	for(i = 1; i < RECORDS_NUM; i += 2)
+	{
+		record.key = i;
+		assert(SUCCESS == AvlPagedRemove(paged, &record));
+	}
+	assert(0 == AvlPagedSize(paged));
+	assert(0 == AvlPagedHeight(paged));
+	assert(SUCCESS == AvlPagedClose(paged));
+}
+
+void AvlPagedRecordSizeTest(void)
+{
+	avl_paged_ty *paged = NULL;
+
+	paged = AvlPagedOpen(PATH, sizeof(long), &CompareRecords, NULL,
+													  POOL_PAGES);
+	assert(NULL == paged);
+	paged = AvlPagedOpen(PATH, sizeof(record_ty), &CompareRecords, NULL, 1);
+	assert(NULL != paged);
+	assert(0 == AvlPagedSize(paged));
+	assert(SUCCESS == AvlPagedClose(paged));
+}
+
+
+int CompareRecords(const void *avl_data, const void *user_data, void *params)
+{
+	long avl_key = ((const record_ty *)avl_data)->key;
+	long user_key = ((const record_ty *)user_data)->key;
+
+	(void)params;
+
+	return (avl_key > user_key) - (avl_key < user_key);
+}
+
+void MakeRecord(record_ty *record, long key)
+{
+	memset(record, 0, sizeof(record_ty));
+	record->key = key;
+	record->value = key * 3;
+	record->name[0] = (char)('a' + key % 26);
+}
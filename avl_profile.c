@@ -0,0 +1,354 @@
+#define _GNU_SOURCE /* syscall */
+
+#include <assert.h> /* assert */
+#include <errno.h> /* errno */
+#include <linux/perf_event.h> /* perf_event_attr */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, rand */
+#include <string.h> /* memset, strerror */
+#include <sys/ioctl.h> /* ioctl */
+#include <sys/syscall.h> /* __NR_perf_event_open */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* syscall, read, close */
+
+#include "avl.h"
+
+#define COUNTERS_NUM 6
+#define CACHE_MISS(cache) ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+							(PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/* a hardware counter of this process, fd is -1 when not available */
+typedef struct
+{
+	const char *name;
+	unsigned int type;
+	unsigned long config;
+	int fd;
+} counter_ty;
+
+/* the counters and the time of one measured operation. a counter
+   the kernel multiplexed with others counted only part of the time,
+   its value is scaled up to the whole sample */
+typedef struct
+{
+	double ns;
+	double values[COUNTERS_NUM];
+	bool_ty is_counted[COUNTERS_NUM];
+	bool_ty is_scaled;
+} sample_ty;
+
+/* the layout of a counter read with the times in read_format */
+typedef struct
+{
+	__u64 value;
+	__u64 enabled;
+	__u64 running;
+} reading_ty;
+
+typedef enum
+{
+	INSERT,
+	FIND,
+	FOR_EACH,
+	REMOVE,
+	OPS_NUM
+} op_ty;
+
+
+static void OpenCounters(void);
+static void CloseCounters(void);
+static void StartSample(void);
+static void EndSample(sample_ty *sample);
+static void ProfileTree(const char *dist, long *keys, long *probes, size_t n);
+static void PrintSample(const char *dist, size_t n, op_ty op,
+						const sample_ty *sample, size_t ops_num);
+
+double Now(void);
+void ShuffleLongs(long *arr, size_t n);
+int CompareLongs(const void *avl_data, const void *user_data, void *params);
+int CountLongs(void *data, void *params);
+
+
+static counter_ty counters[COUNTERS_NUM] = {
+	{"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1},
+	{"instr", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1},
+	{"L1d-miss", PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_L1D), -1},
+	{"LLC-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1},
+	{"br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1},
+	{"dTLB-miss", PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB), -1}
+};
+
+static const char *op_names[OPS_NUM] = {"insert", "find", "foreach", "remove"};
+
+static const size_t sizes[] = {1024, 65536, 1048576};
+
+static double start_ns;
+
+static bool_ty is_any_scaled = FALSE;
+
+
+/* per operation averages of every tree size, for keys inserted and
+   searched in order and in random order */
+int main(void)
+{
+	size_t max_size = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+	long *keys = (long *)malloc(max_size * sizeof(long));
+	long *probes = (long *)malloc(max_size * sizeof(long));
+	size_t n = 0;
+	size_t i = 0;
+	size_t j = 0;
+	int c = 0;
+
+	assert(NULL != keys && NULL != probes);
+
+	OpenCounters();
+	printf("%-10s %8s %-8s %9s", "keys", "size", "op", "ns");
+	for(c = 0; c < COUNTERS_NUM; ++c)
+	{
+		printf(" %10s", counters[c].name);
+	}
+	printf("\n");
+
+	for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+	{
+		n = sizes[i];
+		for(j = 0; j < n; ++j)
+		{
+			keys[j] = (long)j;
+			probes[j] = (long)j;
+		}
+		ProfileTree("sequential", keys, probes, n);
+
+		ShuffleLongs(keys, n);
+		ShuffleLongs(probes, n);
+		ProfileTree("random", keys, probes, n);
+	}
+
+	if(is_any_scaled)
+	{
+		printf("* counters were multiplexed, the counts are scaled "
+									"to the whole sample\n");
+	}
+
+	CloseCounters();
+	free(keys);
+	free(probes);
+
+	return 0;
+}
+
+
+/* containers and kernels with perf_event_paranoid > 2 refuse the
+   counters, the times are measured anyway */
+static void OpenCounters(void)
+{
+	struct perf_event_attr attr;
+	int opened = 0;
+	int c = 0;
+
+	for(c = 0; c < COUNTERS_NUM; ++c)
+	{
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = counters[c].type;
+		attr.config = counters[c].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+							PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		counters[c].fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+																	-1, 0);
+		if(-1 == counters[c].fd)
+		{
+			fprintf(stderr, "%s: not available, %s\n", counters[c].name,
+														strerror(errno));
+			continue;
+		}
+		++opened;
+	}
+
+	if(0 == opened)
+	{
+		fprintf(stderr, "no perf counters, reporting times only\n");
+	}
+}
+
+static void CloseCounters(void)
+{
+	int c = 0;
+
+	for(c = 0; c < COUNTERS_NUM; ++c)
+	{
+		if(-1 != counters[c].fd)
+		{
+			close(counters[c].fd);
+			counters[c].fd = -1;
+		}
+	}
+}
+
+static void StartSample(void)
+{
+	int c = 0;
+
+	for(c = 0; c < COUNTERS_NUM; ++c)
+	{
+		if(-1 != counters[c].fd)
+		{
+			ioctl(counters[c].fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(counters[c].fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+	start_ns = Now() * 1e9;
+}
+
+/* a counter that never ran in the sample is not counted */
+static void EndSample(sample_ty *sample)
+{
+	reading_ty reading;
+	int c = 0;
+
+	sample->ns = Now() * 1e9 - start_ns;
+	sample->is_scaled = FALSE;
+	for(c = 0; c < COUNTERS_NUM; ++c)
+	{
+		sample->values[c] = 0;
+		sample->is_counted[c] = FALSE;
+		if(-1 == counters[c].fd)
+		{
+			continue;
+		}
+		ioctl(counters[c].fd, PERF_EVENT_IOC_DISABLE, 0);
+		if(sizeof(reading) != read(counters[c].fd, &reading,
+									sizeof(reading)) || 0 == reading.running)
+		{
+			continue;
+		}
+
+		sample->is_counted[c] = TRUE;
+		sample->values[c] = (double)reading.value;
+		if(reading.running < reading.enabled)
+		{
+			sample->values[c] *= (double)reading.enabled / reading.running;
+			sample->is_scaled = TRUE;
+		}
+	}
+}
+
+
+/* insert keys, find probes, visit the tree and remove keys, each
+   phase averaged over n operations */
+static void ProfileTree(const char *dist, long *keys, long *probes, size_t n)
+{
+	avl_ty *avl = AvlCreate(&CompareLongs, NULL);
+	sample_ty sample;
+	size_t visited = 0;
+	size_t i = 0;
+
+	assert(NULL != avl);
+
+	StartSample();
+	for(i = 0; i < n; ++i)
+	{
+		AvlInsert(avl, keys + i);
+	}
+	EndSample(&sample);
+	PrintSample(dist, n, INSERT, &sample, n);
+
+	StartSample();
+	for(i = 0; i < n; ++i)
+	{
+		if(SUCCESS != AvlFind(avl, probes + i))
+		{
+			abort();
+		}
+	}
+	EndSample(&sample);
+	PrintSample(dist, n, FIND, &sample, n);
+
+	StartSample();
+	AvlForEach(avl, &CountLongs, &visited, INORDER);
+	EndSample(&sample);
+	assert(n == visited);
+	PrintSample(dist, n, FOR_EACH, &sample, n);
+
+	StartSample();
+	for(i = 0; i < n; ++i)
+	{
+		AvlRemove(avl, keys + i);
+	}
+	EndSample(&sample);
+	assert(AvlIsEmpty(avl));
+	PrintSample(dist, n, REMOVE, &sample, n);
+
+	AvlDestroy(avl);
+}
+
+static void PrintSample(const char *dist, size_t n, op_ty op,
+						const sample_ty *sample, size_t ops_num)
+{
+	int c = 0;
+
+	printf("%-10s %8lu %-8s %9.1f", dist, (unsigned long)n, op_names[op],
+											sample->ns / ops_num);
+	for(c = 0; c < COUNTERS_NUM; ++c)
+	{
+		if(!sample->is_counted[c])
+		{
+			printf(" %10s", "-");
+		}
+		else
+		{
+			printf(" %10.2f", sample->values[c] / ops_num);
+		}
+	}
+	printf("%s\n", sample->is_scaled ? " *" : "");
+	if(sample->is_scaled)
+	{
+		is_any_scaled = TRUE;
+	}
+}
+
+
+double Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void ShuffleLongs(long *arr, size_t n)
+{
+	size_t i = 0;
+	size_t j = 0;
+	long tmp = 0;
+
+	for(i = n - 1; 0 < i; --i)
+	{
+		j = (size_t)rand() % (i + 1);
+		tmp = arr[i];
+		arr[i] = arr[j];
+		arr[j] = tmp;
+	}
+}
+
+int CompareLongs(const void *avl_data, const void *user_data, void *params)
+{
+	long avl_long = *(const long *)avl_data;
+	long user_long = *(const long *)user_data;
+	(void)params;
+
+	return (avl_long > user_long) - (avl_long < user_long);
+}
+
+int CountLongs(void *data, void *params)
+{
+	(void)data;
+	++*(size_t *)params;
+
+	return 0;
+}
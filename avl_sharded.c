@@ -0,0 +1,608 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : range sharded avl for many writers  *
+ *                                                   *
+ *****************************************************/
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_mutex_t, pthread_cond_t, pthread_rwlock_t */
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memmove */
+
+#include "avl_sharded.h"
+
+/* while a shard is split, its writers wait on split_done without
+   the directory lock, so the split can take it to publish the halves */
+typedef struct shard
+{
+	pthread_mutex_t lock;
+	pthread_cond_t split_done;
+	bool_ty is_splitting;
+	avl_ty *avl;
+} shard_ty;
+
+/* splitters[i] is the smallest key of shards[i + 1]. the directory lock
+   is held for reading by every operation, and for writing by a split
+   only to put the new shard in the directory */
+struct avl_sharded
+{
+	pthread_rwlock_t directory_lock;
+	shard_ty **shards;
+	void **splitters;
+	size_t shards_num;
+	cmp_func cmp;
+	void *params;
+	dup_func dup;
+	size_t max_shard_size;
+};
+
+struct avl_sharded_cursor
+{
+	avl_sharded_ty *sharded;
+	void *current;
+};
+
+
+static shard_ty *CreateShard(cmp_func cmp, void *params)
+{
+	shard_ty *shard = (shard_ty *)malloc(sizeof(shard_ty));
+	if(NULL == shard)
+	{
+		return NULL;
+	}
+
+	shard->avl = AvlCreate(cmp, params);
+	if(NULL == shard->avl)
+	{
+		free(shard);
+		return NULL;
+	}
+	pthread_mutex_init(&shard->lock, NULL);
+	pthread_cond_init(&shard->split_done, NULL);
+	shard->is_splitting = FALSE;
+
+	return shard;
+}
+
+static void DestroyShard(shard_ty *shard)
+{
+	if(NULL == shard)
+	{
+		return;
+	}
+	pthread_mutex_destroy(&shard->lock);
+	pthread_cond_destroy(&shard->split_done);
+	AvlDestroy(shard->avl);
+	free(shard);
+}
+
+
+avl_sharded_ty *AvlShardedCreate(cmp_func cmp, void *params,
+                                 void **splitters, size_t splitters_num,
+                                 dup_func dup, size_t max_shard_size)
+{
+	avl_sharded_ty *sharded = NULL;
+	size_t i = 0;
+
+	assert(NULL != cmp);
+	assert(0 == splitters_num || NULL != splitters);
+
+	sharded = (avl_sharded_ty *)malloc(sizeof(avl_sharded_ty));
+	if(NULL == sharded)
+	{
+		return NULL;
+	}
+
+	sharded->shards_num = splitters_num + 1;
+	sharded->cmp = cmp;
+	sharded->params = params;
+	sharded->dup = dup;
+	sharded->max_shard_size = max_shard_size;
+	sharded->shards = (shard_ty **)calloc(sharded->shards_num,
+										  sizeof(shard_ty *));
+	sharded->splitters = (void **)calloc(sharded->shards_num,
+										 sizeof(void *));
+	if(NULL == sharded->shards || NULL == sharded->splitters)
+	{
+		free(sharded->shards);
+		free(sharded->splitters);
+		free(sharded);
+		return NULL;
+	}
+	pthread_rwlock_init(&sharded->directory_lock, NULL);
+
+	for(i = 0; i < sharded->shards_num; ++i)
+	{
+		sharded->shards[i] = CreateShard(cmp, params);
+		if(NULL == sharded->shards[i])
+		{
+			AvlShardedDestroy(sharded);
+			return NULL;
+		}
+	}
+
+	for(i = 0; i < splitters_num; ++i)
+	{
+		assert(0 == i || 0 > cmp(splitters[i - 1], splitters[i], params));
+		sharded->splitters[i] = (NULL == dup) ? splitters[i] :
+												dup(splitters[i], params);
+		if(NULL == sharded->splitters[i])
+		{
+			AvlShardedDestroy(sharded);
+			return NULL;
+		}
+	}
+
+	return sharded;
+}
+
+
+void AvlShardedDestroy(avl_sharded_ty *sharded)
+{
+	size_t i = 0;
+
+	assert(NULL != sharded);
+
+	for(i = 0; i < sharded->shards_num; ++i)
+	{
+		DestroyShard(sharded->shards[i]);
+		if(NULL != sharded->dup && i + 1 < sharded->shards_num)
+		{
+			free(sharded->splitters[i]);
+		}
+	}
+	pthread_rwlock_destroy(&sharded->directory_lock);
+	free(sharded->shards);
+	free(sharded->splitters);
+	free(sharded);
+}
+
+
+/* index of the shard of data, the directory lock must be held */
+static size_t Route(const avl_sharded_ty *sharded, const void *data)
+{
+	size_t lo = 0;
+	size_t hi = sharded->shards_num - 1;
+	size_t mid = 0;
+
+	/* count the splitters that are not bigger than data */
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if(0 >= sharded->cmp(sharded->splitters[mid], data, sharded->params))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+
+/* lock the shard of data for a change, with the directory lock held
+   for reading. a shard that is being split is waited for */
+static shard_ty *LockForWrite(avl_sharded_ty *sharded, const void *data)
+{
+	shard_ty *shard = NULL;
+
+	for(;;)
+	{
+		pthread_rwlock_rdlock(&sharded->directory_lock);
+		shard = sharded->shards[Route(sharded, data)];
+		pthread_mutex_lock(&shard->lock);
+		if(!shard->is_splitting)
+		{
+			return shard;
+		}
+
+		/* data may be in the new shard after the split */
+		pthread_rwlock_unlock(&sharded->directory_lock);
+		while(shard->is_splitting)
+		{
+			pthread_cond_wait(&shard->split_done, &shard->lock);
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+/* the elements of avl in order, n of them */
+static void **CollectShard(avl_ty *avl, size_t n)
+{
+	avl_cursor_ty *cursor = AvlCursorCreate(avl);
+	void **elements = (void **)malloc(n * sizeof(void *) + 1);
+	void *data = NULL;
+	size_t i = 0;
+
+	if(NULL == cursor || NULL == elements)
+	{
+		if(NULL != cursor)
+		{
+			AvlCursorDestroy(cursor);
+		}
+		free(elements);
+		return NULL;
+	}
+
+	for(data = AvlCursorFirst(cursor); NULL != data;
+									   data = AvlCursorNext(cursor))
+	{
+		assert(i < n);
+		elements[i] = data;
+		++i;
+	}
+	AvlCursorDestroy(cursor);
+	assert(i == n);
+
+	return elements;
+}
+
+/* index of the first element of the upper half: near the middle, after
+   the elements equal to it, and never 0 so both halves have elements.
+   n if all the elements are equal */
+static size_t FindMedian(const avl_sharded_ty *sharded, void **elements,
+																size_t n)
+{
+	size_t mid = n / 2;
+
+	while(0 < mid && 0 == sharded->cmp(elements[mid - 1], elements[mid],
+														sharded->params))
+	{
+		--mid;
+	}
+	while(mid < n && (0 == mid || 0 == sharded->cmp(elements[0],
+										elements[mid], sharded->params)))
+	{
+		++mid;
+	}
+
+	return mid;
+}
+
+/* build the two halves of the shard into lower and upper, and the dup
+   of the first key of upper. the shard lock must be held */
+static status_ty BuildHalves(avl_sharded_ty *sharded, shard_ty *shard,
+							 avl_ty **lower, shard_ty **upper, void **median)
+{
+	size_t n = AvlSize(shard->avl);
+	void **elements = CollectShard(shard->avl, n);
+	size_t mid = 0;
+
+	if(NULL == elements)
+	{
+		return FAIL;
+	}
+	mid = FindMedian(sharded, elements, n);
+	if(n == mid)
+	{
+		free(elements);
+		return FAIL;
+	}
+
+	*lower = AvlCreate(sharded->cmp, sharded->params);
+	*upper = CreateShard(sharded->cmp, sharded->params);
+	*median = sharded->dup(elements[mid], sharded->params);
+	if(NULL == *lower || NULL == *upper || NULL == *median ||
+	   SUCCESS != AvlBulkLoad(*lower, elements, mid) ||
+	   SUCCESS != AvlBulkLoad((*upper)->avl, elements + mid, n - mid))
+	{
+		if(NULL != *lower)
+		{
+			AvlDestroy(*lower);
+		}
+		DestroyShard(*upper);
+		free(*median);
+		free(elements);
+		return FAIL;
+	}
+	free(elements);
+
+	return SUCCESS;
+}
+
+/* put upper after shard in the directory, the directory lock must be
+   held for writing */
+static status_ty AddShard(avl_sharded_ty *sharded, shard_ty *upper,
+											  void *median)
+{
+	shard_ty **shards = NULL;
+	void **splitters = NULL;
+	size_t index = Route(sharded, median);
+
+	shards = (shard_ty **)realloc(sharded->shards,
+						(sharded->shards_num + 1) * sizeof(shard_ty *));
+	if(NULL == shards)
+	{
+		return FAIL;
+	}
+	sharded->shards = shards;
+	splitters = (void **)realloc(sharded->splitters,
+						(sharded->shards_num + 1) * sizeof(void *));
+	if(NULL == splitters)
+	{
+		return FAIL;
+	}
+	sharded->splitters = splitters;
+
+	memmove(sharded->shards + index + 2, sharded->shards + index + 1,
+			(sharded->shards_num - index - 1) * sizeof(shard_ty *));
+	memmove(sharded->splitters + index + 1, sharded->splitters + index,
+			(sharded->shards_num - index - 1) * sizeof(void *));
+	sharded->shards[index + 1] = upper;
+	sharded->splitters[index] = median;
+	++sharded->shards_num;
+
+	return SUCCESS;
+}
+
+/* split the shard of data at its median. the halves are built in O(n)
+   under the shard lock while the other shards go on, then the
+   directory lock is taken for writing only to add the new shard */
+static void SplitIfLarge(avl_sharded_ty *sharded, void *data)
+{
+	shard_ty *shard = NULL;
+	shard_ty *upper = NULL;
+	avl_ty *lower = NULL;
+	avl_ty *old_avl = NULL;
+	void *median = NULL;
+	status_ty status = SUCCESS;
+
+	pthread_rwlock_rdlock(&sharded->directory_lock);
+	shard = sharded->shards[Route(sharded, data)];
+	pthread_mutex_lock(&shard->lock);
+	if(shard->is_splitting ||
+	   AvlSize(shard->avl) <= sharded->max_shard_size)
+	{
+		pthread_mutex_unlock(&shard->lock);
+		pthread_rwlock_unlock(&sharded->directory_lock);
+		return;
+	}
+	status = BuildHalves(sharded, shard, &lower, &upper, &median);
+	shard->is_splitting = (SUCCESS == status);
+	pthread_mutex_unlock(&shard->lock);
+	pthread_rwlock_unlock(&sharded->directory_lock);
+	if(SUCCESS != status)
+	{
+		return;
+	}
+
+	/* the shard does not change until is_splitting is cleared */
+	pthread_rwlock_wrlock(&sharded->directory_lock);
+	status = AddShard(sharded, upper, median);
+	pthread_mutex_lock(&shard->lock);
+	if(SUCCESS == status)
+	{
+		old_avl = shard->avl;
+		shard->avl = lower;
+	}
+	shard->is_splitting = FALSE;
+	pthread_cond_broadcast(&shard->split_done);
+	pthread_mutex_unlock(&shard->lock);
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	if(SUCCESS != status)
+	{
+		AvlDestroy(lower);
+		DestroyShard(upper);
+		free(median);
+		return;
+	}
+	AvlDestroy(old_avl);
+}
+
+
+status_ty AvlShardedInsert(avl_sharded_ty *sharded, void *data)
+{
+	shard_ty *shard = NULL;
+	status_ty status = SUCCESS;
+	int is_large = 0;
+
+	assert(NULL != sharded);
+
+	shard = LockForWrite(sharded, data);
+	status = AvlInsert(shard->avl, data);
+	is_large = AvlSize(shard->avl) > sharded->max_shard_size;
+	pthread_mutex_unlock(&shard->lock);
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	if(is_large && NULL != sharded->dup)
+	{
+		SplitIfLarge(sharded, data);
+	}
+
+	return status;
+}
+
+
+status_ty AvlShardedRemove(avl_sharded_ty *sharded, void *data)
+{
+	shard_ty *shard = NULL;
+	status_ty status = SUCCESS;
+
+	assert(NULL != sharded);
+
+	shard = LockForWrite(sharded, data);
+	status = AvlRemove(shard->avl, data);
+	pthread_mutex_unlock(&shard->lock);
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	return status;
+}
+
+
+status_ty AvlShardedFind(avl_sharded_ty *sharded, void *data)
+{
+	shard_ty *shard = NULL;
+	status_ty status = SUCCESS;
+
+	assert(NULL != sharded);
+
+	pthread_rwlock_rdlock(&sharded->directory_lock);
+	shard = sharded->shards[Route(sharded, data)];
+	pthread_mutex_lock(&shard->lock);
+	status = AvlFind(shard->avl, data);
+	pthread_mutex_unlock(&shard->lock);
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	return status;
+}
+
+
+size_t AvlShardedSize(avl_sharded_ty *sharded)
+{
+	size_t size = 0;
+	size_t i = 0;
+
+	assert(NULL != sharded);
+
+	pthread_rwlock_rdlock(&sharded->directory_lock);
+	for(i = 0; i < sharded->shards_num; ++i)
+	{
+		pthread_mutex_lock(&sharded->shards[i]->lock);
+		size += AvlSize(sharded->shards[i]->avl);
+		pthread_mutex_unlock(&sharded->shards[i]->lock);
+	}
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	return size;
+}
+
+
+size_t AvlShardedShardsNum(avl_sharded_ty *sharded)
+{
+	size_t shards_num = 0;
+
+	assert(NULL != sharded);
+
+	pthread_rwlock_rdlock(&sharded->directory_lock);
+	shards_num = sharded->shards_num;
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	return shards_num;
+}
+
+
+status_ty AvlShardedForEach(avl_sharded_ty *sharded, action_func action,
+                                                          void *params)
+{
+	status_ty status = SUCCESS;
+	size_t i = 0;
+
+	assert(NULL != sharded);
+	assert(NULL != action);
+
+	pthread_rwlock_rdlock(&sharded->directory_lock);
+	for(i = 0; i < sharded->shards_num && SUCCESS == status; ++i)
+	{
+		pthread_mutex_lock(&sharded->shards[i]->lock);
+		status = AvlForEach(sharded->shards[i]->avl, action, params, INORDER);
+		pthread_mutex_unlock(&sharded->shards[i]->lock);
+	}
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	return status;
+}
+
+
+/*--------------- cursors ------------*/
+
+avl_sharded_cursor_ty *AvlShardedCursorCreate(avl_sharded_ty *sharded)
+{
+	avl_sharded_cursor_ty *cursor = NULL;
+
+	assert(NULL != sharded);
+
+	cursor = (avl_sharded_cursor_ty *)malloc(sizeof(avl_sharded_cursor_ty));
+	if(NULL == cursor)
+	{
+		return NULL;
+	}
+
+	cursor->sharded = sharded;
+	cursor->current = NULL;
+
+	return cursor;
+}
+
+
+void AvlShardedCursorDestroy(avl_sharded_cursor_ty *cursor)
+{
+	free(cursor);
+}
+
+
+/* the first element not smaller than data (or bigger than data when
+   is_after) from the shard of data on, the smallest if data is NULL */
+static void *FindFrom(avl_sharded_ty *sharded, void *data, int is_after)
+{
+	shard_ty *shard = NULL;
+	avl_cursor_ty *cursor = NULL;
+	void *found = NULL;
+	size_t first = 0;
+	size_t i = 0;
+
+	pthread_rwlock_rdlock(&sharded->directory_lock);
+	first = (NULL == data) ? 0 : Route(sharded, data);
+	for(i = first; NULL == found && i < sharded->shards_num; ++i)
+	{
+		shard = sharded->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		cursor = AvlCursorCreate(shard->avl);
+		if(NULL != cursor)
+		{
+			/* the shards after the shard of data hold bigger keys only */
+			found = (NULL == data || i != first) ? AvlCursorFirst(cursor) :
+												   AvlCursorSeek(cursor, data);
+			while(is_after && NULL != found && i == first &&
+				  0 == sharded->cmp(found, data, sharded->params))
+			{
+				found = AvlCursorNext(cursor);
+			}
+			AvlCursorDestroy(cursor);
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+	pthread_rwlock_unlock(&sharded->directory_lock);
+
+	return found;
+}
+
+
+void *AvlShardedCursorFirst(avl_sharded_cursor_ty *cursor)
+{
+	assert(NULL != cursor);
+
+	cursor->current = FindFrom(cursor->sharded, NULL, 0);
+
+	return cursor->current;
+}
+
+
+void *AvlShardedCursorSeek(avl_sharded_cursor_ty *cursor, void *data)
+{
+	assert(NULL != cursor);
+	assert(NULL != data);
+
+	cursor->current = FindFrom(cursor->sharded, data, 0);
+
+	return cursor->current;
+}
+
+
+void *AvlShardedCursorNext(avl_sharded_cursor_ty *cursor)
+{
+	assert(NULL != cursor);
+
+	if(NULL != cursor->current)
+	{
+		cursor->current = FindFrom(cursor->sharded, cursor->current, 1);
+	}
+
+	return cursor->current;
+}
@@ -0,0 +1,148 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : range sharded avl for many writers  *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_SHARDED_H__
+#define __ILRD_OL127_128_AVL_SHARDED_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+
+typedef struct avl_sharded avl_sharded_ty;
+typedef struct avl_sharded_cursor avl_sharded_cursor_ty;
+
+/* return a malloced copy of the key of data that cmp accepts on
+   both sides, freed with free */
+typedef void *(*dup_func)(const void *data, void *params);
+
+/*
+DESCRIPTION : create a new avl split by key ranges into shards, each
+with its own lock. shard i holds the elements in
+[splitters[i - 1], splitters[i]). when dup is not NULL, a shard that
+grows over max_shard_size is split in two at its median, and dup
+makes the new splitter. without dup the shards are never split and
+max_shard_size is not used. a split locks only the shard it splits,
+whose writers wait for it.
+PARAMETERS : pointer compare function, params to compare and dup
+functions, sorted splitters and their num, dup function or NULL,
+max shard size.
+RETURN : pointer to the new tree.
+COMPLEXITY : time - O(splitters_num), space - O(splitters_num)
+*/
+avl_sharded_ty *AvlShardedCreate(cmp_func cmp, void *params,
+                                 void **splitters, size_t splitters_num,
+                                 dup_func dup, size_t max_shard_size);
+
+/*
+DESCRIPTION : destroy exist sharded tree
+PARAMETERS : pointer to sharded tree
+RETURN : void
+COMPLEXITY : time - O(n), space - O(1)
+*/
+void AvlShardedDestroy(avl_sharded_ty *sharded);
+
+/*
+DESCRIPTION : insert new element, locking only its shard.
+thread safe.
+PARAMETERS : pointer to sharded tree, pointer to data
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlShardedInsert(avl_sharded_ty *sharded, void *data);
+
+/*
+DESCRIPTION : remove element, locking only its shard.
+thread safe.
+PARAMETERS : pointer to sharded tree, pointer to data
+RETURN : SUCCESS, or FAIL if memory ran out copying nodes
+shared with a clone. the element is not removed then.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlShardedRemove(avl_sharded_ty *sharded, void *data);
+
+/*
+DESCRIPTION : check if data exist, locking only its shard.
+thread safe.
+PARAMETERS : pointer to sharded tree, pointer to data
+RETURN : SUCCESS if found, else FAIL.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlShardedFind(avl_sharded_ty *sharded, void *data);
+
+/*
+DESCRIPTION : return the num of elements in all shards
+PARAMETERS : pointer to sharded tree
+RETURN : num of elements(size_t)
+COMPLEXITY : time - O(shards), space - O(1)
+*/
+size_t AvlShardedSize(avl_sharded_ty *sharded);
+
+/*
+DESCRIPTION : return the current num of shards
+PARAMETERS : pointer to sharded tree
+RETURN : num of shards(size_t)
+COMPLEXITY : time - O(1), space - O(1)
+*/
+size_t AvlShardedShardsNum(avl_sharded_ty *sharded);
+
+/*
+DESCRIPTION : executes a function on each element in key order,
+one shard at a time under its lock. the function must not change
+the sharded tree. stops when the function returns non zero.
+PARAMETERS : pointer to sharded tree, pointer to action function,
+pointer to params of action function.
+RETURN : SUCCESS, or FAIL if stopped by the action function.
+COMPLEXITY : time - O(n), space - O(logn)
+*/
+status_ty AvlShardedForEach(avl_sharded_ty *sharded, action_func action,
+                                                          void *params);
+
+/*
+DESCRIPTION : create an ordered cursor over all shards. the cursor
+keeps the last element only and finds the next one by key, so it
+stays valid while other threads change the tree. equal elements
+after the current one are skipped.
+PARAMETERS : pointer to sharded tree
+RETURN : pointer to the new cursor, not positioned.
+COMPLEXITY : time - O(1), space - O(1)
+*/
+avl_sharded_cursor_ty *AvlShardedCursorCreate(avl_sharded_ty *sharded);
+
+/*
+DESCRIPTION : destroy a sharded cursor
+PARAMETERS : pointer to cursor
+RETURN : void
+COMPLEXITY : time - O(1), space - O(1)
+*/
+void AvlShardedCursorDestroy(avl_sharded_cursor_ty *cursor);
+
+/*
+DESCRIPTION : move the cursor to the smallest element
+PARAMETERS : pointer to cursor
+RETURN : the element, or NULL if the tree is empty.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+void *AvlShardedCursorFirst(avl_sharded_cursor_ty *cursor);
+
+/*
+DESCRIPTION : move the cursor to the first element that
+is not smaller than data
+PARAMETERS : pointer to cursor, pointer to data
+RETURN : the element, or NULL if there is none.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+void *AvlShardedCursorSeek(avl_sharded_cursor_ty *cursor, void *data);
+
+/*
+DESCRIPTION : move the cursor to the next element
+PARAMETERS : pointer to cursor
+RETURN : the element, or NULL at the end.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+void *AvlShardedCursorNext(avl_sharded_cursor_ty *cursor);
+
+#endif /* __ILRD_OL127_128_AVL_SHARDED_H__ */
@@ -0,0 +1,275 @@
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_create, pthread_join */
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* malloc, rand */
+#include "avl_sharded.h"
+
+#define THREADS_NUM 4
+#define PER_THREAD 5000
+
+
+void AvlShardedBasicTest(void);
+void AvlShardedCursorTest(void);
+void AvlShardedSplitTest(void);
+void AvlShardedThreadsTest(void);
+
+int CompareInts(const void *avl_data, const void *user_data, void *params);
+void *DupInt(const void *data, void *params);
+int CheckOrder(void *avl_data, void *params);
+void *InsertRange(void *arg);
+
+
+int main(void)
+{
+	AvlShardedBasicTest();
+	AvlShardedCursorTest();
+	AvlShardedSplitTest();
+	AvlShardedThreadsTest();
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlShardedBasicTest(void)
+{
+	static int splitters[] = {100, 200, 300};
+	void *splitters_ptrs[] = {splitters, splitters + 1, splitters + 2};
+	static int arr[400];
+	int last = -1;
+	int i = 0;
+	avl_sharded_ty *sharded = AvlShardedCreate(&CompareInts, NULL,
+											   splitters_ptrs, 3, NULL, 0);
+	assert(NULL != sharded);
+	assert(4 == AvlShardedShardsNum(sharded));
+	assert(0 == AvlShardedSize(sharded));
+
+	for(i = 0; i < 400; ++i)
+	{
+		arr[i] = (i * 7) % 400;
+		assert(SUCCESS == AvlShardedInsert(sharded, arr + i));
+	}
+	assert(400 == AvlShardedSize(sharded));
+
+	for(i = 0; i < 400; ++i)
+	{
+		assert(SUCCESS == AvlShardedFind(sharded, arr + i));
+	}
+	i = 400;
+	assert(FAIL == AvlShardedFind(sharded, &i));
+
+	assert(SUCCESS == AvlShardedForEach(sharded, &CheckOrder, &last));
+	assert(399 == last);
+
+	for(i = 0; i < 400; i += 2)
+	{
+		assert(SUCCESS == AvlShardedRemove(sharded, arr + i));
+	}
+	assert(200 == AvlShardedSize(sharded));
+	for(i = 0; i < 400; ++i)
+	{
+		assert((i % 2 ? SUCCESS : FAIL) == AvlShardedFind(sharded, arr + i));
+	}
+
+	AvlShardedDestroy(sharded);
+}
+
+void AvlShardedCursorTest(void)
+{
+	static int splitters[] = {100, 200, 300};
+	void *splitters_ptrs[] = {splitters, splitters + 1, splitters + 2};
+	static int arr[200];
+	avl_sharded_cursor_ty *cursor = NULL;
+	int key = 0;
+	int expected = 0;
+	int *data = NULL;
+	int i = 0;
+	avl_sharded_ty *sharded = AvlShardedCreate(&CompareInts, NULL,
+											   splitters_ptrs, 3, NULL, 0);
+	assert(NULL != sharded);
+
+	cursor = AvlShardedCursorCreate(sharded);
+	assert(NULL != cursor);
+	assert(NULL == AvlShardedCursorFirst(cursor));
+
+	/* even keys only, and the shard of 100..199 stays empty */
+	for(i = 0; i < 200; ++i)
+	{
+		arr[i] = i * 2;
+		if(100 > arr[i] || 200 <= arr[i])
+		{
+			assert(SUCCESS == AvlShardedInsert(sharded, arr + i));
+		}
+	}
+
+	expected = 0;
+	for(data = AvlShardedCursorFirst(cursor); NULL != data;
+									  data = AvlShardedCursorNext(cursor))
+	{
+		assert(expected == *data);
+		expected += (98 == expected) ? 102 : 2;
+	}
+	assert(400 == expected);
+
+	key = 99;
+	data = AvlShardedCursorSeek(cursor, &key);
+	assert(NULL != data && 200 == *data);
+	key = 301;
+	data = AvlShardedCursorSeek(cursor, &key);
+	assert(NULL != data && 302 == *data);
+	data = AvlShardedCursorNext(cursor);
+	assert(NULL != data && 304 == *data);
+	key = 399;
+	assert(NULL == AvlShardedCursorSeek(cursor, &key));
+	assert(NULL == AvlShardedCursorNext(cursor));
+
+	/* the cursor survives removing its current element */
+	key = 250;
+	data = AvlShardedCursorSeek(cursor, &key);
+	assert(SUCCESS == AvlShardedRemove(sharded, data));
+	data = AvlShardedCursorNext(cursor);
+	assert(NULL != data && 252 == *data);
+
+	AvlShardedCursorDestroy(cursor);
+	AvlShardedDestroy(sharded);
+}
+
+void AvlShardedSplitTest(void)
+{
+	static int arr[2000];
+	int last = -1;
+	int i = 0;
+	avl_sharded_ty *sharded = AvlShardedCreate(&CompareInts, NULL,
+											   NULL, 0, &DupInt, 64);
+	assert(NULL != sharded);
+	assert(1 == AvlShardedShardsNum(sharded));
+
+	for(i = 0; i < 2000; ++i)
+	{
+		arr[i] = (i * 13) % 2000;
+		assert(SUCCESS == AvlShardedInsert(sharded, arr + i));
+	}
+	assert(2000 == AvlShardedSize(sharded));
+	/* every shard holds between 32 and 64 elements */
+	assert(2000 / 64 <= AvlShardedShardsNum(sharded));
+	assert(2000 / 32 >= AvlShardedShardsNum(sharded));
+
+	for(i = 0; i < 2000; ++i)
+	{
+		assert(SUCCESS == AvlShardedFind(sharded, arr + i));
+	}
+	assert(SUCCESS == AvlShardedForEach(sharded, &CheckOrder, &last));
+	assert(1999 == last);
+	AvlShardedDestroy(sharded);
+
+	/* equal elements stay in one shard */
+	sharded = AvlShardedCreate(&CompareInts, NULL, NULL, 0, &DupInt, 8);
+	assert(NULL != sharded);
+	for(i = 0; i < 20; ++i)
+	{
+		assert(SUCCESS == AvlShardedInsert(sharded, arr));
+	}
+	assert(1 == AvlShardedShardsNum(sharded));
+	for(i = 1; i < 21; ++i)
+	{
+		assert(SUCCESS == AvlShardedInsert(sharded, arr + i));
+	}
+	assert(40 == AvlShardedSize(sharded));
+	assert(1 < AvlShardedShardsNum(sharded));
+	for(i = 0; i < 21; ++i)
+	{
+		assert(SUCCESS == AvlShardedFind(sharded, arr + i));
+	}
+	AvlShardedDestroy(sharded);
+}
+
+typedef struct
+{
+	avl_sharded_ty *sharded;
+	int *arr;
+} thread_args_ty;
+
+void AvlShardedThreadsTest(void)
+{
+	static int arr[THREADS_NUM * PER_THREAD];
+	pthread_t threads[THREADS_NUM];
+	thread_args_ty args[THREADS_NUM];
+	int last = -1;
+	int i = 0;
+	avl_sharded_ty *sharded = AvlShardedCreate(&CompareInts, NULL,
+											   NULL, 0, &DupInt, 256);
+	assert(NULL != sharded);
+
+	/* interleaved keys so every thread hits every shard */
+	for(i = 0; i < THREADS_NUM * PER_THREAD; ++i)
+	{
+		arr[i] = (i % PER_THREAD) * THREADS_NUM + i / PER_THREAD;
+	}
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		args[i].sharded = sharded;
+		args[i].arr = arr + i * PER_THREAD;
+		assert(0 == pthread_create(threads + i, NULL, &InsertRange, args + i));
+	}
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	assert(THREADS_NUM * PER_THREAD == AvlShardedSize(sharded));
+	assert(1 < AvlShardedShardsNum(sharded));
+	for(i = 0; i < THREADS_NUM * PER_THREAD; ++i)
+	{
+		assert(SUCCESS == AvlShardedFind(sharded, arr + i));
+	}
+	assert(SUCCESS == AvlShardedForEach(sharded, &CheckOrder, &last));
+	assert(THREADS_NUM * PER_THREAD - 1 == last);
+
+	AvlShardedDestroy(sharded);
+}
+
+
+int CompareInts(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+	return *(const int *)avl_data - *(const int *)user_data;
+}
+
+void *DupInt(const void *data, void *params)
+{
+	int *copy = (int *)malloc(sizeof(int));
+	(void)params;
+
+	if(NULL != copy)
+	{
+		*copy = *(const int *)data;
+	}
+
+	return copy;
+}
+
+int CheckOrder(void *avl_data, void *params)
+{
+	int *last = (int *)params;
+
+	assert(*last < *(int *)avl_data);
+	*last = *(int *)avl_data;
+	return 0;
+}
+
+void *InsertRange(void *arg)
+{
+	thread_args_ty *args = (thread_args_ty *)arg;
+	int i = 0;
+
+	for(i = 0; i < PER_THREAD; ++i)
+	{
+		if(SUCCESS != AvlShardedInsert(args->sharded, args->arr + i))
+		{
+			abort();
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,533 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : save and load avl trees to files    *
+ *                                                   *
+ *****************************************************/
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h> /* assert */
+#include <fcntl.h> /* open */
+#include <pthread.h> /* pthread_create, pthread_join */
+#include <stdio.h> /* FILE, fopen, fwrite, fread, rename */
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* memcmp, strlen, strcpy, strcat, strrchr */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* fsync, close */
+
+#include "avl_snapshot.h"
+
+#define MAGIC "AVS1"
+#define MAGIC_SIZE 4
+#define LEN_SIZE 4
+#define COUNT_SIZE 8
+#define CRC_SIZE 4
+#define SCRATCH_INIT 64
+#define CRC_POLY 0xEDB88320UL
+
+/* a growing buffer for one encoded element */
+typedef struct
+{
+	unsigned char *data;
+	size_t capacity;
+} scratch_ty;
+
+/* the state of AvlSnapshotSave while it walks avl */
+typedef struct
+{
+	FILE *file;
+	encode_func encode;
+	void *params;
+	scratch_ty scratch;
+	unsigned long crc;
+	size_t bytes;
+} save_ty;
+
+/* a snapshot of a clone of the avl, written by thread. is_done is
+   set by thread when status and stats are final */
+struct avl_checkpoint
+{
+	avl_ty *clone;
+	char *path;
+	encode_func encode;
+	void *params;
+	status_ty status;
+	avl_checkpoint_stats_ty stats;
+	int is_done;
+	pthread_t thread;
+};
+
+
+/*--------------- bytes ------------*/
+
+unsigned long AvlChecksum(unsigned long crc, const void *buf, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)buf;
+	size_t i = 0;
+	int bit = 0;
+
+	crc = ~crc & 0xFFFFFFFFUL;
+	for(i = 0; i < size; ++i)
+	{
+		crc ^= bytes[i];
+		for(bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc >> 1) ^ (CRC_POLY & (0 - (crc & 1)));
+		}
+	}
+
+	return ~crc & 0xFFFFFFFFUL;
+}
+
+/* little endian, so the files do not depend on the machine */
+static void PutUint(unsigned char *buf, unsigned long value, size_t bytes)
+{
+	size_t i = 0;
+
+	for(i = 0; i < bytes; ++i)
+	{
+		buf[i] = (unsigned char)(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+static unsigned long GetUint(const unsigned char *buf, size_t bytes)
+{
+	unsigned long value = 0;
+
+	while(0 < bytes)
+	{
+		--bytes;
+		value = (value << 8) | buf[bytes];
+	}
+
+	return value;
+}
+
+static status_ty Reserve(scratch_ty *scratch, size_t size)
+{
+	unsigned char *data = NULL;
+	size_t capacity = (0 == scratch->capacity) ? SCRATCH_INIT :
+												 scratch->capacity;
+
+	if(size <= scratch->capacity)
+	{
+		return SUCCESS;
+	}
+	while(capacity < size)
+	{
+		capacity *= 2;
+	}
+
+	data = (unsigned char *)realloc(scratch->data, capacity);
+	if(NULL == data)
+	{
+		return FAIL;
+	}
+	scratch->data = data;
+	scratch->capacity = capacity;
+
+	return SUCCESS;
+}
+
+
+/*--------------- save ------------*/
+
+static status_ty WriteBytes(save_ty *save, const void *buf, size_t size)
+{
+	save->crc = AvlChecksum(save->crc, buf, size);
+	save->bytes += size;
+
+	return (size == fwrite(buf, 1, size, save->file)) ? SUCCESS : FAIL;
+}
+
+static status_ty WriteElement(save_ty *save, const void *data)
+{
+	unsigned char len[LEN_SIZE];
+	size_t size = save->encode(data, save->scratch.data,
+							   save->scratch.capacity, save->params);
+
+	if(size > save->scratch.capacity)
+	{
+		if(SUCCESS != Reserve(&save->scratch, size))
+		{
+			return FAIL;
+		}
+		save->encode(data, save->scratch.data, size, save->params);
+	}
+	PutUint(len, size, LEN_SIZE);
+
+	if(SUCCESS != WriteBytes(save, len, LEN_SIZE))
+	{
+		return FAIL;
+	}
+	return WriteBytes(save, save->scratch.data, size);
+}
+
+/* write the elements of avl in order, each occurrence of a multiset */
+static status_ty WriteElements(save_ty *save, avl_ty *avl)
+{
+	avl_cursor_ty *cursor = AvlCursorCreate(avl);
+	status_ty status = SUCCESS;
+	void *data = NULL;
+	size_t count = 0;
+
+	if(NULL == cursor)
+	{
+		return FAIL;
+	}
+
+	for(data = AvlCursorFirst(cursor); NULL != data && SUCCESS == status;
+										  data = AvlCursorNext(cursor))
+	{
+		for(count = AvlCount(avl, data); 0 < count && SUCCESS == status;
+																	--count)
+		{
+			status = WriteElement(save, data);
+		}
+	}
+	AvlCursorDestroy(cursor);
+
+	return status;
+}
+
+/* make the rename of a file in the directory of path durable */
+static status_ty SyncDirectory(const char *path)
+{
+	char *dir = (char *)malloc(strlen(path) + 2);
+	char *slash = NULL;
+	status_ty status = SUCCESS;
+	int fd = -1;
+
+	if(NULL == dir)
+	{
+		return FAIL;
+	}
+	strcpy(dir, path);
+	slash = strrchr(dir, '/');
+	if(NULL == slash)
+	{
+		strcpy(dir, ".");
+	}
+	else
+	{
+		slash[1] = '\0';
+	}
+
+	fd = open(dir, O_RDONLY);
+	if(0 > fd || 0 != fsync(fd))
+	{
+		status = FAIL;
+	}
+	if(0 <= fd)
+	{
+		close(fd);
+	}
+	free(dir);
+
+	return status;
+}
+
+/* the snapshot of avl, and the num of bytes it took */
+static status_ty SaveTree(avl_ty *avl, const char *path,
+						  encode_func encode, void *params, size_t *bytes)
+{
+	unsigned char header[COUNT_SIZE];
+	unsigned char crc[CRC_SIZE];
+	char *tmp_path = NULL;
+	status_ty status = SUCCESS;
+	save_ty save;
+
+	tmp_path = (char *)malloc(strlen(path) + sizeof(".tmp"));
+	if(NULL == tmp_path)
+	{
+		return FAIL;
+	}
+	strcpy(tmp_path, path);
+	strcat(tmp_path, ".tmp");
+
+	save.encode = encode;
+	save.params = params;
+	save.scratch.data = NULL;
+	save.scratch.capacity = 0;
+	save.crc = 0;
+	save.bytes = CRC_SIZE;
+	save.file = fopen(tmp_path, "wb");
+	if(NULL == save.file)
+	{
+		free(tmp_path);
+		return FAIL;
+	}
+
+	PutUint(header, AvlSize(avl), COUNT_SIZE);
+	status |= WriteBytes(&save, MAGIC, MAGIC_SIZE);
+	status |= WriteBytes(&save, header, COUNT_SIZE);
+	if(SUCCESS == status)
+	{
+		status = WriteElements(&save, avl);
+	}
+	PutUint(crc, save.crc, CRC_SIZE);
+	if(SUCCESS == status && CRC_SIZE != fwrite(crc, 1, CRC_SIZE, save.file))
+	{
+		status = FAIL;
+	}
+	if(SUCCESS == status &&
+	   (0 != fflush(save.file) || 0 != fsync(fileno(save.file))))
+	{
+		status = FAIL;
+	}
+	if(0 != fclose(save.file))
+	{
+		status = FAIL;
+	}
+
+	if(SUCCESS == status && 0 != rename(tmp_path, path))
+	{
+		status = FAIL;
+	}
+	if(SUCCESS == status)
+	{
+		status = SyncDirectory(path);
+	}
+	else
+	{
+		remove(tmp_path);
+	}
+
+	free(save.scratch.data);
+	free(tmp_path);
+	*bytes = save.bytes;
+
+	return status;
+}
+
+status_ty AvlSnapshotSave(avl_ty *avl, const char *path,
+                          encode_func encode, void *params)
+{
+	size_t bytes = 0;
+
+	assert(NULL != avl);
+	assert(NULL != path);
+	assert(NULL != encode);
+
+	return SaveTree(avl, path, encode, params, &bytes);
+}
+
+
+/*--------------- checkpoint ------------*/
+
+static double Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void *CheckpointLoop(void *arg)
+{
+	avl_checkpoint_ty *checkpoint = (avl_checkpoint_ty *)arg;
+	double start = Now();
+
+	checkpoint->stats.elements = AvlSize(checkpoint->clone);
+	checkpoint->status = SaveTree(checkpoint->clone, checkpoint->path,
+								  checkpoint->encode, checkpoint->params,
+								  &checkpoint->stats.bytes);
+	/* the nodes the avl did not change since are freed here */
+	AvlDestroy(checkpoint->clone);
+	checkpoint->clone = NULL;
+	checkpoint->stats.write_seconds = Now() - start;
+
+	__atomic_store_n(&checkpoint->is_done, 1, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+avl_checkpoint_ty *AvlCheckpointAsync(avl_ty *avl, const char *path,
+                                      encode_func encode, void *params)
+{
+	avl_checkpoint_ty *checkpoint = NULL;
+	double start = Now();
+
+	assert(NULL != avl);
+	assert(NULL != path);
+	assert(NULL != encode);
+
+	checkpoint = (avl_checkpoint_ty *)malloc(sizeof(avl_checkpoint_ty) +
+											 strlen(path) + 1);
+	if(NULL == checkpoint)
+	{
+		return NULL;
+	}
+	checkpoint->path = (char *)(checkpoint + 1);
+	strcpy(checkpoint->path, path);
+	checkpoint->encode = encode;
+	checkpoint->params = params;
+	checkpoint->status = FAIL;
+	checkpoint->stats.elements = 0;
+	checkpoint->stats.bytes = 0;
+	checkpoint->stats.write_seconds = 0;
+	checkpoint->is_done = 0;
+
+	checkpoint->clone = AvlClone(avl);
+	if(NULL == checkpoint->clone)
+	{
+		free(checkpoint);
+		return NULL;
+	}
+	if(0 != pthread_create(&checkpoint->thread, NULL, &CheckpointLoop,
+														checkpoint))
+	{
+		AvlDestroy(checkpoint->clone);
+		free(checkpoint);
+		return NULL;
+	}
+	checkpoint->stats.pause_seconds = Now() - start;
+
+	return checkpoint;
+}
+
+bool_ty AvlCheckpointIsDone(const avl_checkpoint_ty *checkpoint)
+{
+	assert(NULL != checkpoint);
+
+	return __atomic_load_n(&checkpoint->is_done, __ATOMIC_ACQUIRE) ? TRUE :
+																	 FALSE;
+}
+
+status_ty AvlCheckpointWait(avl_checkpoint_ty *checkpoint,
+                            avl_checkpoint_stats_ty *stats)
+{
+	status_ty status = FAIL;
+
+	assert(NULL != checkpoint);
+
+	pthread_join(checkpoint->thread, NULL);
+	status = checkpoint->status;
+	if(NULL != stats)
+	{
+		*stats = checkpoint->stats;
+	}
+	free(checkpoint);
+
+	return status;
+}
+
+
+/*--------------- load ------------*/
+
+static status_ty ReadBytes(FILE *file, void *buf, size_t size,
+										 unsigned long *crc)
+{
+	if(size != fread(buf, 1, size, file))
+	{
+		return FAIL;
+	}
+	*crc = AvlChecksum(*crc, buf, size);
+
+	return SUCCESS;
+}
+
+/* read and decode count elements into elements, returns how many */
+static size_t ReadElements(FILE *file, void **elements, size_t count,
+						   decode_func decode, void *params,
+						   unsigned long *crc)
+{
+	unsigned char len[LEN_SIZE];
+	scratch_ty scratch;
+	size_t size = 0;
+	size_t i = 0;
+
+	scratch.data = NULL;
+	scratch.capacity = 0;
+
+	for(i = 0; i < count; ++i)
+	{
+		if(SUCCESS != ReadBytes(file, len, LEN_SIZE, crc))
+		{
+			break;
+		}
+		size = GetUint(len, LEN_SIZE);
+		if(SUCCESS != Reserve(&scratch, size) ||
+		   SUCCESS != ReadBytes(file, scratch.data, size, crc))
+		{
+			break;
+		}
+		elements[i] = decode(scratch.data, size, params);
+		if(NULL == elements[i])
+		{
+			break;
+		}
+	}
+	free(scratch.data);
+
+	return i;
+}
+
+status_ty AvlSnapshotLoad(avl_ty *avl, const char *path,
+                          decode_func decode, void *params)
+{
+	unsigned char header[MAGIC_SIZE + COUNT_SIZE];
+	unsigned char crc[CRC_SIZE];
+	unsigned long file_crc = 0;
+	void **elements = NULL;
+	status_ty status = SUCCESS;
+	size_t count = 0;
+	size_t loaded = 0;
+	FILE *file = NULL;
+
+	assert(NULL != avl);
+	assert(AvlIsEmpty(avl));
+	assert(NULL != path);
+	assert(NULL != decode);
+
+	file = fopen(path, "rb");
+	if(NULL == file)
+	{
+		return FAIL;
+	}
+
+	if(SUCCESS != ReadBytes(file, header, sizeof(header), &file_crc) ||
+	   0 != memcmp(header, MAGIC, MAGIC_SIZE))
+	{
+		fclose(file);
+		return FAIL;
+	}
+	count = GetUint(header + MAGIC_SIZE, COUNT_SIZE);
+
+	if(count < ((size_t)-1) / sizeof(void *))
+	{
+		elements = (void **)malloc((count + 1) * sizeof(void *));
+	}
+	if(NULL == elements)
+	{
+		fclose(file);
+		return FAIL;
+	}
+
+	loaded = ReadElements(file, elements, count, decode, params, &file_crc);
+	if(loaded != count || CRC_SIZE != fread(crc, 1, CRC_SIZE, file) ||
+	   GetUint(crc, CRC_SIZE) != file_crc)
+	{
+		status = FAIL;
+	}
+	fclose(file);
+
+	if(SUCCESS == status)
+	{
+		status = AvlBulkLoad(avl, elements, count);
+	}
+	if(SUCCESS != status)
+	{
+		while(0 < loaded)
+		{
+			--loaded;
+			free(elements[loaded]);
+		}
+	}
+	free(elements);
+
+	return status;
+}
@@ -0,0 +1,100 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : save and load avl trees to files    *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_SNAPSHOT_H__
+#define __ILRD_OL127_128_AVL_SNAPSHOT_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+
+/* write the bytes of data to buf when they fit in buf_size,
+   return the num of bytes data needs */
+typedef size_t (*encode_func)(const void *data, void *buf, size_t buf_size,
+                                                             void *params);
+/* return a malloced element made of size bytes, freed with free */
+typedef void *(*decode_func)(const void *buf, size_t size, void *params);
+
+typedef struct avl_checkpoint avl_checkpoint_ty;
+
+/* pause_seconds is the time AvlCheckpointAsync held the caller,
+   write_seconds the time of the background write */
+typedef struct
+{
+	size_t elements;
+	size_t bytes;
+	double pause_seconds;
+	double write_seconds;
+} avl_checkpoint_stats_ty;
+
+/*
+DESCRIPTION : update a crc32 with more bytes, start with 0
+PARAMETERS : crc so far, pointer to bytes and their num
+RETURN : the new crc
+COMPLEXITY : time - O(size), space - O(1)
+*/
+unsigned long AvlChecksum(unsigned long crc, const void *buf, size_t size);
+
+/*
+DESCRIPTION : write all the elements of avl in order to a file.
+the file is written aside and renamed over path when it is
+synced, so path holds the old snapshot or the new one even
+after a crash.
+PARAMETERS : pointer to avl, path of the file, encode function
+and its params.
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(n), space - O(logn)
+*/
+status_ty AvlSnapshotSave(avl_ty *avl, const char *path,
+                          encode_func encode, void *params);
+
+/*
+DESCRIPTION : load a file written by AvlSnapshotSave to an empty avl.
+the elements are made by decode and bulk loaded, nothing is loaded
+if the file is damaged.
+PARAMETERS : pointer to empty avl, path of the file, decode function
+and its params.
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(n), space - O(n)
+*/
+status_ty AvlSnapshotLoad(avl_ty *avl, const char *path,
+                          decode_func decode, void *params);
+
+/*
+DESCRIPTION : start writing a snapshot of avl as AvlSnapshotSave
+does, on a background thread. the elements avl holds now are written,
+avl may be changed and destroyed meanwhile, and only the nodes that
+are changed are copied. encode is called from the thread, and the
+elements must not be freed until the checkpoint is done.
+PARAMETERS : pointer to avl, path of the file, encode function
+and its params.
+RETURN : pointer to the checkpoint, or NULL on failure.
+COMPLEXITY : time - O(1), space - O(1), and O(logn) per change of
+avl until the checkpoint is done
+*/
+avl_checkpoint_ty *AvlCheckpointAsync(avl_ty *avl, const char *path,
+                                      encode_func encode, void *params);
+
+/*
+DESCRIPTION : check if the snapshot of a checkpoint was written
+PARAMETERS : pointer to checkpoint
+RETURN : TRUE if done, else FALSE
+COMPLEXITY : time - O(1), space - O(1)
+*/
+bool_ty AvlCheckpointIsDone(const avl_checkpoint_ty *checkpoint);
+
+/*
+DESCRIPTION : wait for a checkpoint and destroy it
+PARAMETERS : pointer to checkpoint, pointer to stats to fill,
+or NULL.
+RETURN : SUCCESS or FAIL of writing the snapshot
+COMPLEXITY : time - O(n), space - O(1)
+*/
+status_ty AvlCheckpointWait(avl_checkpoint_ty *checkpoint,
+                            avl_checkpoint_stats_ty *stats);
+
+#endif /* __ILRD_OL127_128_AVL_SNAPSHOT_H__ */
@@ -0,0 +1,189 @@
+#include <assert.h> /* assert */
+#include <stdio.h> /* printf, remove */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
+#include "avl_snapshot.h"
+
+#define PATH "avl_snapshot_test.snap"
+#define KEYS_NUM 100000
+/* magic, count, length and bytes of each element, crc */
+#define FILE_BYTES (4 + 8 + KEYS_NUM * (4 + sizeof(int)) + 4)
+
+
+void AvlCheckpointAsyncTest(void);
+void AvlCheckpointDestroyTest(void);
+void AvlCheckpointFailTest(void);
+
+int CompareInts(const void *avl_data, const void *user_data, void *params);
+size_t EncodeInt(const void *data, void *buf, size_t buf_size, void *params);
+void *DecodeInt(const void *buf, size_t size, void *params);
+int FreeInt(void *data, void *params);
+int CheckNext(void *data, void *params);
+
+
+int main(void)
+{
+	AvlCheckpointAsyncTest();
+	AvlCheckpointDestroyTest();
+	AvlCheckpointFailTest();
+	remove(PATH);
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlCheckpointAsyncTest(void)
+{
+	static int keys[2 * KEYS_NUM];
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_ty *loaded = AvlCreate(&CompareInts, NULL);
+	avl_checkpoint_ty *checkpoint = NULL;
+	avl_checkpoint_stats_ty stats;
+	int next = 0;
+	int i = 0;
+
+	assert(NULL != avl && NULL != loaded);
+	for(i = 0; i < 2 * KEYS_NUM; ++i)
+	{
+		keys[i] = i;
+	}
+	for(i = 0; i < KEYS_NUM; ++i)
+	{
+		AvlInsert(avl, keys + (i * 7919) % KEYS_NUM);
+	}
+
+	checkpoint = AvlCheckpointAsync(avl, PATH, &EncodeInt, NULL);
+	assert(NULL != checkpoint);
+
+	/* the writes after the checkpoint are not in the snapshot */
+	for(i = 0; i < KEYS_NUM; i += 2)
+	{
+		assert(SUCCESS == AvlRemove(avl, keys + i));
+		assert(SUCCESS == AvlInsert(avl, keys + KEYS_NUM + i));
+	}
+	assert(SUCCESS == AvlCheckpointWait(checkpoint, &stats));
+	assert(KEYS_NUM == stats.elements);
+	assert(FILE_BYTES == stats.bytes);
+	assert(stats.pause_seconds <= stats.write_seconds);
+
+	assert(SUCCESS == AvlSnapshotLoad(loaded, PATH, &DecodeInt, NULL));
+	assert(KEYS_NUM == AvlSize(loaded));
+	assert(SUCCESS == AvlForEach(loaded, &CheckNext, &next, INORDER));
+	assert(KEYS_NUM == next);
+
+	assert(KEYS_NUM == AvlSize(avl));
+	for(i = 0; i < KEYS_NUM; ++i)
+	{
+		assert((i % 2 ? SUCCESS : FAIL) == AvlFind(avl, keys + i));
+		assert((i % 2 ? FAIL : SUCCESS) == AvlFind(avl, keys + KEYS_NUM + i));
+	}
+
+	AvlForEach(loaded, &FreeInt, NULL, POST_ORDER);
+	AvlDestroy(loaded);
+	AvlDestroy(avl);
+}
+
+/* the avl is gone before the snapshot is written */
+void AvlCheckpointDestroyTest(void)
+{
+	int keys[1000] = {0};
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_ty *loaded = AvlCreate(&CompareInts, NULL);
+	avl_checkpoint_ty *checkpoint = NULL;
+	int i = 0;
+
+	assert(NULL != avl && NULL != loaded);
+	for(i = 0; i < 1000; ++i)
+	{
+		keys[i] = i;
+		AvlInsert(avl, keys + i);
+	}
+
+	checkpoint = AvlCheckpointAsync(avl, PATH, &EncodeInt, NULL);
+	assert(NULL != checkpoint);
+	AvlDestroy(avl);
+	while(!AvlCheckpointIsDone(checkpoint))
+	{
+	}
+	assert(SUCCESS == AvlCheckpointWait(checkpoint, NULL));
+
+	assert(SUCCESS == AvlSnapshotLoad(loaded, PATH, &DecodeInt, NULL));
+	assert(1000 == AvlSize(loaded));
+	assert(SUCCESS == AvlFind(loaded, keys + 999));
+
+	AvlForEach(loaded, &FreeInt, NULL, POST_ORDER);
+	AvlDestroy(loaded);
+}
+
+void AvlCheckpointFailTest(void)
+{
+	int key = 1;
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_checkpoint_ty *checkpoint = NULL;
+	avl_checkpoint_stats_ty stats;
+
+	assert(NULL != avl);
+	AvlInsert(avl, &key);
+
+	checkpoint = AvlCheckpointAsync(avl, "no_such_dir/" PATH, &EncodeInt,
+																	NULL);
+	assert(NULL != checkpoint);
+	assert(FAIL == AvlCheckpointWait(checkpoint, &stats));
+	assert(1 == stats.elements);
+
+	AvlDestroy(avl);
+}
+
+
+int CompareInts(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+	return *(const int *)avl_data - *(const int *)user_data;
+}
+
+size_t EncodeInt(const void *data, void *buf, size_t buf_size, void *params)
+{
+	(void)params;
+	if(sizeof(int) <= buf_size)
+	{
+		memcpy(buf, data, sizeof(int));
+	}
+	return sizeof(int);
+}
+
+void *DecodeInt(const void *buf, size_t size, void *params)
+{
+	int *data = NULL;
+	(void)params;
+
+	if(sizeof(int) != size)
+	{
+		return NULL;
+	}
+	data = (int *)malloc(sizeof(int));
+	if(NULL != data)
+	{
+		memcpy(data, buf, sizeof(int));
+	}
+	return data;
+}
+
+int FreeInt(void *data, void *params)
+{
+	(void)params;
+	free(data);
+
+	return 0;
+}
+
+int CheckNext(void *data, void *params)
+{
+	int *next = (int *)params;
+
+	assert(*next == *(int *)data);
+	++*next;
+
+	return 0;
+}
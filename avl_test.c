@@ -1,9 +1,20 @@
 #include <assert.h> /* assert */
 #include <stdio.h> /* printf */
+#include <limits.h> /* INT_MIN, INT_MAX */
+#include <stdlib.h> /* rand */
+#include <string.h> /* strcmp, memset */
 #include "avl.h"
 
 #define MAX_HEIGHT 10
 
+/* the elements an action visited, in order, until stop */
+typedef struct
+{
+	int last;
+	long count;
+	int stop;
+} visit_ty;
+
 
 void AvlCreateTest(void);
 void AvlInsertTest(void);
@@ -14,9 +25,40 @@ void AvlFindTest(void);
 void AvlForEachTest(void);
 void GeneralTest(void);
 void BugsTest(void);
+void AvlAggregateTest(void);
+void AvlIntervalTest(void);
+void AvlMultisetTest(void);
+void AvlStringTest(void);
+void AvlCompactTest(void);
+void AvlCursorTest(void);
+void AvlBulkLoadTest(void);
+void AvlCacheTest(void);
+void AvlFilterTest(void);
+void AvlFindBatchTest(void);
+void AvlCmpBatchTest(void);
+void AvlForEachBudgetTest(void);
+void AvlIndexTest(void);
+void AvlCloneTest(void);
+void AvlDiffTest(void);
+void AvlPolicyTest(void);
+void AvlLatencyTest(void);
+void AvlLazyRemoveTest(void);
 
 int CompareInts(const void *bst_data, const void *user_data, void *params);
 int MultInts(void *data, void *params);
+void SumInts(void *aggregate, const void *data, const void *left_aggregate,
+					const void *right_aggregate, void *params);
+int CompareStarts(const void *avl_data, const void *user_data, void *params);
+void GetInterval(const void *data, long *start, long *end, void *params);
+int CountInts(void *data, void *params);
+int CompareStrings(const void *avl_data, const void *user_data, void *params);
+const char *GetString(const void *data, void *params);
+int CheckStringOrder(void *data, void *params);
+unsigned long HashInt(const void *data, void *params);
+int CountCompares(const void *avl_data, const void *user_data, void *params);
+int Visit(void *data, void *params);
+int StopAt(void *data, void *params);
+int CountChange(void *old_data, void *new_data, void *params);
 
 void BigTree(void);
 
@@ -33,6 +75,24 @@ int main(void)
 	AvlIsEmptyTest();
 	AvlFindTest();
 	AvlForEachTest();
+	AvlAggregateTest();
+	AvlIntervalTest();
+	AvlMultisetTest();
+	AvlStringTest();
+	AvlCompactTest();
+	AvlCursorTest();
+	AvlBulkLoadTest();
+	AvlCacheTest();
+	AvlFilterTest();
+	AvlFindBatchTest();
+	AvlCmpBatchTest();
+	AvlForEachBudgetTest();
+	AvlIndexTest();
+	AvlCloneTest();
+	AvlDiffTest();
+	AvlPolicyTest();
+	AvlLatencyTest();
+	AvlLazyRemoveTest();
 
 	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");	
 
@@ -207,6 +267,1240 @@ void GeneralTest(void)
 
 
 
+void AvlAggregateTest(void)
+{
+	int arr[200] = {0};
+	int in_tree[200] = {0};
+	long sum = 0;
+	long expected = 0;
+	int lo = 0;
+	int hi = 0;
+	int i = 0;
+	int j = 0;
+	avl_ty *avl = AvlCreateAugmented(&CompareInts, NULL,
+											&SumInts, sizeof(long));
+	assert(NULL != avl);
+
+	lo = 0;
+	hi = 1000;
+	assert(FAIL == AvlAggregateRange(avl, &lo, &hi, &sum));
+
+	for(i = 0; i < 200; ++i)
+	{
+		arr[i] = i * 3;
+	}
+
+	for(i = 0; i < 2000; ++i)
+	{
+		j = rand() % 200;
+		if(in_tree[j])
+		{
+			AvlRemove(avl, arr + j);
+		}
+		else
+		{
+			assert(SUCCESS == AvlInsert(avl, arr + j));
+		}
+		in_tree[j] = !in_tree[j];
+
+		lo = rand() % 600;
+		hi = lo + rand() % 200;
+		expected = 0;
+		for(j = 0; j < 200; ++j)
+		{
+			if(in_tree[j] && arr[j] >= lo && arr[j] <= hi)
+			{
+				expected += arr[j];
+			}
+		}
+
+		sum = 0;
+		if(SUCCESS == AvlAggregateRange(avl, &lo, &hi, &sum))
+		{
+			assert(expected == sum);
+		}
+		else
+		{
+			assert(0 == expected);
+		}
+	}
+
+	AvlDestroy(avl);
+}
+
+
+void AvlIntervalTest(void)
+{
+	long intervals[100][2] = {{0}};
+	int in_tree[100] = {0};
+	long count = 0;
+	long expected = 0;
+	long lo = 0;
+	long hi = 0;
+	int i = 0;
+	int j = 0;
+	avl_ty *avl = AvlCreateInterval(&CompareStarts, NULL, &GetInterval);
+	assert(NULL != avl);
+
+	for(i = 0; i < 100; ++i)
+	{
+		intervals[i][0] = rand() % 1000;
+		intervals[i][1] = intervals[i][0] + 1 + rand() % 100;
+	}
+
+	for(i = 0; i < 1000; ++i)
+	{
+		j = rand() % 100;
+		if(in_tree[j])
+		{
+			AvlRemove(avl, intervals[j]);
+		}
+		else
+		{
+			assert(SUCCESS == AvlInsert(avl, intervals[j]));
+		}
+		in_tree[j] = !in_tree[j];
+
+		lo = rand() % 1100;
+		hi = lo + 1 + rand() % 50;
+		expected = 0;
+		for(j = 0; j < 100; ++j)
+		{
+			if(in_tree[j] && intervals[j][0] < hi && intervals[j][1] > lo)
+			{
+				++expected;
+			}
+		}
+		count = 0;
+		assert(SUCCESS == AvlIntervalOverlap(avl, lo, hi, &CountInts, &count));
+		assert(expected == count);
+
+		expected = 0;
+		for(j = 0; j < 100; ++j)
+		{
+			if(in_tree[j] && intervals[j][0] <= lo && intervals[j][1] > lo)
+			{
+				++expected;
+			}
+		}
+		count = 0;
+		assert(SUCCESS == AvlIntervalStab(avl, lo, &CountInts, &count));
+		assert(expected == count);
+	}
+
+	AvlDestroy(avl);
+}
+
+
+void AvlMultisetTest(void)
+{
+	int arr[10] = {4,2,4,7,2,4,9,1,7,4};
+	int not_exist = 5;
+	int i = 0;
+	long count = 0;
+	avl_ty *avl = AvlCreateMultiset(&CompareInts, NULL);
+	assert(NULL != avl);
+
+	for(i = 0; i < 10; ++i)
+	{
+		assert(SUCCESS == AvlInsert(avl, arr + i));
+	}
+
+	assert(10 == AvlSize(avl));
+	assert(4 == AvlCount(avl, arr + 0));
+	assert(2 == AvlCount(avl, arr + 1));
+	assert(1 == AvlCount(avl, arr + 6));
+	assert(0 == AvlCount(avl, &not_exist));
+
+	/* distinct elements are visited once */
+	assert(SUCCESS == AvlForEach(avl, &CountInts, &count, INORDER));
+	assert(5 == count);
+	assert(1 == AvlHeight(avl) || 2 == AvlHeight(avl));
+
+	AvlRemove(avl, arr + 0);
+	AvlRemove(avl, arr + 0);
+	AvlRemove(avl, &not_exist);
+	assert(8 == AvlSize(avl));
+	assert(2 == AvlCount(avl, arr + 0));
+
+	AvlRemove(avl, arr + 6);
+	assert(FAIL == AvlFind(avl, arr + 6));
+	assert(SUCCESS == AvlFind(avl, arr + 0));
+	assert(7 == AvlSize(avl));
+
+	AvlDestroy(avl);
+}
+
+
+void AvlStringTest(void)
+{
+	char *strs[12] = {"https://example.com/a/b/c", "https://example.com/a/b",
+					  "https://example.com/a/b/d", "/usr/lib", "/usr/lib64",
+					  "", "b", "a", "\xff\xfe", "https://example.com/a/b/c/",
+					  "/usr/lib/x86_64-linux-gnu", "/usr/libexec"};
+	char not_exist[] = "https://example.com/a/b/e";
+	char same_as_first[] = "https://example.com/a/b/c";
+	const char *last = NULL;
+	int i = 0;
+	avl_ty *avl = AvlCreateString(&CompareStrings, NULL, &GetString);
+	assert(NULL != avl);
+
+	for(i = 0; i < 12; ++i)
+	{
+		assert(SUCCESS == AvlInsert(avl, strs[i]));
+	}
+
+	for(i = 0; i < 12; ++i)
+	{
+		assert(SUCCESS == AvlFind(avl, strs[i]));
+	}
+	assert(SUCCESS == AvlFind(avl, same_as_first));
+	assert(FAIL == AvlFind(avl, not_exist));
+	assert(SUCCESS == AvlForEach(avl, &CheckStringOrder, &last, INORDER));
+
+	AvlRemove(avl, same_as_first);
+	AvlRemove(avl, strs[5]);
+	assert(FAIL == AvlFind(avl, strs[0]));
+	assert(FAIL == AvlFind(avl, strs[5]));
+	assert(SUCCESS == AvlFind(avl, strs[9]));
+	assert(10 == AvlSize(avl));
+
+	AvlDestroy(avl);
+}
+
+
+static void CheckSum(avl_ty *avl, int *arr, int *in_tree, int n)
+{
+	long sum = 0;
+	long expected = 0;
+	int lo = 0;
+	int hi = 1000000;
+	int i = 0;
+
+	for(i = 0; i < n; ++i)
+	{
+		assert((in_tree[i] ? SUCCESS : FAIL) == AvlFind(avl, arr + i));
+		expected += in_tree[i] ? arr[i] : 0;
+	}
+	if(SUCCESS == AvlAggregateRange(avl, &lo, &hi, &sum))
+	{
+		assert(expected == sum);
+	}
+}
+
+void AvlCompactTest(void)
+{
+	int arr[1000] = {0};
+	int in_tree[1000] = {0};
+	bool_ty is_done = FALSE;
+	int i = 0;
+	int j = 0;
+	avl_ty *avl = AvlCreateAugmented(&CompareInts, NULL,
+											&SumInts, sizeof(long));
+	assert(NULL != avl);
+
+	assert(SUCCESS == AvlCompact(avl));
+
+	for(i = 0; i < 1000; ++i)
+	{
+		arr[i] = i;
+	}
+	for(i = 0; i < 1000; ++i)
+	{
+		j = rand() % 1000;
+		if(!in_tree[j])
+		{
+			assert(SUCCESS == AvlInsert(avl, arr + j));
+			in_tree[j] = 1;
+		}
+	}
+
+	assert(SUCCESS == AvlCompact(avl));
+	CheckSum(avl, arr, in_tree, 1000);
+
+	/* compact again in slices while the tree changes */
+	for(i = 0; !is_done; ++i)
+	{
+		assert(SUCCESS == AvlCompactStep(avl, 16, &is_done));
+		if(0 == i % 3)
+		{
+			j = rand() % 1000;
+			if(in_tree[j])
+			{
+				AvlRemove(avl, arr + j);
+			}
+			else
+			{
+				assert(SUCCESS == AvlInsert(avl, arr + j));
+			}
+			in_tree[j] = !in_tree[j];
+		}
+	}
+	CheckSum(avl, arr, in_tree, 1000);
+
+	/* free the relocated nodes one by one */
+	for(i = 0; i < 1000; i += 2)
+	{
+		AvlRemove(avl, arr + i);
+		in_tree[i] = 0;
+	}
+	CheckSum(avl, arr, in_tree, 1000);
+
+	AvlDestroy(avl);
+}
+
+
+void AvlCursorTest(void)
+{
+	int arr[10] = {7,5,8,3,1,2,6,9,4,10};
+	int seek = 0;
+	int *data = NULL;
+	int expected = 0;
+	int i = 0;
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_cursor_ty *cursor = AvlCursorCreate(avl);
+	assert(NULL != cursor);
+
+	assert(NULL == AvlCursorFirst(cursor));
+	assert(NULL == AvlCursorNext(cursor));
+
+	for(i = 0; i < 10; ++i)
+	{
+		if(5 != arr[i])
+		{
+			AvlInsert(avl, arr + i);
+		}
+	}
+
+	expected = 1;
+	for(data = AvlCursorFirst(cursor); NULL != data;
+									   data = AvlCursorNext(cursor))
+	{
+		assert(expected == *data);
+		expected += (4 == expected) ? 2 : 1;
+	}
+	assert(11 == expected);
+
+	seek = 5;
+	assert(6 == *(int *)AvlCursorSeek(cursor, &seek));
+	assert(7 == *(int *)AvlCursorNext(cursor));
+	seek = 9;
+	assert(9 == *(int *)AvlCursorSeek(cursor, &seek));
+	assert(9 == *(int *)AvlCursorGet(cursor));
+	seek = 11;
+	assert(NULL == AvlCursorSeek(cursor, &seek));
+	assert(NULL == AvlCursorGet(cursor));
+
+	AvlCursorDestroy(cursor);
+	AvlDestroy(avl);
+}
+
+void AvlBulkLoadTest(void)
+{
+	int arr[1000] = {0};
+	void *sorted[1000] = {NULL};
+	avl_cursor_ty *cursor = NULL;
+	long sum = 0;
+	int lo = 0;
+	int hi = 0;
+	int *data = NULL;
+	int i = 0;
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_ty *aug = AvlCreateAugmented(&CompareInts, NULL, &SumInts,
+														 sizeof(long));
+	avl_ty *multiset = AvlCreateMultiset(&CompareInts, NULL);
+
+	assert(SUCCESS == AvlBulkLoad(avl, NULL, 0));
+	assert(AvlIsEmpty(avl));
+
+	for(i = 0; i < 1000; ++i)
+	{
+		arr[i] = i * 2;
+		sorted[i] = arr + i;
+	}
+	assert(SUCCESS == AvlBulkLoad(avl, sorted, 1000));
+	assert(SUCCESS == AvlBulkLoad(aug, sorted, 1000));
+	assert(1000 == AvlSize(avl));
+	assert(9 == AvlHeight(avl));
+
+	cursor = AvlCursorCreate(avl);
+	i = 0;
+	for(data = AvlCursorFirst(cursor); NULL != data;
+									   data = AvlCursorNext(cursor))
+	{
+		assert(i * 2 == *data);
+		++i;
+	}
+	assert(1000 == i);
+	AvlCursorDestroy(cursor);
+
+	/* the loaded tree keeps working as a regular one */
+	for(i = 0; i < 1000; i += 2)
+	{
+		AvlRemove(avl, arr + i);
+	}
+	for(i = 0; i < 1000; ++i)
+	{
+		assert((i % 2 ? SUCCESS : FAIL) == AvlFind(avl, arr + i));
+	}
+
+	lo = 100;
+	hi = 300;
+	assert(SUCCESS == AvlAggregateRange(aug, &lo, &hi, &sum));
+	assert((100 + 300) * 101 / 2 == sum);
+
+	/* equal neighbours of a multiset are counted in one node */
+	sorted[1] = arr;
+	assert(SUCCESS == AvlBulkLoad(multiset, sorted, 3));
+	assert(3 == AvlSize(multiset));
+	assert(2 == AvlCount(multiset, arr));
+
+	AvlDestroy(avl);
+	AvlDestroy(aug);
+	AvlDestroy(multiset);
+}
+
+void AvlCacheTest(void)
+{
+	int arr[1000] = {0};
+	size_t hits = 0;
+	size_t misses = 0;
+	int i = 0;
+	int j = 0;
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_ty *multiset = AvlCreateMultiset(&CompareInts, NULL);
+
+	AvlGetCacheStats(avl, &hits, &misses);
+	assert(0 == hits && 0 == misses);
+	assert(SUCCESS == AvlEnableCache(avl, &HashInt, 64));
+	assert(SUCCESS == AvlEnableCache(multiset, &HashInt, 64));
+
+	for(i = 0; i < 1000; ++i)
+	{
+		arr[i] = i;
+		AvlInsert(avl, arr + i);
+	}
+
+	/* the hot keys are walked once and then served by the cache */
+	for(j = 0; j < 10; ++j)
+	{
+		for(i = 0; i < 16; ++i)
+		{
+			assert(SUCCESS == AvlFind(avl, arr + i));
+		}
+	}
+	AvlGetCacheStats(avl, &hits, &misses);
+	assert(16 == misses);
+	assert(144 == hits);
+
+	/* removed keys are not served from the cache */
+	for(i = 0; i < 16; i += 2)
+	{
+		AvlRemove(avl, arr + i);
+	}
+	for(i = 0; i < 16; ++i)
+	{
+		assert((i % 2 ? SUCCESS : FAIL) == AvlFind(avl, arr + i));
+	}
+
+	/* nor are nodes moved by a compaction */
+	assert(SUCCESS == AvlCompact(avl));
+	for(i = 0; i < 1000; ++i)
+	{
+		assert((i < 16 && 0 == i % 2 ? FAIL : SUCCESS) ==
+										AvlFind(avl, arr + i));
+	}
+
+	/* a cached node of a multiset keeps its count up to date */
+	AvlInsert(multiset, arr + 5);
+	assert(1 == AvlCount(multiset, arr + 5));
+	AvlInsert(multiset, arr + 5);
+	assert(2 == AvlCount(multiset, arr + 5));
+	AvlRemove(multiset, arr + 5);
+	AvlRemove(multiset, arr + 5);
+	assert(0 == AvlCount(multiset, arr + 5));
+
+	AvlDestroy(avl);
+	AvlDestroy(multiset);
+}
+
+void AvlFilterTest(void)
+{
+	int arr[2000] = {0};
+	long compares = 0;
+	long walks = 0;
+	long before = 0;
+	int i = 0;
+	avl_ty *avl = AvlCreate(&CountCompares, &compares);
+	avl_ty *multiset = AvlCreateMultiset(&CountCompares, &compares);
+
+	for(i = 0; i < 2000; ++i)
+	{
+		arr[i] = i;
+	}
+	/* the elements inserted before the filter are added to it */
+	for(i = 0; i < 1000; i += 2)
+	{
+		AvlInsert(avl, arr + i);
+	}
+	assert(SUCCESS == AvlEnableFilter(avl, &HashInt, 1000, 0.01));
+	assert(SUCCESS == AvlEnableFilter(multiset, &HashInt, 10, 0.01));
+	for(i = 1000; i < 2000; i += 2)
+	{
+		AvlInsert(avl, arr + i);
+	}
+
+	for(i = 0; i < 2000; ++i)
+	{
+		before = compares;
+		assert((i % 2 ? FAIL : SUCCESS) == AvlFind(avl, arr + i));
+		walks += (i % 2 && compares != before);
+	}
+	/* about 1% of the 1000 misses walk the tree */
+	assert(30 > walks);
+
+	for(i = 0; i < 2000; i += 2)
+	{
+		AvlRemove(avl, arr + i);
+	}
+	compares = 0;
+	for(i = 0; i < 2000; ++i)
+	{
+		assert(FAIL == AvlFind(avl, arr + i));
+	}
+	assert(0 == compares);
+
+	/* the filter counts each occurrence of a multiset */
+	AvlInsert(multiset, arr + 7);
+	AvlInsert(multiset, arr + 7);
+	AvlRemove(multiset, arr + 7);
+	assert(1 == AvlCount(multiset, arr + 7));
+	AvlRemove(multiset, arr + 7);
+	compares = 0;
+	assert(0 == AvlCount(multiset, arr + 7));
+	assert(0 == compares);
+
+	AvlDestroy(avl);
+	AvlDestroy(multiset);
+}
+
+void AvlFindBatchTest(void)
+{
+	int arr[2000] = {0};
+	void *probes[2000] = {NULL};
+	bool_ty found[2000] = {FALSE};
+	double doubles[100] = {0};
+	void *double_probes[100] = {NULL};
+	avl_ty *batched = AvlCreateBatch(&AvlCmpInts, &AvlCmpBatchInts, NULL);
+	avl_ty *plain = AvlCreate(&CompareInts, NULL);
+	avl_ty *filtered = AvlCreateBatch(&AvlCmpInts, &AvlCmpBatchInts, NULL);
+	avl_ty *reals = AvlCreateBatch(&AvlCmpDoubles, &AvlCmpBatchDoubles, NULL);
+	int i = 0;
+
+	assert(SUCCESS == AvlEnableFilter(filtered, &HashInt, 1000, 0.01));
+	for(i = 0; i < 2000; ++i)
+	{
+		arr[i] = i;
+		probes[i] = arr + (i * 7) % 2000;
+	}
+	for(i = 0; i < 2000; i += 2)
+	{
+		AvlInsert(batched, arr + i);
+		AvlInsert(plain, arr + i);
+		AvlInsert(filtered, arr + i);
+	}
+
+	/* each probe is in the batch twice */
+	assert(SUCCESS == AvlFindBatch(batched, probes, 1000, found));
+	for(i = 0; i < 1000; ++i)
+	{
+		assert((*(int *)probes[i] % 2 ? FALSE : TRUE) == found[i]);
+	}
+	assert(SUCCESS == AvlFindBatch(plain, probes, 2000, found));
+	for(i = 0; i < 2000; ++i)
+	{
+		assert((*(int *)probes[i] % 2 ? FALSE : TRUE) == found[i]);
+	}
+	assert(SUCCESS == AvlFindBatch(filtered, probes, 2000, found));
+	for(i = 0; i < 2000; ++i)
+	{
+		assert((*(int *)probes[i] % 2 ? FALSE : TRUE) == found[i]);
+	}
+	assert(SUCCESS == AvlFindBatch(plain, probes, 0, found));
+
+	for(i = 0; i < 100; ++i)
+	{
+		doubles[i] = i * 0.5 - 10;
+		double_probes[i] = doubles + (i * 13) % 100;
+	}
+	for(i = 0; i < 100; i += 3)
+	{
+		AvlInsert(reals, doubles + i);
+	}
+	assert(SUCCESS == AvlFindBatch(reals, double_probes, 100, found));
+	for(i = 0; i < 100; ++i)
+	{
+		assert((((i * 13) % 100) % 3 ? FALSE : TRUE) == found[i]);
+	}
+
+	AvlDestroy(batched);
+	AvlDestroy(plain);
+	AvlDestroy(filtered);
+	AvlDestroy(reals);
+}
+
+void AvlCmpBatchTest(void)
+{
+	int ints[37] = {INT_MIN, INT_MAX, 0, -1, 1};
+	double doubles[37] = {-1e300, 1e300, 0, -0.5, 0.5};
+	const void *int_keys[37] = {NULL};
+	const void *double_keys[37] = {NULL};
+	int out[37] = {0};
+	size_t n = 0;
+	int i = 0;
+	int j = 0;
+
+	for(i = 5; i < 37; ++i)
+	{
+		ints[i] = rand() % 11 - 5;
+		doubles[i] = (rand() % 11 - 5) * 0.25;
+	}
+	for(i = 0; i < 37; ++i)
+	{
+		int_keys[i] = ints + i;
+		double_keys[i] = doubles + i;
+	}
+
+	/* the tree element comes first, like in the compare functions */
+	AvlCmpBatchInts(ints + 4, int_keys + 2, 3, out, NULL);
+	assert(0 < out[0] && 0 < out[1] && 0 == out[2]);
+	AvlCmpBatchDoubles(doubles + 3, double_keys + 2, 3, out, NULL);
+	assert(0 > out[0] && 0 == out[1] && 0 > out[2]);
+
+	/* every length, so both the vectors and the tail are checked */
+	for(i = 0; i < 37; ++i)
+	{
+		for(n = 0; n <= 37; ++n)
+		{
+			AvlCmpBatchInts(ints + i, int_keys, n, out, NULL);
+			for(j = 0; j < (int)n; ++j)
+			{
+				assert(out[j] == AvlCmpInts(ints + i, ints + j, NULL));
+			}
+			AvlCmpBatchDoubles(doubles + i, double_keys, n, out, NULL);
+			for(j = 0; j < (int)n; ++j)
+			{
+				assert(out[j] == AvlCmpDoubles(doubles + i, doubles + j, NULL));
+			}
+		}
+	}
+}
+
+void AvlForEachBudgetTest(void)
+{
+	int arr[2000] = {0};
+	visit_ty visit = {-1, 0, 500};
+	long expected = 64;
+	bool_ty is_done = FALSE;
+	int i = 0;
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_cursor_ty *state = AvlCursorCreate(avl);
+
+	for(i = 0; i < 2000; ++i)
+	{
+		arr[i] = i;
+	}
+	for(i = 0; i < 2000; i += 2)
+	{
+		AvlInsert(avl, arr + i);
+	}
+
+	/* the action stops the walk at 500 */
+	assert(FAIL == AvlForEach(avl, &Visit, &visit, INORDER));
+	assert(251 == visit.count);
+	visit.last = -1;
+	assert(FAIL == AvlForEachBudget(avl, state, &Visit, &visit, 2000,
+															&is_done));
+	assert(TRUE == is_done);
+	assert(502 == visit.count);
+	assert(FAIL == AvlForEach(avl, &StopAt, &visit, PREORDER));
+	assert(FAIL == AvlForEach(avl, &StopAt, &visit, POST_ORDER));
+	AvlCursorDestroy(state);
+
+	state = AvlCursorCreate(avl);
+	visit.last = -1;
+	visit.count = 0;
+	visit.stop = 2000;
+	assert(SUCCESS == AvlForEachBudget(avl, state, &Visit, &visit, 64,
+															&is_done));
+	assert(FALSE == is_done);
+	assert(126 == visit.last);
+
+	/* changes behind the position are not seen, changes after it are */
+	for(i = 1; i < 2000; i += 2)
+	{
+		AvlInsert(avl, arr + i);
+	}
+	for(i = 1000; i < 1500; i += 2)
+	{
+		AvlRemove(avl, arr + i);
+	}
+	AvlRemove(avl, arr + 126);
+	for(i = 127; i < 2000; ++i)
+	{
+		expected += (i < 1000 || 1500 <= i || i % 2);
+	}
+
+	assert(SUCCESS == AvlForEachBudget(avl, state, &Visit, &visit, 50,
+															&is_done));
+	assert(SUCCESS == AvlCompact(avl));
+	while(!is_done)
+	{
+		assert(SUCCESS == AvlForEachBudget(avl, state, &Visit, &visit, 50,
+																&is_done));
+	}
+	assert(1999 == visit.last);
+	assert(expected == visit.count);
+	assert(NULL == AvlCursorNext(state));
+
+	AvlCursorDestroy(state);
+	AvlDestroy(avl);
+}
+
+void AvlIndexTest(void)
+{
+	static unsigned char model[1000];
+	int arr[1000] = {0};
+	void *sorted[1000] = {NULL};
+	int dup = 7;
+	long compares = 0;
+	int i = 0;
+	int key = 0;
+	avl_ty *avl = AvlCreate(&CountCompares, &compares);
+	avl_ty *multiset = AvlCreateMultiset(&CountCompares, &compares);
+	avl_ty *loaded = AvlCreate(&CountCompares, &compares);
+
+	for(i = 0; i < 1000; ++i)
+	{
+		arr[i] = i;
+		sorted[i] = arr + i;
+	}
+	/* the elements inserted before the index are added to it */
+	for(i = 0; i < 100; ++i)
+	{
+		AvlInsert(avl, arr + i);
+		model[i] = 1;
+	}
+	assert(SUCCESS == AvlEnableIndex(avl, &HashInt));
+
+	for(i = 0; i < 20000; ++i)
+	{
+		key = rand() % 1000;
+		if(model[key])
+		{
+			AvlRemove(avl, arr + key);
+		}
+		else
+		{
+			assert(SUCCESS == AvlInsert(avl, arr + key));
+		}
+		model[key] = !model[key];
+
+		key = rand() % 1000;
+		compares = 0;
+		assert((model[key] ? SUCCESS : FAIL) == AvlFind(avl, arr + key));
+		assert(1 >= compares);
+	}
+
+	/* nodes moved by compaction are found at their new place */
+	assert(SUCCESS == AvlCompact(avl));
+	for(i = 0; i < 1000; ++i)
+	{
+		assert((model[i] ? SUCCESS : FAIL) == AvlFind(avl, arr + i));
+	}
+
+	/* equal elements have a node each */
+	AvlInsert(avl, &dup);
+	AvlInsert(avl, &dup);
+	AvlRemove(avl, arr + 7);
+	assert(SUCCESS == AvlFind(avl, arr + 7));
+	AvlRemove(avl, arr + 7);
+	assert((model[7] ? SUCCESS : FAIL) == AvlFind(avl, arr + 7));
+
+	assert(SUCCESS == AvlEnableIndex(multiset, &HashInt));
+	AvlInsert(multiset, arr + 3);
+	AvlInsert(multiset, arr + 3);
+	AvlRemove(multiset, arr + 3);
+	assert(1 == AvlCount(multiset, arr + 3));
+	AvlRemove(multiset, arr + 3);
+	assert(0 == AvlCount(multiset, arr + 3));
+
+	assert(SUCCESS == AvlEnableIndex(loaded, &HashInt));
+	assert(SUCCESS == AvlBulkLoad(loaded, sorted, 1000));
+	compares = 0;
+	for(i = 0; i < 1000; ++i)
+	{
+		assert(SUCCESS == AvlFind(loaded, arr + i));
+	}
+	assert(1000 == compares);
+
+	AvlDestroy(avl);
+	AvlDestroy(multiset);
+	AvlDestroy(loaded);
+}
+
+void AvlCloneTest(void)
+{
+	int arr[1500] = {0};
+	visit_ty visit = {-1, 0, -1};
+	long sum = 0;
+	int lo = 0;
+	int hi = 1499;
+	bool_ty is_done = FALSE;
+	int i = 0;
+	avl_ty *avl = AvlCreateAugmented(&CompareInts, NULL, &SumInts,
+													 sizeof(long));
+	avl_ty *clone = NULL;
+	avl_ty *second = NULL;
+
+	for(i = 0; i < 1500; ++i)
+	{
+		arr[i] = i;
+	}
+	for(i = 0; i < 1000; ++i)
+	{
+		AvlInsert(avl, arr + (i * 7) % 1000);
+	}
+	assert(SUCCESS == AvlEnableIndex(avl, &HashInt));
+	clone = AvlClone(avl);
+	assert(NULL != clone);
+	assert(1000 == AvlSize(clone));
+
+	/* changes of each tree are not seen by the other */
+	for(i = 0; i < 1000; i += 2)
+	{
+		assert(SUCCESS == AvlRemove(clone, arr + i));
+	}
+	for(i = 1000; i < 1500; ++i)
+	{
+		assert(SUCCESS == AvlInsert(avl, arr + i));
+	}
+	assert(SUCCESS == AvlRemove(clone, arr + 1200));
+	assert(1500 == AvlSize(avl));
+	assert(500 == AvlSize(clone));
+	for(i = 0; i < 1500; ++i)
+	{
+		assert(SUCCESS == AvlFind(avl, arr + i));
+		assert(((i < 1000 && i % 2) ? SUCCESS : FAIL) ==
+											AvlFind(clone, arr + i));
+	}
+	assert(SUCCESS == AvlForEach(clone, &Visit, &visit, INORDER));
+	assert(500 == visit.count);
+
+	/* the aggregates of copied nodes are recomputed */
+	assert(SUCCESS == AvlAggregateRange(avl, &lo, &hi, &sum));
+	assert(1499L * 1500 / 2 == sum);
+	assert(SUCCESS == AvlAggregateRange(clone, &lo, &hi, &sum));
+	assert(500L * 500 == sum);
+	assert(12 >= AvlHeight(avl));
+	assert(10 >= AvlHeight(clone));
+
+	/* a clone of a clone, compacted while sharing its nodes */
+	second = AvlClone(clone);
+	assert(NULL != second);
+	assert(SUCCESS == AvlCompactStep(second, 100, &is_done));
+	assert(SUCCESS == AvlInsert(second, arr));
+	assert(SUCCESS == AvlCompact(second));
+	assert(SUCCESS == AvlRemove(clone, arr + 1));
+	assert(FAIL == AvlFind(clone, arr));
+	assert(SUCCESS == AvlFind(second, arr + 1));
+
+	/* the other trees keep the nodes of a destroyed one */
+	AvlDestroy(avl);
+	visit.last = -1;
+	visit.count = 0;
+	assert(SUCCESS == AvlForEach(second, &Visit, &visit, INORDER));
+	assert(501 == visit.count);
+	AvlDestroy(second);
+	for(i = 3; i < 1000; i += 2)
+	{
+		assert(SUCCESS == AvlFind(clone, arr + i));
+	}
+	AvlDestroy(clone);
+}
+
+void AvlDiffTest(void)
+{
+	int arr[2000] = {0};
+	int other[2000] = {0};
+	visit_ty added = {-1, 0, -1};
+	visit_ty removed = {-1, 0, -1};
+	visit_ty stop = {-1, 0, 1500};
+	long changed = 0;
+	long compares = 0;
+	int i = 0;
+	avl_ty *avl = AvlCreate(&CountCompares, &compares);
+	avl_ty *clone = NULL;
+	avl_ty *copy = AvlCreate(&CountCompares, &compares);
+
+	for(i = 0; i < 2000; ++i)
+	{
+		arr[i] = i;
+		other[i] = i;
+	}
+	for(i = 0; i < 1000; ++i)
+	{
+		AvlInsert(avl, arr + i);
+	}
+	clone = AvlClone(avl);
+	assert(NULL != clone);
+
+	/* nothing changed, only the roots are looked at */
+	compares = 0;
+	assert(SUCCESS == AvlDiff(avl, clone, &Visit, &Visit, &CountChange,
+																&changed));
+	assert(0 == compares);
+
+	AvlRemove(clone, arr + 100);
+	AvlRemove(clone, arr + 500);
+	AvlInsert(clone, arr + 1500);
+	AvlRemove(clone, arr + 700);
+	AvlInsert(clone, other + 700);
+
+	/* only the copied paths are walked */
+	compares = 0;
+	assert(SUCCESS == AvlDiff(avl, clone, &Visit, NULL, NULL, &added));
+	assert(SUCCESS == AvlDiff(avl, clone, NULL, &Visit, NULL, &removed));
+	assert(SUCCESS == AvlDiff(avl, clone, NULL, NULL, &CountChange,
+															&changed));
+	assert(300 > compares);
+	assert(1 == added.count);
+	assert(1500 == added.last);
+	assert(2 == removed.count);
+	assert(500 == removed.last);
+	assert(1 == changed);
+
+	/* equal elements of an unrelated tree */
+	for(i = 999; 0 <= i; --i)
+	{
+		AvlInsert(copy, other + i);
+	}
+	changed = 0;
+	assert(SUCCESS == AvlDiff(avl, copy, NULL, NULL, &CountChange,
+															&changed));
+	assert(1000 == changed);
+	changed = 0;
+	assert(SUCCESS == AvlDiff(copy, clone, NULL, NULL, &CountChange,
+															&changed));
+	assert(997 == changed);
+
+	/* the walk stops at the function that returns non zero */
+	assert(FAIL == AvlDiff(copy, clone, &StopAt, NULL, NULL, &stop));
+
+	AvlDestroy(avl);
+	AvlDestroy(clone);
+	AvlDestroy(copy);
+}
+
+
+void AvlPolicyTest(void)
+{
+	int arr[2000] = {0};
+	void *sorted[2000] = {NULL};
+	visit_ty visit = {-1, 0, -1};
+	size_t rotations = 0;
+	int i = 0;
+	avl_ty *strict = AvlCreateWithPolicy(&CompareInts, NULL, STRICT_AVL);
+	avl_ty *weak = AvlCreateWithPolicy(&CompareInts, NULL, WEAK_AVL);
+	avl_ty *clone = NULL;
+
+	assert(NULL != strict && NULL != weak);
+	for(i = 0; i < 2000; ++i)
+	{
+		arr[i] = i;
+		sorted[i] = arr + i;
+	}
+
+	/* without removes the ranks are the hights */
+	for(i = 0; i < 2000; ++i)
+	{
+		assert(SUCCESS == AvlInsert(strict, arr + (i * 7) % 2000));
+		assert(SUCCESS == AvlInsert(weak, arr + (i * 7) % 2000));
+	}
+	assert(AvlGetRotations(strict) == AvlGetRotations(weak));
+	assert(AvlHeight(strict) == AvlHeight(weak));
+	assert(15 >= AvlHeight(weak));
+
+	/* at most two rotations per remove */
+	for(i = 0; i < 2000; i += 3)
+	{
+		rotations = AvlGetRotations(weak);
+		assert(SUCCESS == AvlRemove(weak, arr + i));
+		assert(2 >= AvlGetRotations(weak) - rotations);
+	}
+	assert(1333 == AvlSize(weak));
+	for(i = 0; i < 2000; ++i)
+	{
+		assert((i % 3 ? SUCCESS : FAIL) == AvlFind(weak, arr + i));
+	}
+	assert(SUCCESS == AvlForEach(weak, &Visit, &visit, INORDER));
+	assert(1333 == visit.count);
+	assert(20 >= AvlHeight(weak));
+
+	/* a clone keeps the policy */
+	clone = AvlClone(weak);
+	assert(NULL != clone);
+	for(i = 0; i < 2000; ++i)
+	{
+		assert(SUCCESS == (i % 3 ? AvlRemove(clone, arr + i) :
+								   AvlInsert(weak, arr + i)));
+	}
+	assert(AvlIsEmpty(clone));
+	assert(0 == AvlHeight(clone));
+	assert(2000 == AvlSize(weak));
+	assert(22 >= AvlHeight(weak));
+	AvlDestroy(clone);
+	AvlDestroy(weak);
+
+	/* a loaded tree takes the removes of a weak avl */
+	weak = AvlCreateWithPolicy(&CompareInts, NULL, WEAK_AVL);
+	assert(NULL != weak);
+	assert(SUCCESS == AvlBulkLoad(weak, sorted, 2000));
+	for(i = 0; i < 1990; ++i)
+	{
+		rotations = AvlGetRotations(weak);
+		assert(SUCCESS == AvlRemove(weak, arr + (i * 7) % 2000));
+		assert(2 >= AvlGetRotations(weak) - rotations);
+	}
+	visit.last = -1;
+	visit.count = 0;
+	assert(SUCCESS == AvlForEach(weak, &Visit, &visit, INORDER));
+	assert(10 == visit.count);
+	assert(6 >= AvlHeight(weak));
+
+	AvlDestroy(weak);
+	AvlDestroy(strict);
+}
+
+void AvlLatencyTest(void)
+{
+	int arr[1000] = {0};
+	avl_histogram_ty hist;
+	visit_ty visit = {-1, 0, -1};
+	int i = 0;
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_ty *clone = NULL;
+
+	assert(NULL != avl);
+
+	/* a percentile is the end of the bucket it falls in */
+	memset(&hist, 0, sizeof(hist));
+	assert(0 == AvlLatencyPercentile(&hist, 50));
+	hist.counts[1] = 50;
+	hist.counts[10] = 49;
+	hist.counts[40] = 1;
+	hist.total = 100;
+	assert(1 == AvlLatencyPercentile(&hist, 0));
+	assert(1 == AvlLatencyPercentile(&hist, 50));
+	assert(13 == AvlLatencyPercentile(&hist, 99));
+	assert(2559 == AvlLatencyPercentile(&hist, 100));
+
+	for(i = 0; i < 1000; ++i)
+	{
+		arr[i] = i;
+	}
+	for(i = 0; i < 1000; ++i)
+	{
+		AvlInsert(avl, arr + (i * 7) % 1000);
+	}
+	for(i = 0; i < 1000; i += 2)
+	{
+		AvlFind(avl, arr + i);
+		AvlRemove(avl, arr + i);
+	}
+	AvlForEach(avl, &Visit, &visit, INORDER);
+
+#ifdef AVL_LATENCY
+	assert(SUCCESS == AvlGetLatencyHistogram(avl, LATENCY_INSERT, &hist));
+	assert(1000 == hist.total);
+	assert(0 < AvlLatencyPercentile(&hist, 99));
+	assert(SUCCESS == AvlGetLatencyHistogram(avl, LATENCY_FIND, &hist));
+	assert(500 == hist.total);
+	assert(SUCCESS == AvlGetLatencyHistogram(avl, LATENCY_REMOVE, &hist));
+	assert(500 == hist.total);
+	assert(SUCCESS == AvlGetLatencyHistogram(avl, LATENCY_FOREACH, &hist));
+	assert(1 == hist.total);
+
+	AvlResetLatency(avl);
+	assert(SUCCESS == AvlGetLatencyHistogram(avl, LATENCY_INSERT, &hist));
+	assert(0 == hist.total);
+
+	/* a clone records its own operations only */
+	AvlInsert(avl, arr);
+	clone = AvlClone(avl);
+	assert(NULL != clone);
+	assert(SUCCESS == AvlGetLatencyHistogram(clone, LATENCY_INSERT, &hist));
+	assert(0 == hist.total);
+	AvlResetLatency(clone);
+	AvlRemove(clone, arr);
+	assert(SUCCESS == AvlGetLatencyHistogram(clone, LATENCY_REMOVE, &hist));
+	assert(1 == hist.total);
+	assert(SUCCESS == AvlGetLatencyHistogram(avl, LATENCY_INSERT, &hist));
+	assert(1 == hist.total);
+	AvlDestroy(clone);
+#else
+	assert(FAIL == AvlGetLatencyHistogram(avl, LATENCY_INSERT, &hist));
+	assert(0 == hist.total);
+	AvlResetLatency(avl);
+	clone = AvlClone(avl);
+	assert(NULL != clone);
+	assert(FAIL == AvlGetLatencyHistogram(clone, LATENCY_INSERT, &hist));
+	AvlDestroy(clone);
+#endif
+
+	AvlDestroy(avl);
+}
+
+void AvlLazyRemoveTest(void)
+{
+	int arr[1000] = {0};
+	int other[1000] = {0};
+	void *datas[2] = {NULL};
+	bool_ty found[2] = {FALSE};
+	visit_ty visit = {-1, 0, -1};
+	visit_ty removed = {-1, 0, -1};
+	avl_cursor_ty *cursor = NULL;
+	size_t rotations = 0;
+	long height = 0;
+	int i = 0;
+	avl_ty *avl = AvlCreate(&CompareInts, NULL);
+	avl_ty *clone = NULL;
+
+	assert(NULL != avl);
+	for(i = 0; i < 1000; ++i)
+	{
+		arr[i] = i;
+		other[i] = i;
+	}
+	for(i = 0; i < 1000; ++i)
+	{
+		AvlInsert(avl, arr + (i * 7) % 1000);
+	}
+	AvlEnableLazyRemove(avl, 50);
+	assert(SUCCESS == AvlEnableIndex(avl, &HashInt));
+	rotations = AvlGetRotations(avl);
+	height = AvlHeight(avl);
+
+	/* removes and inserts of removed elements keep the shape */
+	for(i = 0; i < 400; ++i)
+	{
+		assert(SUCCESS == AvlRemove(avl, arr + i));
+	}
+	assert(SUCCESS == AvlRemove(avl, arr + 10));
+	for(i = 0; i < 100; ++i)
+	{
+		assert(SUCCESS == AvlInsert(avl, other + i));
+	}
+	assert(rotations == AvlGetRotations(avl));
+	assert(height == AvlHeight(avl));
+	assert(700 == AvlSize(avl));
+
+	/* the dead nodes are relocated with the live ones */
+	assert(SUCCESS == AvlCompact(avl));
+	assert(1000 == AvlCountCompacted(avl));
+
+	for(i = 0; i < 1000; ++i)
+	{
+		assert(((100 <= i && 400 > i) ? FAIL : SUCCESS) ==
+												AvlFind(avl, arr + i));
+	}
+	assert(0 == AvlCount(avl, arr + 200));
+	datas[0] = arr + 200;
+	datas[1] = arr + 50;
+	assert(SUCCESS == AvlFindBatch(avl, datas, 2, found));
+	assert(FALSE == found[0] && TRUE == found[1]);
+	assert(SUCCESS == AvlForEach(avl, &Visit, &visit, INORDER));
+	assert(700 == visit.count);
+
+	cursor = AvlCursorCreate(avl);
+	assert(NULL != cursor);
+	assert(400 == *(int *)AvlCursorSeek(cursor, arr + 100));
+	assert(99 == *(int *)AvlCursorSeek(cursor, arr + 99));
+	assert(400 == *(int *)AvlCursorNext(cursor));
+	AvlCursorDestroy(cursor);
+
+	/* past half of the nodes dead, the tree is rebuilt */
+	for(i = 0; i < 100; ++i)
+	{
+		assert(SUCCESS == AvlRemove(avl, arr + i));
+	}
+	for(i = 400; i < 501; ++i)
+	{
+		assert(SUCCESS == AvlRemove(avl, arr + i));
+	}
+	assert(499 == AvlSize(avl));
+	assert(8 == AvlHeight(avl));
+	for(i = 0; i < 1000; ++i)
+	{
+		assert((501 <= i ? SUCCESS : FAIL) == AvlFind(avl, arr + i));
+	}
+
+	/* a clone keeps the elements the other tree removes */
+	clone = AvlClone(avl);
+	assert(NULL != clone);
+	for(i = 501; i < 800; ++i)
+	{
+		assert(SUCCESS == AvlRemove(clone, arr + i));
+	}
+	assert(SUCCESS == AvlDiff(avl, clone, NULL, &Visit, NULL, &removed));
+	assert(299 == removed.count);
+	assert(799 == removed.last);
+	assert(200 == AvlSize(clone));
+	assert(499 == AvlSize(avl));
+	for(i = 0; i < 1000; ++i)
+	{
+		assert((501 <= i ? SUCCESS : FAIL) == AvlFind(avl, arr + i));
+		assert((800 <= i ? SUCCESS : FAIL) == AvlFind(clone, arr + i));
+	}
+	AvlDestroy(clone);
+
+	for(i = 501; i < 1000; ++i)
+	{
+		assert(SUCCESS == AvlRemove(avl, arr + i));
+	}
+	assert(AvlIsEmpty(avl));
+	assert(0 == AvlHeight(avl));
+	AvlDestroy(avl);
+
+	/* a multiset is rebuilt by its dead nodes, not its elements */
+	avl = AvlCreateMultiset(&CompareInts, NULL);
+	assert(NULL != avl);
+	AvlEnableLazyRemove(avl, 50);
+	for(i = 0; i < 300; ++i)
+	{
+		assert(SUCCESS == AvlInsert(avl, arr + i % 100));
+	}
+	assert(SUCCESS == AvlCompact(avl));
+	assert(100 == AvlCountCompacted(avl));
+	for(i = 0; i < 240; ++i)
+	{
+		assert(SUCCESS == AvlRemove(avl, arr + i / 3));
+	}
+	assert(60 == AvlSize(avl));
+	assert(FALSE == AvlIsEmpty(avl));
+	for(i = 0; i < 100; ++i)
+	{
+		assert((80 <= i ? 3 : 0) == AvlCount(avl, arr + i));
+	}
+	for(i = 240; i < 300; ++i)
+	{
+		assert(SUCCESS == AvlRemove(avl, arr + i / 3));
+	}
+	assert(AvlIsEmpty(avl));
+	AvlDestroy(avl);
+}
+
+
 int CompareInts(const void *avl_data, const void *user_data, void *params)
 {
 	(void)params;
@@ -225,6 +1519,72 @@ int MultInts(void *data, void *params)
 
 
 
+void SumInts(void *aggregate, const void *data, const void *left_aggregate,
+					const void *right_aggregate, void *params)
+{
+	long sum = *(int *)data;
+	(void)params;
+
+	if(NULL != left_aggregate)
+	{
+		sum += *(long *)left_aggregate;
+	}
+	if(NULL != right_aggregate)
+	{
+		sum += *(long *)right_aggregate;
+	}
+	*(long *)aggregate = sum;
+}
+
+int CompareStarts(const void *avl_data, const void *user_data, void *params)
+{
+	long avl_start = ((const long *)avl_data)[0];
+	long user_start = ((const long *)user_data)[0];
+	(void)params;
+
+	if(avl_start != user_start)
+	{
+		return (avl_start < user_start) ? -1 : 1;
+	}
+	/* equal starts are told apart by address */
+	return (avl_data < user_data) ? -1 : (avl_data > user_data);
+}
+
+void GetInterval(const void *data, long *start, long *end, void *params)
+{
+	(void)params;
+	*start = ((const long *)data)[0];
+	*end = ((const long *)data)[1];
+}
+
+int CountInts(void *data, void *params)
+{
+	(void)data;
+	++*(long *)params;
+	return 0;
+}
+
+int CompareStrings(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+	return strcmp((const char *)avl_data, (const char *)user_data);
+}
+
+const char *GetString(const void *data, void *params)
+{
+	(void)params;
+	return (const char *)data;
+}
+
+int CheckStringOrder(void *data, void *params)
+{
+	const char **last = (const char **)params;
+
+	assert(NULL == *last || 0 > strcmp(*last, (const char *)data));
+	*last = (const char *)data;
+	return 0;
+}
+
 int SumTree(void *data, void *params)
 {
 	*(int *)params += *(int *)data;
@@ -238,15 +1598,40 @@ int AvlPrint(void *data, void *params)
 	return (0);
 }
 
+unsigned long HashInt(const void *data, void *params)
+{
+	(void)params;
+	return (unsigned long)*(const int *)data * 2654435761UL;
+}
 
+int CountCompares(const void *avl_data, const void *user_data, void *params)
+{
+	++*(long *)params;
+	return (*(int*)avl_data - *(int*)user_data);
+}
 
+int Visit(void *data, void *params)
+{
+	visit_ty *visit = (visit_ty *)params;
 
+	assert(visit->last < *(int *)data);
+	visit->last = *(int *)data;
+	++visit->count;
 
+	return (*(int *)data == visit->stop);
+}
 
+int StopAt(void *data, void *params)
+{
+	return (*(int *)data == ((visit_ty *)params)->stop);
+}
 
+/* count the changed elements in a long */
+int CountChange(void *old_data, void *new_data, void *params)
+{
+	assert(*(int *)old_data == *(int *)new_data);
+	assert(old_data != new_data);
+	++*(long *)params;
 
-
-
-
-
-
+	return 0;
+}
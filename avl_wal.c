@@ -0,0 +1,664 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : durable avl with a write ahead log  *
+ *                                                   *
+ *****************************************************/
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h> /* assert */
+#include <errno.h> /* errno, EINTR */
+#include <fcntl.h> /* open */
+#include <pthread.h> /* pthread_mutex_t, pthread_cond_t */
+#include <stdlib.h> /* malloc, realloc, free */
+#include <string.h> /* strlen, strcpy, strcat */
+#include <sys/stat.h> /* fstat */
+#include <unistd.h> /* read, write, fsync, ftruncate, access, close */
+
+#include "avl_wal.h"
+
+#define LEN_SIZE 4
+#define OP_SIZE 1
+#define CRC_SIZE 4
+#define HEADER_SIZE (LEN_SIZE + OP_SIZE)
+#define RECORD_SIZE(payload) (HEADER_SIZE + (payload) + CRC_SIZE)
+#define BUF_INIT 4096
+
+typedef enum
+{
+	OP_INSERT = 1,
+	OP_REMOVE = 2
+} op_ty;
+
+/* encoded records waiting for a write */
+typedef struct
+{
+	unsigned char *data;
+	size_t used;
+	size_t capacity;
+} record_buf_ty;
+
+/* every record gets a sequence number when appended to pending. the
+   thread that finds no flush running becomes the leader, swaps pending
+   with writing, and writes and syncs the whole batch without the lock,
+   while the others wait for durable to pass their records */
+struct avl_wal
+{
+	avl_ty *avl;
+	cmp_func cmp;
+	pthread_mutex_t lock;
+	pthread_cond_t flushed;
+	int fd;
+	char *snap_path;
+	encode_func encode;
+	decode_func decode;
+	void *params;
+	record_buf_ty pending;
+	record_buf_ty writing;
+	unsigned long appended;
+	unsigned long durable;
+	bool_ty is_flushing;
+	status_ty io_status;
+	size_t log_size;
+	size_t checkpoint_size;
+	size_t syncs_num;
+};
+
+static status_ty Checkpoint(avl_wal_ty *wal, size_t min_log_size);
+
+
+/*--------------- records ------------*/
+
+static void PutUint(unsigned char *buf, unsigned long value, size_t bytes)
+{
+	size_t i = 0;
+
+	for(i = 0; i < bytes; ++i)
+	{
+		buf[i] = (unsigned char)(value & 0xFF);
+		value >>= 8;
+	}
+}
+
+static unsigned long GetUint(const unsigned char *buf, size_t bytes)
+{
+	unsigned long value = 0;
+
+	while(0 < bytes)
+	{
+		--bytes;
+		value = (value << 8) | buf[bytes];
+	}
+
+	return value;
+}
+
+static status_ty Reserve(record_buf_ty *buf, size_t size)
+{
+	unsigned char *data = NULL;
+	size_t capacity = (0 == buf->capacity) ? BUF_INIT : buf->capacity;
+
+	if(buf->used + size <= buf->capacity)
+	{
+		return SUCCESS;
+	}
+	while(capacity < buf->used + size)
+	{
+		capacity *= 2;
+	}
+
+	data = (unsigned char *)realloc(buf->data, capacity);
+	if(NULL == data)
+	{
+		return FAIL;
+	}
+	buf->data = data;
+	buf->capacity = capacity;
+
+	return SUCCESS;
+}
+
+/* append a record of data to pending, the lock must be held */
+static status_ty AppendRecord(avl_wal_ty *wal, op_ty op, const void *data)
+{
+	record_buf_ty *buf = &wal->pending;
+	unsigned char *record = NULL;
+	size_t room = (buf->capacity > buf->used + RECORD_SIZE(0)) ?
+				  buf->capacity - buf->used - RECORD_SIZE(0) : 0;
+	size_t size = wal->encode(data, (0 == room) ? NULL :
+								buf->data + buf->used + HEADER_SIZE,
+								room, wal->params);
+
+	if(size > room)
+	{
+		if(SUCCESS != Reserve(buf, RECORD_SIZE(size)))
+		{
+			return FAIL;
+		}
+		wal->encode(data, buf->data + buf->used + HEADER_SIZE, size,
+															wal->params);
+	}
+
+	record = buf->data + buf->used;
+	PutUint(record, size, LEN_SIZE);
+	record[LEN_SIZE] = (unsigned char)op;
+	PutUint(record + HEADER_SIZE + size,
+			AvlChecksum(0, record, HEADER_SIZE + size), CRC_SIZE);
+	buf->used += RECORD_SIZE(size);
+	++wal->appended;
+
+	return SUCCESS;
+}
+
+
+/*--------------- group commit ------------*/
+
+static status_ty WriteAll(int fd, const unsigned char *buf, size_t size)
+{
+	ssize_t written = 0;
+
+	while(0 < size)
+	{
+		written = write(fd, buf, size);
+		if(0 > written && EINTR == errno)
+		{
+			continue;
+		}
+		if(0 >= written)
+		{
+			return FAIL;
+		}
+		buf += written;
+		size -= (size_t)written;
+	}
+
+	return SUCCESS;
+}
+
+/* wait until the records up to seq are durable, leading a batch when
+   no other thread does. the lock must be held */
+static status_ty Commit(avl_wal_ty *wal, unsigned long seq)
+{
+	record_buf_ty batch;
+	unsigned long batch_end = 0;
+	status_ty status = SUCCESS;
+
+	while(wal->durable < seq && SUCCESS == wal->io_status)
+	{
+		if(wal->is_flushing)
+		{
+			pthread_cond_wait(&wal->flushed, &wal->lock);
+			continue;
+		}
+
+		wal->is_flushing = TRUE;
+		batch = wal->pending;
+		wal->pending = wal->writing;
+		wal->writing = batch;
+		batch_end = wal->appended;
+		pthread_mutex_unlock(&wal->lock);
+
+		status = WriteAll(wal->fd, batch.data, batch.used);
+		if(SUCCESS == status && 0 != fsync(wal->fd))
+		{
+			status = FAIL;
+		}
+
+		pthread_mutex_lock(&wal->lock);
+		/* after a failed write the log may end with a torn record, so
+		   nothing more can be appended after it */
+		wal->io_status |= status;
+		wal->log_size += wal->writing.used;
+		wal->writing.used = 0;
+		wal->durable = batch_end;
+		wal->is_flushing = FALSE;
+		++wal->syncs_num;
+		pthread_cond_broadcast(&wal->flushed);
+	}
+
+	return wal->io_status;
+}
+
+/* commit seq and checkpoint when the log is big enough, the lock must
+   be held */
+static status_ty CommitAndCheckpoint(avl_wal_ty *wal, unsigned long seq)
+{
+	status_ty status = Commit(wal, seq);
+
+	/* the records are durable in the log even if the checkpoint fails,
+	   the next write or AvlWalCheckpoint tries it again */
+	if(SUCCESS == status && 0 != wal->checkpoint_size &&
+	   wal->log_size >= wal->checkpoint_size)
+	{
+		Checkpoint(wal, wal->checkpoint_size);
+	}
+
+	return status;
+}
+
+
+/*--------------- tree ------------*/
+
+/* the stored element equal to data, or NULL */
+static void *FindStored(avl_ty *avl, void *data, cmp_func cmp, void *params)
+{
+	avl_cursor_ty *cursor = AvlCursorCreate(avl);
+	void *stored = NULL;
+
+	if(NULL == cursor)
+	{
+		return NULL;
+	}
+	stored = AvlCursorSeek(cursor, data);
+	if(NULL != stored && 0 != cmp(stored, data, params))
+	{
+		stored = NULL;
+	}
+	AvlCursorDestroy(cursor);
+
+	return stored;
+}
+
+static void RemoveStored(avl_ty *avl, void *stored)
+{
+	/* the elements are unique, so stored is the one removed. the
+	   tree of the log is never cloned, so the remove cannot fail */
+	(void)AvlRemove(avl, stored);
+	free(stored);
+}
+
+static int FreeElement(void *data, void *params)
+{
+	(void)params;
+	free(data);
+	return 0;
+}
+
+
+/*--------------- recovery ------------*/
+
+static char *MakePath(const char *path, const char *suffix)
+{
+	char *full_path = (char *)malloc(strlen(path) + strlen(suffix) + 1);
+
+	if(NULL != full_path)
+	{
+		strcpy(full_path, path);
+		strcat(full_path, suffix);
+	}
+
+	return full_path;
+}
+
+static unsigned char *ReadFile(int fd, size_t *size)
+{
+	unsigned char *buf = NULL;
+	struct stat st;
+	ssize_t got = 0;
+	size_t done = 0;
+
+	if(0 != fstat(fd, &st))
+	{
+		return NULL;
+	}
+	buf = (unsigned char *)malloc((size_t)st.st_size + 1);
+	if(NULL == buf)
+	{
+		return NULL;
+	}
+
+	while(done < (size_t)st.st_size)
+	{
+		got = read(fd, buf + done, (size_t)st.st_size - done);
+		if(0 > got && EINTR == errno)
+		{
+			continue;
+		}
+		if(0 >= got)
+		{
+			break;
+		}
+		done += (size_t)got;
+	}
+	*size = done;
+
+	return buf;
+}
+
+/* apply one record to the tree. replaying a record that the snapshot
+   already holds changes nothing, so a crash between saving a snapshot
+   and emptying the log is harmless */
+static status_ty ApplyRecord(avl_wal_ty *wal, op_ty op,
+							 const unsigned char *payload, size_t size)
+{
+	void *data = wal->decode(payload, size, wal->params);
+	void *stored = NULL;
+
+	if(NULL == data)
+	{
+		return FAIL;
+	}
+
+	stored = FindStored(wal->avl, data, wal->cmp, wal->params);
+	if(NULL != stored)
+	{
+		RemoveStored(wal->avl, stored);
+	}
+	if(OP_INSERT == op && SUCCESS == AvlInsert(wal->avl, data))
+	{
+		return SUCCESS;
+	}
+	free(data);
+
+	return (OP_REMOVE == op) ? SUCCESS : FAIL;
+}
+
+/* replay the valid records of the log and cut off the rest */
+static status_ty Replay(avl_wal_ty *wal)
+{
+	unsigned char *log = NULL;
+	size_t log_size = 0;
+	size_t offset = 0;
+	size_t size = 0;
+	unsigned long crc = 0;
+	unsigned char op = 0;
+
+	log = ReadFile(wal->fd, &log_size);
+	if(NULL == log)
+	{
+		return FAIL;
+	}
+
+	while(HEADER_SIZE + CRC_SIZE <= log_size - offset)
+	{
+		size = GetUint(log + offset, LEN_SIZE);
+		op = log[offset + LEN_SIZE];
+		if(size > log_size - offset - RECORD_SIZE(0))
+		{
+			break;
+		}
+		crc = GetUint(log + offset + HEADER_SIZE + size, CRC_SIZE);
+		if(crc != AvlChecksum(0, log + offset, HEADER_SIZE + size) ||
+		   (OP_INSERT != op && OP_REMOVE != op))
+		{
+			break;
+		}
+		if(SUCCESS != ApplyRecord(wal, (op_ty)op, log + offset + HEADER_SIZE,
+																	size))
+		{
+			free(log);
+			return FAIL;
+		}
+		offset += RECORD_SIZE(size);
+	}
+	free(log);
+
+	wal->log_size = offset;
+	if(offset < log_size &&
+	   (0 != ftruncate(wal->fd, (off_t)offset) || 0 != fsync(wal->fd)))
+	{
+		return FAIL;
+	}
+
+	return SUCCESS;
+}
+
+
+/*--------------- public ------------*/
+
+static void FreeWal(avl_wal_ty *wal)
+{
+	if(NULL != wal->avl)
+	{
+		AvlForEach(wal->avl, &FreeElement, NULL, POST_ORDER);
+		AvlDestroy(wal->avl);
+	}
+	if(0 <= wal->fd)
+	{
+		close(wal->fd);
+	}
+	pthread_cond_destroy(&wal->flushed);
+	pthread_mutex_destroy(&wal->lock);
+	free(wal->pending.data);
+	free(wal->writing.data);
+	free(wal->snap_path);
+	free(wal);
+}
+
+avl_wal_ty *AvlWalOpen(const char *path, cmp_func cmp, void *params,
+                       encode_func encode, decode_func decode,
+                       size_t checkpoint_size)
+{
+	avl_wal_ty *wal = NULL;
+	char *log_path = NULL;
+
+	assert(NULL != path);
+	assert(NULL != cmp);
+	assert(NULL != encode);
+	assert(NULL != decode);
+
+	wal = (avl_wal_ty *)calloc(1, sizeof(avl_wal_ty));
+	if(NULL == wal)
+	{
+		return NULL;
+	}
+	wal->cmp = cmp;
+	wal->encode = encode;
+	wal->decode = decode;
+	wal->params = params;
+	wal->is_flushing = FALSE;
+	wal->io_status = SUCCESS;
+	wal->checkpoint_size = checkpoint_size;
+	wal->fd = -1;
+	pthread_mutex_init(&wal->lock, NULL);
+	pthread_cond_init(&wal->flushed, NULL);
+
+	wal->avl = AvlCreate(cmp, params);
+	wal->snap_path = MakePath(path, ".snap");
+	log_path = MakePath(path, ".log");
+	if(NULL == wal->avl || NULL == wal->snap_path || NULL == log_path)
+	{
+		free(log_path);
+		FreeWal(wal);
+		return NULL;
+	}
+
+	if(0 == access(wal->snap_path, F_OK) &&
+	   SUCCESS != AvlSnapshotLoad(wal->avl, wal->snap_path, decode, params))
+	{
+		free(log_path);
+		FreeWal(wal);
+		return NULL;
+	}
+
+	wal->fd = open(log_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	free(log_path);
+	if(0 > wal->fd || SUCCESS != Replay(wal))
+	{
+		FreeWal(wal);
+		return NULL;
+	}
+
+	return wal;
+}
+
+
+status_ty AvlWalClose(avl_wal_ty *wal)
+{
+	status_ty status = SUCCESS;
+
+	assert(NULL != wal);
+
+	pthread_mutex_lock(&wal->lock);
+	status = Commit(wal, wal->appended);
+	pthread_mutex_unlock(&wal->lock);
+	FreeWal(wal);
+
+	return status;
+}
+
+
+status_ty AvlWalInsert(avl_wal_ty *wal, void *data)
+{
+	status_ty status = SUCCESS;
+
+	assert(NULL != wal);
+
+	pthread_mutex_lock(&wal->lock);
+	if(SUCCESS != wal->io_status || SUCCESS == AvlFind(wal->avl, data) ||
+	   SUCCESS != AvlInsert(wal->avl, data))
+	{
+		pthread_mutex_unlock(&wal->lock);
+		return FAIL;
+	}
+	if(SUCCESS != AppendRecord(wal, OP_INSERT, data))
+	{
+		/* the tree of the log is never cloned, so this cannot fail */
+		(void)AvlRemove(wal->avl, data);
+		pthread_mutex_unlock(&wal->lock);
+		return FAIL;
+	}
+	status = CommitAndCheckpoint(wal, wal->appended);
+	if(SUCCESS != status)
+	{
+		/* the record may be lost, so data goes back to the caller */
+		(void)AvlRemove(wal->avl, data);
+	}
+	pthread_mutex_unlock(&wal->lock);
+
+	return status;
+}
+
+
+status_ty AvlWalRemove(avl_wal_ty *wal, void *data)
+{
+	status_ty status = SUCCESS;
+	void *stored = NULL;
+
+	assert(NULL != wal);
+
+	pthread_mutex_lock(&wal->lock);
+	/* an insert may still take its element back if its commit fails,
+	   so only durable elements are removed and freed */
+	if(SUCCESS != Commit(wal, wal->appended))
+	{
+		pthread_mutex_unlock(&wal->lock);
+		return FAIL;
+	}
+	stored = FindStored(wal->avl, data, wal->cmp, wal->params);
+	if(NULL == stored)
+	{
+		pthread_mutex_unlock(&wal->lock);
+		return SUCCESS;
+	}
+	if(SUCCESS != wal->io_status ||
+	   SUCCESS != AppendRecord(wal, OP_REMOVE, stored))
+	{
+		pthread_mutex_unlock(&wal->lock);
+		return FAIL;
+	}
+	RemoveStored(wal->avl, stored);
+	status = CommitAndCheckpoint(wal, wal->appended);
+	pthread_mutex_unlock(&wal->lock);
+
+	return status;
+}
+
+
+status_ty AvlWalFind(avl_wal_ty *wal, void *data)
+{
+	status_ty status = SUCCESS;
+
+	assert(NULL != wal);
+
+	pthread_mutex_lock(&wal->lock);
+	status = AvlFind(wal->avl, data);
+	pthread_mutex_unlock(&wal->lock);
+
+	return status;
+}
+
+
+size_t AvlWalSize(avl_wal_ty *wal)
+{
+	size_t size = 0;
+
+	assert(NULL != wal);
+
+	pthread_mutex_lock(&wal->lock);
+	size = AvlSize(wal->avl);
+	pthread_mutex_unlock(&wal->lock);
+
+	return size;
+}
+
+
+status_ty AvlWalForEach(avl_wal_ty *wal, action_func action, void *params)
+{
+	status_ty status = SUCCESS;
+
+	assert(NULL != wal);
+	assert(NULL != action);
+
+	pthread_mutex_lock(&wal->lock);
+	status = AvlForEach(wal->avl, action, params, INORDER);
+	pthread_mutex_unlock(&wal->lock);
+
+	return status;
+}
+
+
+/* save a snapshot when the log holds at least min_log_size bytes, the
+   lock must be held */
+static status_ty Checkpoint(avl_wal_ty *wal, size_t min_log_size)
+{
+	status_ty status = Commit(wal, wal->appended);
+
+	/* another writer may have checkpointed while this one waited */
+	if(SUCCESS != status || wal->log_size < min_log_size)
+	{
+		return status;
+	}
+
+	status = AvlSnapshotSave(wal->avl, wal->snap_path, wal->encode,
+														 wal->params);
+	if(SUCCESS == status &&
+	   (0 != ftruncate(wal->fd, 0) || 0 != fsync(wal->fd)))
+	{
+		status = FAIL;
+	}
+	if(SUCCESS == status)
+	{
+		wal->log_size = 0;
+	}
+
+	return status;
+}
+
+status_ty AvlWalCheckpoint(avl_wal_ty *wal)
+{
+	status_ty status = SUCCESS;
+
+	assert(NULL != wal);
+
+	pthread_mutex_lock(&wal->lock);
+	status = Checkpoint(wal, 0);
+	pthread_mutex_unlock(&wal->lock);
+
+	return status;
+}
+
+
+size_t AvlWalSyncsNum(avl_wal_ty *wal)
+{
+	size_t syncs_num = 0;
+
+	assert(NULL != wal);
+
+	pthread_mutex_lock(&wal->lock);
+	syncs_num = wal->syncs_num;
+	pthread_mutex_unlock(&wal->lock);
+
+	return syncs_num;
+}
@@ -0,0 +1,114 @@
+/*****************************************************
+ * Author : Avia Avikasis                            *
+ * Reviewer: Gal                                     *
+ * 19/10/2026                                        *
+ * Description : durable avl with a write ahead log  *
+ *                                                   *
+ *****************************************************/
+#ifndef __ILRD_OL127_128_AVL_WAL_H__
+#define __ILRD_OL127_128_AVL_WAL_H__
+
+#include <stddef.h> /* size_t */
+
+#include "avl.h"
+#include "avl_snapshot.h"
+
+typedef struct avl_wal avl_wal_ty;
+
+/*
+DESCRIPTION : open a durable avl kept in the files path.snap and
+path.log, loading the last snapshot and replaying the log after
+it. a torn record at the end of the log is cut off. the elements
+are unique by cmp and owned by the tree, they are malloced by the
+caller or by decode and freed with free when removed or closed.
+when the log grows over checkpoint_size bytes, the tree is saved
+to a new snapshot and the log is emptied.
+PARAMETERS : path of the files without suffix, pointer compare
+function, params to compare and codec functions, encode and decode
+functions, checkpoint size or 0 for checkpoints by AvlWalCheckpoint
+only.
+RETURN : pointer to the durable avl, or NULL on failure.
+COMPLEXITY : time - O(n + mlogn) for m records, space - O(n)
+*/
+avl_wal_ty *AvlWalOpen(const char *path, cmp_func cmp, void *params,
+                       encode_func encode, decode_func decode,
+                       size_t checkpoint_size);
+
+/*
+DESCRIPTION : wait for the log to be durable, then free
+the tree and its elements
+PARAMETERS : pointer to durable avl
+RETURN : SUCCESS, or FAIL if the log could not be written.
+COMPLEXITY : time - O(n), space - O(1)
+*/
+status_ty AvlWalClose(avl_wal_ty *wal);
+
+/*
+DESCRIPTION : insert new element and return when it is durable.
+records of concurrent callers are written with one sync. the
+element is seen by other threads before it is durable.
+thread safe.
+PARAMETERS : pointer to durable avl, pointer to malloced data
+RETURN : SUCCESS, or FAIL if an equal element exists, on allocation
+failure or if the log could not be written. on FAIL the element
+is not in the avl and data still belongs to the caller.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlWalInsert(avl_wal_ty *wal, void *data);
+
+/*
+DESCRIPTION : remove and free the element equal to data and
+return when it is durable. waits for earlier inserts to be
+durable first. thread safe.
+PARAMETERS : pointer to durable avl, pointer to data
+RETURN : SUCCESS, or FAIL on allocation failure or if the log
+could not be written.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlWalRemove(avl_wal_ty *wal, void *data);
+
+/*
+DESCRIPTION : check if data exist. thread safe.
+PARAMETERS : pointer to durable avl, pointer to data
+RETURN : SUCCESS if found, else FAIL.
+COMPLEXITY : time - O(logn), space - O(1)
+*/
+status_ty AvlWalFind(avl_wal_ty *wal, void *data);
+
+/*
+DESCRIPTION : return the num of elements. thread safe.
+PARAMETERS : pointer to durable avl
+RETURN : num of elements(size_t)
+COMPLEXITY : time - O(1), space - O(1)
+*/
+size_t AvlWalSize(avl_wal_ty *wal);
+
+/*
+DESCRIPTION : executes a function on each element in order.
+the function must not change the tree. thread safe.
+PARAMETERS : pointer to durable avl, pointer to action function,
+pointer to params of action function.
+RETURN : SUCCESS or FAIL.
+COMPLEXITY : time - O(n), space - O(logn)
+*/
+status_ty AvlWalForEach(avl_wal_ty *wal, action_func action, void *params);
+
+/*
+DESCRIPTION : save the tree to a new snapshot and empty the log.
+writers wait until it is done. thread safe.
+PARAMETERS : pointer to durable avl
+RETURN : SUCCESS or FAIL
+COMPLEXITY : time - O(n), space - O(logn)
+*/
+status_ty AvlWalCheckpoint(avl_wal_ty *wal);
+
+/*
+DESCRIPTION : return the num of log syncs so far, each one
+making a batch of records durable
+PARAMETERS : pointer to durable avl
+RETURN : num of syncs(size_t)
+COMPLEXITY : time - O(1), space - O(1)
+*/
+size_t AvlWalSyncsNum(avl_wal_ty *wal);
+
+#endif /* __ILRD_OL127_128_AVL_WAL_H__ */
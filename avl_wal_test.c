@@ -0,0 +1,435 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h> /* assert */
+#include <pthread.h> /* pthread_create, pthread_join */
+#include <stdio.h> /* printf, FILE, remove */
+#include <stdlib.h> /* malloc, free, rand */
+#include <string.h> /* memcpy */
+#include <unistd.h> /* symlink */
+#include "avl_wal.h"
+
+#define PATH "avl_wal_test"
+#define SNAP_PATH PATH ".snap"
+#define LOG_PATH PATH ".log"
+#define CRASH_PATH "avl_wal_crash"
+#define CRASH_SNAP_PATH CRASH_PATH ".snap"
+#define CRASH_LOG_PATH CRASH_PATH ".log"
+/* len, op, an int and a crc */
+#define RECORD_BYTES (4 + 1 + sizeof(int) + 4)
+#define KEYS_RANGE 20
+#define OPS_NUM 60
+#define THREADS_NUM 4
+#define PER_THREAD 250
+
+
+void AvlWalBasicTest(void);
+void AvlWalCrashTest(void);
+void AvlWalCorruptTest(void);
+void AvlWalCheckpointTest(void);
+void AvlWalThreadsTest(void);
+void AvlWalIoFailTest(void);
+
+int CompareInts(const void *avl_data, const void *user_data, void *params);
+size_t EncodeInt(const void *data, void *buf, size_t buf_size, void *params);
+void *DecodeInt(const void *buf, size_t size, void *params);
+int *NewInt(int value);
+void RemoveFiles(void);
+unsigned char *ReadAll(const char *path, size_t *size);
+void WriteAll(const char *path, const unsigned char *buf, size_t size);
+int CheckOrder(void *avl_data, void *params);
+void *InsertRange(void *arg);
+
+
+int main(void)
+{
+	AvlWalBasicTest();
+	AvlWalCrashTest();
+	AvlWalCorruptTest();
+	AvlWalCheckpointTest();
+	AvlWalThreadsTest();
+	AvlWalIoFailTest();
+	RemoveFiles();
+
+	printf("\n->->->->->-> success!! <-<-<-<-<-<-\n\n");
+
+	return 0;
+}
+
+
+void AvlWalBasicTest(void)
+{
+	avl_wal_ty *wal = NULL;
+	int *dup = NULL;
+	int last = -1;
+	int i = 0;
+
+	RemoveFiles();
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(0 == AvlWalSize(wal));
+
+	for(i = 0; i < 100; ++i)
+	{
+		assert(SUCCESS == AvlWalInsert(wal, NewInt(i)));
+	}
+	dup = NewInt(5);
+	assert(FAIL == AvlWalInsert(wal, dup));
+	free(dup);
+	for(i = 0; i < 100; i += 2)
+	{
+		assert(SUCCESS == AvlWalRemove(wal, &i));
+	}
+	i = 1000;
+	assert(SUCCESS == AvlWalRemove(wal, &i));
+	assert(50 == AvlWalSize(wal));
+	assert(SUCCESS == AvlWalClose(wal));
+
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(50 == AvlWalSize(wal));
+	for(i = 0; i < 100; ++i)
+	{
+		assert((i % 2 ? SUCCESS : FAIL) == AvlWalFind(wal, &i));
+	}
+	assert(SUCCESS == AvlWalForEach(wal, &CheckOrder, &last));
+	assert(99 == last);
+	assert(SUCCESS == AvlWalClose(wal));
+}
+
+void AvlWalCrashTest(void)
+{
+	static unsigned char states[OPS_NUM + 1][KEYS_RANGE];
+	unsigned char *log = NULL;
+	avl_wal_ty *wal = NULL;
+	size_t log_size = 0;
+	size_t ops = 0;
+	size_t size = 0;
+	size_t k = 0;
+	int key = 0;
+
+	RemoveFiles();
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+
+	/* states[i] is the tree after the first i records */
+	while(ops < OPS_NUM)
+	{
+		key = rand() % KEYS_RANGE;
+		memcpy(states[ops + 1], states[ops], KEYS_RANGE);
+		if(!states[ops][key])
+		{
+			assert(SUCCESS == AvlWalInsert(wal, NewInt(key)));
+		}
+		else
+		{
+			assert(SUCCESS == AvlWalRemove(wal, &key));
+		}
+		states[ops + 1][key] = !states[ops][key];
+		++ops;
+	}
+
+	/* every record returned is durable, so this is the log after a crash */
+	log = ReadAll(LOG_PATH, &log_size);
+	assert(OPS_NUM * RECORD_BYTES == log_size);
+	assert(SUCCESS == AvlWalClose(wal));
+
+	for(k = 0; k <= log_size; ++k)
+	{
+		remove(CRASH_SNAP_PATH);
+		WriteAll(CRASH_LOG_PATH, log, k);
+
+		ops = k / RECORD_BYTES;
+		wal = AvlWalOpen(CRASH_PATH, &CompareInts, NULL,
+						 &EncodeInt, &DecodeInt, 0);
+		assert(NULL != wal);
+		size = 0;
+		for(key = 0; key < KEYS_RANGE; ++key)
+		{
+			assert((states[ops][key] ? SUCCESS : FAIL) ==
+											AvlWalFind(wal, &key));
+			size += states[ops][key];
+		}
+		assert(size == AvlWalSize(wal));
+		assert(SUCCESS == AvlWalClose(wal));
+
+		/* the torn record was cut off */
+		free(ReadAll(CRASH_LOG_PATH, &size));
+		assert(ops * RECORD_BYTES == size);
+	}
+
+	free(log);
+}
+
+void AvlWalCorruptTest(void)
+{
+	unsigned char *log = NULL;
+	avl_wal_ty *wal = NULL;
+	size_t log_size = 0;
+	int i = 0;
+
+	RemoveFiles();
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	for(i = 0; i < 10; ++i)
+	{
+		assert(SUCCESS == AvlWalInsert(wal, NewInt(i)));
+	}
+	assert(SUCCESS == AvlWalClose(wal));
+
+	/* a flipped bit in the payload of the 6th record */
+	log = ReadAll(LOG_PATH, &log_size);
+	log[5 * RECORD_BYTES + 5] ^= 0x10;
+	WriteAll(LOG_PATH, log, log_size);
+	free(log);
+
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(5 == AvlWalSize(wal));
+	i = 5;
+	assert(FAIL == AvlWalFind(wal, &i));
+
+	/* new records go after the last valid one */
+	assert(SUCCESS == AvlWalInsert(wal, NewInt(100)));
+	assert(SUCCESS == AvlWalClose(wal));
+
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(6 == AvlWalSize(wal));
+	i = 100;
+	assert(SUCCESS == AvlWalFind(wal, &i));
+	assert(SUCCESS == AvlWalClose(wal));
+}
+
+void AvlWalCheckpointTest(void)
+{
+	unsigned char *log = NULL;
+	unsigned char garbage[16] = {1, 2, 3};
+	avl_wal_ty *wal = NULL;
+	size_t log_size = 0;
+	int last = -1;
+	int i = 0;
+
+	RemoveFiles();
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt,
+					 10 * RECORD_BYTES);
+	assert(NULL != wal);
+	for(i = 0; i < 105; ++i)
+	{
+		assert(SUCCESS == AvlWalInsert(wal, NewInt(i)));
+	}
+
+	/* the log was emptied by the checkpoint at 100 records */
+	free(ReadAll(LOG_PATH, &log_size));
+	assert(5 * RECORD_BYTES == log_size);
+	assert(SUCCESS == AvlWalClose(wal));
+
+	/* a snapshot that was not renamed yet is ignored */
+	WriteAll(SNAP_PATH ".tmp", garbage, sizeof(garbage));
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(105 == AvlWalSize(wal));
+	assert(SUCCESS == AvlWalForEach(wal, &CheckOrder, &last));
+	assert(104 == last);
+
+	/* a crash after the new snapshot and before emptying the log */
+	for(i = 0; i < 105; i += 3)
+	{
+		assert(SUCCESS == AvlWalRemove(wal, &i));
+	}
+	log = ReadAll(LOG_PATH, &log_size);
+	assert(SUCCESS == AvlWalCheckpoint(wal));
+	assert(SUCCESS == AvlWalClose(wal));
+	WriteAll(LOG_PATH, log, log_size);
+	free(log);
+
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(70 == AvlWalSize(wal));
+	for(i = 0; i < 105; ++i)
+	{
+		assert((i % 3 ? SUCCESS : FAIL) == AvlWalFind(wal, &i));
+	}
+	assert(SUCCESS == AvlWalClose(wal));
+}
+
+typedef struct
+{
+	avl_wal_ty *wal;
+	int first;
+} thread_args_ty;
+
+void AvlWalThreadsTest(void)
+{
+	pthread_t threads[THREADS_NUM];
+	thread_args_ty args[THREADS_NUM];
+	avl_wal_ty *wal = NULL;
+	int last = -1;
+	int i = 0;
+
+	RemoveFiles();
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		args[i].wal = wal;
+		args[i].first = i * PER_THREAD;
+		assert(0 == pthread_create(threads + i, NULL, &InsertRange, args + i));
+	}
+	for(i = 0; i < THREADS_NUM; ++i)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	assert(THREADS_NUM * PER_THREAD == AvlWalSize(wal));
+	assert(THREADS_NUM * PER_THREAD >= AvlWalSyncsNum(wal));
+	printf("%d records in %lu syncs\n", THREADS_NUM * PER_THREAD,
+								(unsigned long)AvlWalSyncsNum(wal));
+	assert(SUCCESS == AvlWalClose(wal));
+
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(THREADS_NUM * PER_THREAD == AvlWalSize(wal));
+	assert(SUCCESS == AvlWalForEach(wal, &CheckOrder, &last));
+	assert(THREADS_NUM * PER_THREAD - 1 == last);
+	assert(SUCCESS == AvlWalClose(wal));
+}
+
+void AvlWalIoFailTest(void)
+{
+	avl_wal_ty *wal = NULL;
+	int *data = NULL;
+	int i = 0;
+
+	RemoveFiles();
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	for(i = 0; i < 3; ++i)
+	{
+		assert(SUCCESS == AvlWalInsert(wal, NewInt(i)));
+	}
+	assert(SUCCESS == AvlWalCheckpoint(wal));
+	assert(SUCCESS == AvlWalClose(wal));
+
+	/* every write to the log fails */
+	remove(LOG_PATH);
+	assert(0 == symlink("/dev/full", LOG_PATH));
+	wal = AvlWalOpen(PATH, &CompareInts, NULL, &EncodeInt, &DecodeInt, 0);
+	assert(NULL != wal);
+	assert(3 == AvlWalSize(wal));
+
+	/* a failed insert leaves data to the caller */
+	data = NewInt(10);
+	assert(FAIL == AvlWalInsert(wal, data));
+	assert(3 == AvlWalSize(wal));
+	assert(FAIL == AvlWalFind(wal, data));
+	free(data);
+
+	i = 1;
+	assert(FAIL == AvlWalRemove(wal, &i));
+	assert(SUCCESS == AvlWalFind(wal, &i));
+	assert(FAIL == AvlWalClose(wal));
+}
+
+
+int CompareInts(const void *avl_data, const void *user_data, void *params)
+{
+	(void)params;
+	return *(const int *)avl_data - *(const int *)user_data;
+}
+
+size_t EncodeInt(const void *data, void *buf, size_t buf_size, void *params)
+{
+	(void)params;
+	if(sizeof(int) <= buf_size)
+	{
+		memcpy(buf, data, sizeof(int));
+	}
+	return sizeof(int);
+}
+
+void *DecodeInt(const void *buf, size_t size, void *params)
+{
+	int *data = NULL;
+	(void)params;
+
+	if(sizeof(int) != size)
+	{
+		return NULL;
+	}
+	data = (int *)malloc(sizeof(int));
+	if(NULL != data)
+	{
+		memcpy(data, buf, sizeof(int));
+	}
+	return data;
+}
+
+int *NewInt(int value)
+{
+	int *data = (int *)malloc(sizeof(int));
+	assert(NULL != data);
+	*data = value;
+	return data;
+}
+
+void RemoveFiles(void)
+{
+	remove(SNAP_PATH);
+	remove(SNAP_PATH ".tmp");
+	remove(LOG_PATH);
+	remove(CRASH_SNAP_PATH);
+	remove(CRASH_LOG_PATH);
+}
+
+unsigned char *ReadAll(const char *path, size_t *size)
+{
+	FILE *file = fopen(path, "rb");
+	unsigned char *buf = NULL;
+	long file_size = 0;
+
+	assert(NULL != file);
+	fseek(file, 0, SEEK_END);
+	file_size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	buf = (unsigned char *)malloc((size_t)file_size + 1);
+	assert(NULL != buf);
+	*size = fread(buf, 1, (size_t)file_size, file);
+	assert((size_t)file_size == *size);
+	fclose(file);
+
+	return buf;
+}
+
+void WriteAll(const char *path, const unsigned char *buf, size_t size)
+{
+	FILE *file = fopen(path, "wb");
+
+	assert(NULL != file);
+	assert(size == fwrite(buf, 1, size, file));
+	fclose(file);
+}
+
+int CheckOrder(void *avl_data, void *params)
+{
+	int *last = (int *)params;
+
+	assert(*last < *(int *)avl_data);
+	*last = *(int *)avl_data;
+	return 0;
+}
+
+void *InsertRange(void *arg)
+{
+	thread_args_ty *args = (thread_args_ty *)arg;
+	int i = 0;
+
+	for(i = 0; i < PER_THREAD; ++i)
+	{
+		if(SUCCESS != AvlWalInsert(args->wal, NewInt(args->first + i)))
+		{
+			abort();
+		}
+	}
+
+	return NULL;
+}